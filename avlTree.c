@@ -1,12 +1,12 @@
 //http://www.zentut.com/c-tutorial/c-avl-tree/
 
 #include <string.h> //memcpy
-#include <stdlib.h> //malloc
 
 #include "IO_RTC.h"
 #include "IO_Driver.h"
 #include "mathFunctions.h"
 #include "avlTree.h"
+#include "memoryArena.h"
 
 //-------------------------------------------------------------------
 //Private functions
@@ -255,8 +255,9 @@ AVLNode* AVL_insert(AVLNode** messageHistoryArray, ubyte4 messageID, ubyte1 mess
 {
     //This function has been hijacked for an emergency quick fix
 
-    AVLNode* message = (AVLNode*)malloc(sizeof(AVLNode));
-    if (message == NULL) //malloc failed
+    //Also called from CanManager_send for new outgoing IDs, so running out must not halt
+    AVLNode* message = (AVLNode*)MemoryArena_tryAlloc(sizeof(AVLNode));
+    if (message == NULL) //memory arena is full (see MemoryArena_report)
     {
         //fprintf(stderr, "Out of memory!!! (insert)\n");
         //exit(1);
@@ -266,10 +267,10 @@ AVLNode* AVL_insert(AVLNode** messageHistoryArray, ubyte4 messageID, ubyte1 mess
         //message->id = messageID;
         message->timeBetweenMessages_Min = minTime;
         message->timeBetweenMessages_Max = maxTime;
-        IO_RTC_StartTime(&message->lastMessage_timeStamp);
+        message->lastMessage_timeStamp = CycleClock_now();
 
         //To copy an entire array, http://stackoverflow.com/questions/9262784/array-equal-another-array
-        memcpy(messageData, message->data, sizeof(messageData));
+        memcpy(message->data, messageData, 8);
 
         message->required = req;
 
@@ -6,6 +6,8 @@
 
 #include "IO_Driver.h"
 
+#include "cycleClock.h"
+
 typedef struct AVLNode
 {
 	//Message Metadata -----------------------------------------------------
@@ -14,7 +16,7 @@ typedef struct AVLNode
 	ubyte1 data[8];
 
     ubyte4 timeBetweenMessages_Min;  //Fastest rate at which messages will be sent
-    ubyte4 lastMessage_timeStamp;    //Last time message was sent/received
+    ubyte8 lastMessage_timeStamp;    //Last time message was sent/received (CycleClock_now)
 
     bool required;
     ubyte4 timeBetweenMessages_Max;  //Slowest rate at which messages will be sent, OR max time between receiving messages before throwing an error
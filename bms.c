@@ -1,7 +1,7 @@
-
 #include <stdio.h>
+#include <stddef.h>  //offsetof
 #include "bms.h"
-#include <stdlib.h>
+#include "memoryArena.h"
 #include "IO_Driver.h"
 #include "IO_RTC.h"
 #include "serial.h"
@@ -40,21 +40,42 @@
 
 struct _BatteryManagementSystem {
 
-    ubyte2 canMessageBaseId;
+    //------------------------------------------------------------------------
+    // Hot state - read every cycle by safety/cooling/torque limits (0x629, 0x624)
+    // Widest fields first so the compiler adds no padding
+    //------------------------------------------------------------------------
+    sbyte4 packVoltage;  //Voltage(100mV)[022]
+    sbyte4 packCurrent;  //Current(100mA)[054]
+    ubyte2  chargeLimit;        // Maximum current acceptable (charge)
+    ubyte2  dischargeLimit;    // Maximum current available (discharge)
+    sbyte1 maxTemp;      //Max Temp[104]
+    sbyte1 avgTemp;      //Avg Temp[096]
+    //ubyte1 SOC;          //SOC(%)[112]
+    ubyte1 CCL;          //DO NOT USE
+    ubyte1 DCL;          //DO NOT USE
 
+    //------------------------------------------------------------------------
+    // Cold state - decoded for diagnostics only, grouped by width
+    //------------------------------------------------------------------------
     SerialManager* sm;
 
-    // 0x622h //
+    ubyte4 batteryEnergyIn;     // Total energy into battery (0x625)
+    ubyte4 batteryEnergyOut;    // Total energy out of battery (0x625)
 
+    ubyte2 canMessageBaseId;
+    ubyte2  timer;                // power up time (0x622)
+    ubyte2 DOD;                 // depth of discharge (0x626)
+    ubyte2 capacity;             // actual capacity of pack (0x626)
+    ubyte2     packRes;            // resistance of entire pack (0x628)
+
+    // 0x622h //
     ubyte1  state;             // state of system
-    ubyte2  timer;                // power up time
     ubyte1  flags;                // flags
     ubyte1  faultCode;         // fault code, stored
     ubyte1  levelFaults;        // Level fault flags (e.g. over voltage, under voltage, etc)
     ubyte1  warnings;            // warning flags
 
     // 0x623h //
-
 //    ubyte2 packVoltage;        // Total voltage of pack
     ubyte1  minVtg;            // Voltage of least charged cell
     ubyte1  minVtgCell;         // ID of cell with lowest voltage
@@ -62,26 +83,13 @@ struct _BatteryManagementSystem {
     ubyte1  maxVtgCell;         // ID of cell with highest voltage
 
     // 0x624h //
-
 //    sbyte2  packCurrent;        // Pack current
-    ubyte2  chargeLimit;        // Maximum current acceptable (charge)
-    ubyte2  dischargeLimit;    // Maximum current available (discharge)
-
-    // 0x625h //
-
-    ubyte4 batteryEnergyIn;     // Total energy into battery
-    ubyte4 batteryEnergyOut;    // Total energy out of battery
-
 
     // 0x626h //
-
     ubyte1  SOC;                 // state of charge
-    ubyte2 DOD;                 // depth of discharge
-    ubyte2 capacity;             // actual capacity of pack
     ubyte1  SOH;                // State of Health
 
     // 0x627h //
-
     sbyte1  packTemp;            // average pack temperature
     sbyte1  minTemp;            // Temperature of coldest sensor
     sbyte1  minTempCell;         // ID of cell with lowest temperature
@@ -89,33 +97,24 @@ struct _BatteryManagementSystem {
     sbyte1  maxTempCell;         // ID of cell with highest temperature
 
     // 0x628h //
-
-    ubyte2     packRes;            // resistance of entire pack
     ubyte1  minRes;              // resistance of lowest resistance cells
     ubyte1  minResCell;         // ID of cell with lowest resistance
     ubyte1  maxRes;                // resistance of highest resistance cells
     ubyte1  maxResCell;            // ID of cell with highest resistance
 
-    // 0X629 //
-
-    sbyte4 packVoltage;  //Voltage(100mV)[022]
-    sbyte4 packCurrent;  //Current(100mA)[054]
-    sbyte1 maxTemp;      //Max Temp[104]
-    sbyte1 avgTemp;      //Avg Temp[096]
-    //ubyte1 SOC;          //SOC(%)[112]
-    //ubyte1 SOC;          //SOC(%)[112]
-    ubyte1 CCL;          //DO NOT USE
-    ubyte1 DCL;          //DO NOT USE
-
-    
-
     // signed = 2's complement: 0XfFF = -1, 0x00 = 0, 0x01 = 1
 
 };
 
+#define BMS_HOT_STATE_BYTES offsetof(struct _BatteryManagementSystem, sm)
+COMPILE_TIME_ASSERT(BMS_HOT_STATE_BYTES <= BMS_HOT_STATE_BUDGET, bmsHotStateBudget);
+
+const ubyte2 BMS_stateBytes = sizeof(struct _BatteryManagementSystem);
+const ubyte2 BMS_hotStateBytes = BMS_HOT_STATE_BYTES;
+
 BatteryManagementSystem* BMS_new(SerialManager* serialMan, ubyte2 canMessageBaseID) {
 
-    BatteryManagementSystem* me = (BatteryManagementSystem*)malloc(sizeof(struct _BatteryManagementSystem));
+    BatteryManagementSystem* me = (BatteryManagementSystem*)MemoryArena_alloc(sizeof(struct _BatteryManagementSystem));
 
     me->canMessageBaseId = canMessageBaseID;
     me->sm = serialMan;
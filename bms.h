@@ -28,6 +28,13 @@
 
 typedef struct _BatteryManagementSystem BatteryManagementSystem;
 
+//Bytes at the front of the BMS object read every cycle (build fails if exceeded)
+#define BMS_HOT_STATE_BUDGET 16
+
+//sizeof the whole BMS object and of its hot part, for the boot report
+extern const ubyte2 BMS_stateBytes;
+extern const ubyte2 BMS_hotStateBytes;
+
 BatteryManagementSystem* BMS_new(SerialManager* serialMan, ubyte2 canMessageBaseID);
 void BMS_parseCanMessage(BatteryManagementSystem* bms, IO_CAN_DATA_FRAME* bmsCanMessage);
 
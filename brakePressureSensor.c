@@ -1,8 +1,8 @@
-#include <stdlib.h>  //Needed for malloc
 #include <math.h>
 #include "IO_RTC.h"
 
 #include "brakePressureSensor.h"
+#include "memoryArena.h"
 #include "mathFunctions.h"
 
 #include "sensors.h"
@@ -17,7 +17,7 @@
 ****************************************************************************/
 BrakePressureSensor* BrakePressureSensor_new(void)
 {
-    BrakePressureSensor* me = (BrakePressureSensor*)malloc(sizeof(struct _BrakePressureSensor));
+    BrakePressureSensor* me = (BrakePressureSensor*)MemoryArena_alloc(sizeof(struct _BrakePressureSensor));
     //me->bench = benchMode;
 
     //TODO: Make sure the main loop is running before doing this
@@ -107,14 +107,24 @@ void BrakePressureSensor_resetCalibration(BrakePressureSensor* me)
     me->calibrated = TRUE;
 }
 
-void BrakePressureSensor_saveCalibrationToEEPROM(BrakePressureSensor* me)
+void BrakePressureSensor_saveCalibrationToEEPROM(BrakePressureSensor* me, EEPROMManager* eep)
 {
-
+    EEPROMManager_set(eep, EEPROMSlot_bps0_calibMin, me->bps0_calibMin);
+    EEPROMManager_set(eep, EEPROMSlot_bps0_calibMax, me->bps0_calibMax);
 }
 
-void BrakePressureSensor_loadCalibrationFromEEPROM(BrakePressureSensor* me)
+void BrakePressureSensor_loadCalibrationFromEEPROM(BrakePressureSensor* me, EEPROMManager* eep)
 {
+    ubyte4 bps0Min, bps0Max;
 
+    if (EEPROMManager_get(eep, EEPROMSlot_bps0_calibMin, &bps0Min)
+        && EEPROMManager_get(eep, EEPROMSlot_bps0_calibMax, &bps0Max)
+        && bps0Min < bps0Max)
+    {
+        me->bps0_calibMin = bps0Min;
+        me->bps0_calibMax = bps0Max;
+        me->calibrated = TRUE;
+    }
 }
 
 void BrakePressureSensor_startCalibration(BrakePressureSensor* me, ubyte1 secondsToRun)
@@ -124,12 +134,12 @@ void BrakePressureSensor_startCalibration(BrakePressureSensor* me, ubyte1 second
         me->runCalibration = TRUE;
         BrakePressureSensor_resetCalibration(me);
         me->calibrated = FALSE;
-        IO_RTC_StartTime(&(me->timestamp_calibrationStart));
+        me->timestamp_calibrationStart = CycleClock_now();
         me->calibrationRunTime = secondsToRun;
     }
     else
     {
-        IO_RTC_StartTime(&(me->timestamp_calibrationStart));  //extend the calibration time
+        me->timestamp_calibrationStart = CycleClock_now();  //extend the calibration time
     }
 }
 
@@ -148,7 +158,7 @@ void BrakePressureSensor_calibrationCycle(BrakePressureSensor* me, ubyte1* error
 {
     if (me->runCalibration == TRUE)
     {
-        if (IO_RTC_GetTimeUS(me->timestamp_calibrationStart) < (ubyte4)(me->calibrationRunTime) * 1000 * 1000)
+        if (CycleClock_since(me->timestamp_calibrationStart) < (ubyte4)(me->calibrationRunTime) * 1000 * 1000)
         {
 			//The calibration itself
 			if (me->bps0->sensorValue < me->bps0_calibMin) { me->bps0_calibMin = me->bps0->sensorValue; }
@@ -181,7 +191,7 @@ void BrakePressureSensor_calibrationCycle(BrakePressureSensor* me, ubyte1* error
         //TODO: Throw warning: calibrationCycle helper function was called but calibration should not be running
     }
 
-    //TODO: Write calibration data to EEPROM
+    //Calibration data is written to EEPROM by main once runCalibration goes FALSE
 
     //TODO: Check for valid/reasonable calibration data
 
@@ -228,7 +238,7 @@ void BrakePressureSensor_getIndividualSensorPercent(BrakePressureSensor* me, uby
 * Throws:      000 - TPS0 voltage out of range
 *              001 - TPS1 voltage out of range, 002
 -------------------------------------------------------------------*/
-void BrakePressureSensor_getPedalTravel(BrakePressureSensor* me, ubyte1* errorCount, float4* pedalPercent)
+void BrakePressureSensor_getPedalTravel(const BrakePressureSensor* me, ubyte1* errorCount, float4* pedalPercent)
 {
 	*pedalPercent = me->percent;
 
@@ -3,6 +3,8 @@
 
 #include "IO_Driver.h"
 #include "sensors.h"
+#include "eepromManager.h"
+#include "cycleClock.h"
 
 //After update(), access to tps Sensor objects should no longer be necessary.
 //In other words, only updateFromSensors itself should use the tps Sensor objects
@@ -28,7 +30,7 @@ typedef struct _BrakePressureSensor
 	*/
 
     bool runCalibration;
-    ubyte4 timestamp_calibrationStart;
+    ubyte8 timestamp_calibrationStart;
     ubyte1 calibrationRunTime;
 
     bool calibrated;
@@ -40,10 +42,10 @@ BrakePressureSensor* BrakePressureSensor_new(void);
 void BrakePressureSensor_update(BrakePressureSensor* me, bool bench);
 void BrakePressureSensor_getIndividualSensorPercent(BrakePressureSensor* me, ubyte1 sensorNumber, float4* percent);
 void BrakePressureSensor_resetCalibration(BrakePressureSensor* me);
-void BrakePressureSensor_saveCalibrationToEEPROM(BrakePressureSensor* me);
-void BrakePressureSensor_loadCalibrationFromEEPROM(BrakePressureSensor* me);
+void BrakePressureSensor_saveCalibrationToEEPROM(BrakePressureSensor* me, EEPROMManager* eep);
+void BrakePressureSensor_loadCalibrationFromEEPROM(BrakePressureSensor* me, EEPROMManager* eep);  //Keeps the defaults if nothing valid is stored
 void BrakePressureSensor_startCalibration(BrakePressureSensor* me, ubyte1 secondsToRun);
 void BrakePressureSensor_calibrationCycle(BrakePressureSensor* me, ubyte1* errorCount);
-void BrakePressureSensor_getPedalTravel(BrakePressureSensor* me, ubyte1* errorCount, float4* pedalPercent);
+void BrakePressureSensor_getPedalTravel(const BrakePressureSensor* me, ubyte1* errorCount, float4* pedalPercent);
 
 #endif //  _BRAKEPRESSURESENSOR_H
\ No newline at end of file
@@ -1,6 +1,3 @@
-
-#include <stdlib.h> //malloc
-
 #include "IO_Driver.h" 
 #include "IO_CAN.h"
 #include "IO_RTC.h"
@@ -8,12 +5,80 @@
 #include "mathFunctions.h"
 #include "sensors.h"
 #include "canManager.h"
+#include "memoryArena.h"
+#include "cycleClock.h"
+#include "canRxRing.h"
 #include "avlTree.h"
 #include "motorController.h"
 #include "bms.h"
 #include "safety.h"
 #include "wheelSpeeds.h"
 #include "serial.h"
+#include "parameterTable.h"
+#include "dataAcquisition.h"
+#include "dataLogger.h"
+#include "profiler.h"
+
+#define TELEMETRY_SLOW_ID 0x503     //Multiplexed slow telemetry (see canOutput_sendDebugMessage)
+#define TELEMETRY_SLOW_PAGES 3
+#define BOOT_TIMING_ID 0x5F3
+#define DEBUG_MESSAGE_FRAMES 4      //0x500-0x503
+#define DEBUG_RESPONSE_MAX 8        //0x5FE service responses queued per cycle (extra requests are dropped)
+#define CAN_OUTPUT_FRAMES_MAX 21    //Largest batch a canOutput_* function builds in outputBuffer
+#define MCM_COMMAND_ID 0xC0
+#define CAN_HEALTH_ID 0x5F1         //See canOutput_sendCanHealth
+#define CAN_HEALTH_PERIOD_US 1000000
+#define LATENCY_ID 0x5F2            //See canOutput_sendLatency
+#define LATENCY_PERIOD_US 1000000
+
+/*****************************************************************************
+* Receive acceptance filtering
+******************************************************************************
+* Every ID range some object listens for (see CanManager_dispatch) gets a read
+* FIFO of its own on each channel, with the narrowest ID/mask filter that
+* covers the range.  Frames nobody subscribes to are dropped by the CAN
+* controller and never reach RAM.  A channel's read messageLimit is shared
+* out between its FIFOs by weight, but every FIFO gets at least one slot, so
+* a read limit below the number of ranges is raised to it.  Add a range here
+* when a new message is parsed, or it will never arrive.
+*
+* This also narrows the CAN0 -> CAN1 echo: DAQ on CAN1 only sees the frames
+* subscribed here, not everything else on CAN0.  Log CAN0 directly to see
+* the whole bus.
+****************************************************************************/
+typedef struct _CanSubscription
+{
+    ubyte2 firstID;
+    ubyte2 lastID;
+    ubyte1 weight;      //Share of the channel's read FIFO space
+} CanSubscription;
+
+static const CanSubscription subscriptions[] =
+{
+      { 0x0A0, 0x0AF, 6 }   //RMS inverter (mask 0x7F0)
+    , { 0x620, 0x629, 2 }   //Elithion BMS (0x620/0x7F0 - 0x62A-0x62F also pass and are ignored)
+    , { 0x5FF, 0x5FF, 2 }   //VCU debug requests
+};
+#define CAN_SUBSCRIPTION_COUNT (sizeof(subscriptions) / sizeof(subscriptions[0]))
+COMPILE_TIME_ASSERT(CAN_SUBSCRIPTION_COUNT <= CAN_FIFO_MESSAGES_MAX, subscriptionsFitReadLimit);
+
+//Driver results for one channel, counted by CanManager_readFIFO/writeFIFO (and
+//oldData by CanManager_read).  The error counters are cumulative and wrap; the
+//host diffs consecutive health frames.
+typedef struct _CanChannelHealth
+{
+    ubyte2 fifoFull;            //Reads that found the receive FIFO had overflowed
+    ubyte2 oldData;             //CanManager_read calls (one per cycle) that found no frames at all
+    ubyte2 busOff;              //Reads or writes that reported bus off
+    ubyte1 errorWarning;        //Reads or writes that reported error passive/warning
+    ubyte2 writeFailures;       //Writes that returned anything but IO_E_OK
+    ubyte1 maxFifoFill;         //Most frames a single read returned
+
+    ubyte2 framesIn;            //This cycle (see canOutput_sendCanHealth)
+    ubyte2 framesOut;
+    ubyte2 maxFramesIn;         //Busiest cycle since the last health frame
+    ubyte2 maxFramesOut;
+} CanChannelHealth;
 
 
 struct _CanManager {
@@ -30,14 +95,17 @@ struct _CanManager {
     //specified by this parameter.  The CAN0/CAN1 is selected based on the parameter passed in, and 
     //Read/Write is selected based on the function that is being called (get/send)
     ubyte1 can0_busSpeed;
-    ubyte1 can0_readHandle;
     ubyte1 can0_read_messageLimit;
     ubyte1 can0_writeHandle;
     ubyte1 can0_write_messageLimit;
+    ubyte1 can0_commandHandle;      //Message object of its own for MCM_COMMAND_ID (see canOutput_sendMCMCommand)
 
     ubyte1 can1_busSpeed;
-    ubyte1 can1_readHandle;
     ubyte1 can1_read_messageLimit;
+
+    //One read FIFO per subscription, indexed by [CanChannel][subscription]
+    ubyte1 readHandles[2][CAN_SUBSCRIPTION_COUNT];
+    ubyte1 readSizes[2][CAN_SUBSCRIPTION_COUNT];
     ubyte1 can1_writeHandle;
     ubyte1 can1_write_messageLimit;
     
@@ -46,6 +114,7 @@ struct _CanManager {
 
     IO_ErrorType ioErr_can0_fifoInit_R;
     IO_ErrorType ioErr_can0_fifoInit_W;
+    IO_ErrorType ioErr_can0_commandInit;
     IO_ErrorType ioErr_can1_fifoInit_R;
     IO_ErrorType ioErr_can1_fifoInit_W;
 
@@ -56,11 +125,44 @@ struct _CanManager {
 
     ubyte4 sendDelayus;
 
+    //Frame buffers live here rather than on the stack: CanManager_read echoes
+    //its frames through CanManager_send, so as locals they would be nested
+    //(2 x CAN_FIFO_MESSAGES_MAX frames) on top of whatever called read.
+    IO_CAN_DATA_FRAME readBuffer[CAN_FIFO_MESSAGES_MAX];
+    IO_CAN_DATA_FRAME sendBuffer[CAN_FIFO_MESSAGES_MAX];
+    //Debug responses and DAQ build a whole batch before one write.  main calls
+    //them one after the other, so they share this instead of the stack.
+    IO_CAN_DATA_FRAME outputBuffer[CAN_OUTPUT_FRAMES_MAX];
+
+    //CAN0 receive path: CanManager_poll moves the hardware FIFO into the ring,
+    //CanManager_read drains it.  pollBuffer is the producer's own FIFO buffer.
+    CanRxRing* can0_rxRing;
+    IO_CAN_DATA_FRAME pollBuffer[CAN_FIFO_MESSAGES_MAX];
+    bool rxOverrunReported;
+
+    CanChannelHealth health[2];   //Indexed by CanChannel
+    ubyte8 timestamp_healthSent;
+    ubyte8 timestamp_latencySent;
+
+    ubyte1 telemetryPage;  //Next 0x503 page (see canOutput_sendDebugMessage)
+
+    //0x5FE responses from the debug services, answered in the order the requests arrived
+    ubyte1 debugResponses[DEBUG_RESPONSE_MAX][8];
+    ubyte1 debugResponseHead;   //Oldest queued response
+    ubyte1 debugResponseCount;
+
 
     //WARNING: These values are not initialized - be careful to only access
     //pointers that have been previously assigned
     //AVLNode* canMessageHistory[0x7FF];
-    AVLNode* canMessageHistory[0x7FF];
+    AVLNode* canMessageHistory[0x800];
+
+    //Incoming messages that must keep arriving (see CanManager_checkTimeouts).
+    //Only these IDs are swept each cycle - not the whole history table.
+    ubyte2 supervised_ids[CAN_SUPERVISED_MAX];
+    CanNode supervised_nodes[CAN_SUPERVISED_MAX];
+    ubyte1 supervisedCount;
+    bool supervisionStarted;    //Set by the first CanManager_checkTimeouts (see there)
 };
 
 //Keep track of CAN message IDs, their data, and when they were last sent.
@@ -77,11 +179,75 @@ struct _CanMessageNode
 };
 */
 
+//Adds an incoming message to the list of messages checked by CanManager_checkTimeouts
+static void CanManager_superviseIncoming(CanManager* me, ubyte2 messageID, CanNode node)
+{
+    if (me->supervisedCount < CAN_SUPERVISED_MAX)
+    {
+        me->supervised_ids[me->supervisedCount] = messageID;
+        me->supervised_nodes[me->supervisedCount] = node;
+        me->supervisedCount++;
+    }
+}
+
+//Narrowest ID/mask acceptance filter that passes every ID from firstID to lastID
+static void CanManager_acceptanceFilter(ubyte2 firstID, ubyte2 lastID, ubyte4* id, ubyte4* mask)
+{
+    ubyte2 differentBits = firstID ^ lastID;
+
+    *mask = 0x7FF;
+    while (differentBits != 0)
+    {
+        *mask = (*mask << 1) & 0x7FF;
+        differentBits >>= 1;
+    }
+    *id = firstID & *mask;
+}
+
+static void CanManager_configReadFIFOs(CanManager* me, CanChannel channel, ubyte1 messageLimit)
+{
+    ubyte1 totalWeight = 0;
+    ubyte1 allocated = 0;
+    ubyte4 id;
+    ubyte4 mask;
+
+    for (ubyte1 sub = 0; sub < CAN_SUBSCRIPTION_COUNT; sub++) { totalWeight += subscriptions[sub].weight; }
+
+    for (ubyte1 sub = 0; sub < CAN_SUBSCRIPTION_COUNT; sub++)
+    {
+        ubyte1 size = (ubyte2)messageLimit * subscriptions[sub].weight / totalWeight;
+        if (size == 0) { size = 1; }
+        me->readSizes[channel][sub] = size;
+        allocated += size;
+    }
+    //Rounding leftovers go to the first (busiest) range
+    if (allocated < messageLimit) { me->readSizes[channel][0] += messageLimit - allocated; }
+    //Ranges that rounded down to nothing were given a slot anyway - take those back
+    //from the largest FIFO so the channel stays within messageLimit
+    while (allocated > messageLimit)
+    {
+        ubyte1 largest = 0;
+        for (ubyte1 sub = 1; sub < CAN_SUBSCRIPTION_COUNT; sub++)
+        {
+            if (me->readSizes[channel][sub] > me->readSizes[channel][largest]) { largest = sub; }
+        }
+        me->readSizes[channel][largest]--;
+        allocated--;
+    }
+
+    for (ubyte1 sub = 0; sub < CAN_SUBSCRIPTION_COUNT; sub++)
+    {
+        CanManager_acceptanceFilter(subscriptions[sub].firstID, subscriptions[sub].lastID, &id, &mask);
+        IO_CAN_ConfigFIFO(&me->readHandles[channel][sub], (channel == CAN0_HIPRI) ? IO_CAN_CHANNEL_0 : IO_CAN_CHANNEL_1
+                        , me->readSizes[channel][sub], IO_CAN_MSG_READ, IO_CAN_STD_FRAME, id, mask);
+    }
+}
+
 CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit, ubyte1 can0_write_messageLimit
                          , ubyte2 can1_busSpeed, ubyte1 can1_read_messageLimit, ubyte1 can1_write_messageLimit
                          , ubyte4 defaultSendDelayus, SerialManager* serialMan) //ubyte4 defaultMinSendDelay, ubyte4 defaultMaxSendDelay)
 {
-	CanManager* me = (CanManager*)malloc(sizeof(struct _CanManager));
+	CanManager* me = (CanManager*)MemoryArena_alloc(sizeof(struct _CanManager));
 
     me->sm = serialMan;
     SerialManager_send(me->sm, "CanManager's reference to SerialManager was created.\n");
@@ -96,6 +262,18 @@ CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit,
 
     me->sendDelayus = defaultSendDelayus;
 
+    //FIFOs can't be bigger than the buffers we read them into
+    me->can0_read_messageLimit = (can0_read_messageLimit > CAN_FIFO_MESSAGES_MAX) ? CAN_FIFO_MESSAGES_MAX : can0_read_messageLimit;
+    me->can0_write_messageLimit = (can0_write_messageLimit > CAN_FIFO_MESSAGES_MAX) ? CAN_FIFO_MESSAGES_MAX : can0_write_messageLimit;
+    me->can1_read_messageLimit = (can1_read_messageLimit > CAN_FIFO_MESSAGES_MAX) ? CAN_FIFO_MESSAGES_MAX : can1_read_messageLimit;
+    me->can1_write_messageLimit = (can1_write_messageLimit > CAN_FIFO_MESSAGES_MAX) ? CAN_FIFO_MESSAGES_MAX : can1_write_messageLimit;
+    //...and every subscription needs a read FIFO of at least one message (see CanManager_configReadFIFOs)
+    if (me->can0_read_messageLimit < CAN_SUBSCRIPTION_COUNT) { me->can0_read_messageLimit = CAN_SUBSCRIPTION_COUNT; }
+    if (me->can1_read_messageLimit < CAN_SUBSCRIPTION_COUNT) { me->can1_read_messageLimit = CAN_SUBSCRIPTION_COUNT; }
+    me->telemetryPage = 0;
+    me->debugResponseHead = 0;
+    me->debugResponseCount = 0;
+
     //Activate the CAN channels --------------------------------------------------
     me->ioErr_can0_Init = IO_CAN_Init(IO_CAN_CHANNEL_0, can0_busSpeed, 0, 0, 0);
     me->ioErr_can1_Init = IO_CAN_Init(IO_CAN_CHANNEL_1, can1_busSpeed, 0, 0, 0);
@@ -107,10 +285,13 @@ CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit,
     //, the direction of the queue (in/out)
     //, the frame size
     //, and other stuff?
-    IO_CAN_ConfigFIFO(&me->can0_readHandle, IO_CAN_CHANNEL_0, can0_read_messageLimit, IO_CAN_MSG_READ, IO_CAN_STD_FRAME, 0, 0);
-    IO_CAN_ConfigFIFO(&me->can0_writeHandle, IO_CAN_CHANNEL_0, can0_write_messageLimit, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, 0, 0);
-    IO_CAN_ConfigFIFO(&me->can1_readHandle, IO_CAN_CHANNEL_1, can1_read_messageLimit, IO_CAN_MSG_READ, IO_CAN_STD_FRAME, 0, 0);
-    IO_CAN_ConfigFIFO(&me->can1_writeHandle, IO_CAN_CHANNEL_1, can1_write_messageLimit, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, 0, 0);
+    CanManager_configReadFIFOs(me, CAN0_HIPRI, me->can0_read_messageLimit);
+    IO_CAN_ConfigFIFO(&me->can0_writeHandle, IO_CAN_CHANNEL_0, me->can0_write_messageLimit, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, 0, 0);
+    CanManager_configReadFIFOs(me, CAN1_LOPRI, me->can1_read_messageLimit);
+    IO_CAN_ConfigFIFO(&me->can1_writeHandle, IO_CAN_CHANNEL_1, me->can1_write_messageLimit, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, 0, 0);
+
+    //The torque command gets a message object outside the FIFOs so it never queues behind telemetry
+    me->ioErr_can0_commandInit = IO_CAN_ConfigMsg(&me->can0_commandHandle, IO_CAN_CHANNEL_0, IO_CAN_MSG_WRITE, IO_CAN_STD_FRAME, MCM_COMMAND_ID, 0x7FF);
 
     //Assume read/write at error state until used
     me->ioErr_can0_read = IO_E_CAN_BUS_OFF;
@@ -118,6 +299,26 @@ CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit,
     me->ioErr_can1_read = IO_E_CAN_BUS_OFF;
     me->ioErr_can1_write = IO_E_CAN_BUS_OFF;
 
+    me->can0_rxRing = CanRxRing_new();
+    me->rxOverrunReported = FALSE;
+
+    for (ubyte1 channel = 0; channel < 2; channel++)
+    {
+        CanChannelHealth* health = &me->health[channel];
+        health->fifoFull = 0;
+        health->oldData = 0;
+        health->busOff = 0;
+        health->errorWarning = 0;
+        health->writeFailures = 0;
+        health->maxFifoFill = 0;
+        health->framesIn = 0;
+        health->framesOut = 0;
+        health->maxFramesIn = 0;
+        health->maxFramesOut = 0;
+    }
+    me->timestamp_healthSent = CYCLECLOCK_NEVER;
+    me->timestamp_latencySent = CYCLECLOCK_NEVER;
+
     //-------------------------------------------------------------------
     //Define default messages
     //-------------------------------------------------------------------
@@ -125,56 +326,117 @@ CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit,
     //insertedMessage = AVL_insert(me->canMessageHistory, 0x0C0, 0, 50000, 125000, TRUE); //MCM command message
     
     ubyte2 messageID;
+    ubyte1 emptyData[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
     //Outgoing ----------------------------
-    messageID = 0xC0;  //MCM Command Message
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 25000;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 125000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
     for (messageID = 0x500; messageID <= 0x515; messageID++)
     {
-        me->canMessageHistory[messageID]->timeBetweenMessages_Min = 50000;
-        me->canMessageHistory[messageID]->timeBetweenMessages_Max = 250000;
-        me->canMessageHistory[messageID]->required = TRUE;
-        for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-        IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
+        //Every slow telemetry page differs from the last one, so no minimum gap - otherwise pages would be skipped
+        AVL_insert(me->canMessageHistory, messageID, emptyData, (messageID == TELEMETRY_SLOW_ID) ? 0 : 50000, 250000, TRUE);
     }
 
     //Incoming ----------------------------
-    messageID = 0xAA;  //MCM ______
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 500000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
-    messageID = 0xAB;  //MCM ________
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 500000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
-    messageID = 0x623;  //BMS faults
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 5000000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
-
-    messageID = 0x629;  //BMS details
-    me->canMessageHistory[messageID]->timeBetweenMessages_Min = 0;
-    me->canMessageHistory[messageID]->timeBetweenMessages_Max = 1000000;
-    me->canMessageHistory[messageID]->required = TRUE;
-    for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[messageID]->data[i] = 0; }
-    IO_RTC_StartTime(&me->canMessageHistory[messageID]->lastMessage_timeStamp);
+    //timeBetweenMessages_Max is the longest we will go without hearing this message
+    //before CanManager_checkTimeouts reports the sending node as lost
+    me->supervisedCount = 0;
+    me->supervisionStarted = FALSE;
+
+    AVL_insert(me->canMessageHistory, 0xAA, emptyData, 0, 500000, TRUE);  //MCM internal states
+    CanManager_superviseIncoming(me, 0xAA, CanNode_MCM);
+
+    AVL_insert(me->canMessageHistory, 0xAB, emptyData, 0, 500000, TRUE);  //MCM faults
+    CanManager_superviseIncoming(me, 0xAB, CanNode_MCM);
+
+    AVL_insert(me->canMessageHistory, 0x623, emptyData, 0, 5000000, TRUE);  //BMS faults
+    CanManager_superviseIncoming(me, 0x623, CanNode_BMS);
+
+    AVL_insert(me->canMessageHistory, 0x629, emptyData, 0, 1000000, TRUE);  //BMS details
+    CanManager_superviseIncoming(me, 0x629, CanNode_BMS);
 
 	return me;
 }
 
 
+/*****************************************************************************
+* FIFO access
+******************************************************************************
+* Every IO_CAN_ReadFIFO/WriteFIFO goes through these two so the result is
+* both kept as the channel's last status (CanManager_getReadStatus) and
+* counted in its health (canOutput_sendCanHealth).
+****************************************************************************/
+static void CanManager_countError(CanChannelHealth* health, IO_ErrorType result)
+{
+    switch (result)
+    {
+    case IO_E_CAN_BUS_OFF:
+        health->busOff++;
+        break;
+    case IO_E_CAN_ERROR_PASSIVE:
+    case IO_E_CAN_ERROR_WARNING:
+        health->errorWarning++;
+        break;
+    default:
+        break;
+    }
+}
+
+//Reads all of a channel's subscription FIFOs into canMessages (which must hold the
+//channel's read messageLimit).  Frames are grouped by FIFO, so they are only in
+//arrival order per ID range.  Returns OLD_DATA if every FIFO was empty, otherwise
+//the last real error, or IO_E_OK.
+static IO_ErrorType CanManager_readFIFO(CanManager* me, CanChannel channel, IO_CAN_DATA_FRAME canMessages[], ubyte1* canMessageCount)
+{
+    CanChannelHealth* health = &me->health[channel];
+    IO_ErrorType channelResult = IO_E_CAN_OLD_DATA;
+
+    *canMessageCount = 0;
+    for (ubyte1 sub = 0; sub < CAN_SUBSCRIPTION_COUNT; sub++)
+    {
+        ubyte1 fifoCount = 0;
+        IO_ErrorType result = IO_CAN_ReadFIFO(me->readHandles[channel][sub], &canMessages[*canMessageCount], me->readSizes[channel][sub], &fifoCount);
+
+        //OLD_DATA is the normal result of every idle poll, so it is counted per cycle in CanManager_read instead
+        if (result == IO_E_CAN_FIFO_FULL) { health->fifoFull++; }
+        else if (result != IO_E_CAN_OLD_DATA) { CanManager_countError(health, result); }
+
+        if (fifoCount > health->maxFifoFill) { health->maxFifoFill = fifoCount; }
+        *canMessageCount += fifoCount;
+
+        if (result != IO_E_OK && result != IO_E_CAN_OLD_DATA) { channelResult = result; }
+        else if (result == IO_E_OK && channelResult == IO_E_CAN_OLD_DATA) { channelResult = IO_E_OK; }
+    }
+
+    *((channel == CAN0_HIPRI) ? &me->ioErr_can0_read : &me->ioErr_can1_read) = channelResult;
+    return channelResult;
+}
+
+static IO_ErrorType CanManager_writeFIFO(CanManager* me, CanChannel channel, IO_CAN_DATA_FRAME canMessages[], ubyte1 canMessageCount)
+{
+    CanChannelHealth* health = &me->health[channel];
+    IO_ErrorType result;
+
+    if (channel == CAN0_HIPRI)
+    {
+        result = me->ioErr_can0_write = IO_CAN_WriteFIFO(me->can0_writeHandle, canMessages, canMessageCount);
+    }
+    else
+    {
+        result = me->ioErr_can1_write = IO_CAN_WriteFIFO(me->can1_writeHandle, canMessages, canMessageCount);
+    }
+
+    if (result == IO_E_OK)
+    {
+        health->framesOut += canMessageCount;
+    }
+    else
+    {
+        health->writeFailures++;
+        CanManager_countError(health, result);
+    }
+
+    return result;
+}
+
+
 /*****************************************************************************
 * This function takes an array of messages, determines which messages to send
 * based on whether or not data has changed since the last time it was sent,
@@ -193,7 +455,9 @@ IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRA
     ubyte2 serialMessageID = 0xC0;
     bool sendMessage = FALSE;
     ubyte1 messagesToSendCount = 0;
-    IO_CAN_DATA_FRAME messagesToSend[canMessageCount];//[channel == CAN0_HIPRI ? me->can0_write_messageLimit : me->can1_write_messageLimit];
+    IO_CAN_DATA_FRAME* messagesToSend = me->sendBuffer;
+
+    if (canMessageCount > CAN_FIFO_MESSAGES_MAX) { canMessageCount = CAN_FIFO_MESSAGES_MAX; }
 
     //----------------------------------------------------------------------------
     // Check if message exists in outgoing message history tree
@@ -214,15 +478,13 @@ IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRA
         //----------------------------------------------------------------------------
         // Check if this message exists in the array
         //----------------------------------------------------------------------------
-        firstTimeMessage = (me->canMessageHistory[outboundMessageID] == 0);  //############################## ALWAYS FALSE? ##############################
+        firstTimeMessage = (lastMessage == 0);
         if (firstTimeMessage)
         {
-            me->canMessageHistory[outboundMessageID]->timeBetweenMessages_Min = 25000;
-            me->canMessageHistory[outboundMessageID]->timeBetweenMessages_Max = 125000;
-            me->canMessageHistory[outboundMessageID]->required = TRUE;
-            for (ubyte1 i = 0; i <= 7; i++) { me->canMessageHistory[outboundMessageID]->data[i] = 0; }
-            //IO_RTC_StartTime(&me->canMessageHistory[outboundMessageID]->lastMessage_timeStamp);
-            me->canMessageHistory[outboundMessageID]->lastMessage_timeStamp = 0;
+            ubyte1 emptyData[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+            lastMessage = AVL_insert(me->canMessageHistory, outboundMessageID, emptyData, 25000, 125000, FALSE);
+            if (lastMessage == 0) { continue; }  //Out of memory - drop the message rather than crash
+            lastMessage->lastMessage_timeStamp = 0;
         }
 
         //----------------------------------------------------------------------------
@@ -248,8 +510,8 @@ IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRA
         //----------------------------------------------------------------------------
         // Check if time has exceeded
         //----------------------------------------------------------------------------
-        minTimeExceeded = ((IO_RTC_GetTimeUS(lastMessage->lastMessage_timeStamp) >= lastMessage->timeBetweenMessages_Min));
-        maxTimeExceeded = ((IO_RTC_GetTimeUS(lastMessage->lastMessage_timeStamp) >= 50000));//lastMessage->timeBetweenMessages_Max));
+        minTimeExceeded = ((CycleClock_since(lastMessage->lastMessage_timeStamp) >= lastMessage->timeBetweenMessages_Min));
+        maxTimeExceeded = ((CycleClock_since(lastMessage->lastMessage_timeStamp) >= 50000));//lastMessage->timeBetweenMessages_Max));
         
         //----------------------------------------------------------------------------
         // If any criteria were exceeded, send the message out
@@ -288,11 +550,10 @@ IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRA
     if (messagesToSendCount > 0)
     {
         //Send the messages to send to the appropriate FIFO queue
-        sendResult = IO_CAN_WriteFIFO((channel == CAN0_HIPRI) ? me->can0_writeHandle : me->can1_writeHandle, messagesToSend, messagesToSendCount);
-        *((channel == CAN0_HIPRI) ? &me->ioErr_can0_write : &me->ioErr_can1_write) = sendResult;
+        sendResult = CanManager_writeFIFO(me, channel, messagesToSend, messagesToSendCount);
 
         //Update the outgoing message tree with message sent timestamps
-        if ((channel == CAN0_HIPRI ? me->ioErr_can0_write : me->ioErr_can1_write) == IO_E_OK)
+        if (sendResult == IO_E_OK)
         {
             //Loop through the messages that we sent...
             ///////////AVLNode* messageToUpdate;
@@ -304,7 +565,7 @@ IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRA
                 //and update the message sent timestamp
                 /////////////IO_RTC_GetTimeUS(messageToUpdate->lastMessage_timeStamp); //Update the timestamp for when the message was last sent
                 //IO_RTC_GetTimeUS(me->canMessageHistory[messagesToSend[messagePosition].id]->lastMessage_timeStamp);
-                IO_RTC_StartTime(&me->canMessageHistory[messagesToSend[messagePosition].id]->lastMessage_timeStamp);
+                me->canMessageHistory[messagesToSend[messagePosition].id]->lastMessage_timeStamp = CycleClock_now();
             }
         }
     }
@@ -313,7 +574,7 @@ IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRA
 
 /*
 //Helper functions
-ubyte4 CanManager_timeSinceLastTransmit(IO_CAN_DATA_FRAME* canMessage)  //Overflows/resets at 74 min
+ubyte4 CanManager_timeSinceLastTransmit(IO_CAN_DATA_FRAME* canMessage)  //See CycleClock_since
 bool CanManager_enoughTimeSinceLastTransmit(IO_CAN_DATA_FRAME* canMessage) // timesincelast > timeBetweenMessages_Min
 bool CanManager_dataChangedSinceLastTransmit(IO_CAN_DATA_FRAME* canMessage) //bitwise comparison for all data bytes
 */
@@ -321,77 +582,193 @@ bool CanManager_dataChangedSinceLastTransmit(IO_CAN_DATA_FRAME* canMessage) //bi
 
 /*****************************************************************************
 * read
+******************************************************************************
+* CanManager_read only moves frames out of the FIFO; everything a frame does
+* happens in CanManager_dispatch, so frames from somewhere other than the
+* FIFO (e.g. a recorded trace on a bench/host harness) take the same path.
 ****************************************************************************/
-void CanManager_read(CanManager* me, CanChannel channel, MotorController* mcm, BatteryManagementSystem* bms, SafetyChecker* sc)
+//0x5FF: debug service requests, or the original safety bypass/HVIL override commands
+//Next free (zeroed) 0x5FE response slot, or NULL if this cycle's queue is full
+static ubyte1* CanManager_queueDebugResponse(CanManager* me)
 {
-    IO_CAN_DATA_FRAME canMessages[(channel == CAN0_HIPRI ? me->can0_read_messageLimit : me->can1_read_messageLimit)];
-    ubyte1 canMessageCount;  //FIFO queue only holds 128 messages max
+    ubyte1* response;
 
-	//Read messages from hipri channel 
-	*(channel == CAN0_HIPRI ? &me->ioErr_can0_read : &me->ioErr_can1_read) =
-    IO_CAN_ReadFIFO((channel == CAN0_HIPRI ? me->can0_readHandle : me->can1_writeHandle)
-                    , canMessages
-                    , (channel == CAN0_HIPRI ? me->can0_read_messageLimit : me->can1_read_messageLimit)
-                    , &canMessageCount);
+    if (me->debugResponseCount >= DEBUG_RESPONSE_MAX) { return NULL; }
+    response = me->debugResponses[(me->debugResponseHead + me->debugResponseCount) % DEBUG_RESPONSE_MAX];
+    me->debugResponseCount++;
 
-	//Determine message type based on ID
-	for (int currMessage = 0; currMessage < canMessageCount; currMessage++)
+    for (ubyte1 i = 0; i < 8; i++) { response[i] = 0; }
+    return response;
+}
+
+static void CanManager_dispatchDebugRequest(CanManager* me, const CanReceivers* rx, IO_CAN_DATA_FRAME* canMessage)
+{
+    ubyte1* response;
+
+    switch (canMessage->data[0])
+    {
+    case DebugService_FaultHistory:
+        SafetyChecker_requestFaultHistory(rx->sc, canMessage->data[1]);
+        break;
+
+    case DebugService_FreezeFrame:
+        SafetyChecker_requestFreezeFrame(rx->sc, canMessage->data[1]);
+        break;
+
+    case DebugService_ParameterRead:
+    case DebugService_ParameterWrite:
+    case DebugService_ParameterInfo:
+        if ((response = CanManager_queueDebugResponse(me)) != NULL) { ParameterTable_handleRequest(rx->params, canMessage, response); }
+        break;
+
+    case DebugService_DAQClear:
+    case DebugService_DAQAdd:
+    case DebugService_DAQStart:
+        if ((response = CanManager_queueDebugResponse(me)) != NULL) { DAQ_handleRequest(rx->daq, canMessage, response); }
+        break;
+
+    case DebugService_LoggerChannel:
+    case DebugService_LoggerControl:
+        if ((response = CanManager_queueDebugResponse(me)) != NULL) { DataLogger_handleRequest(rx->logger, canMessage, response); }
+        break;
+
+    case DebugService_Profile:
+        if ((response = CanManager_queueDebugResponse(me)) != NULL) { Profiler_handleRequest(rx->profiler, canMessage, response); }
+        break;
+
+    default:
+        SafetyChecker_parseCanMessage(rx->sc, canMessage);
+        MCM_parseCanMessage(rx->mcm, canMessage);
+        break;
+    }
+}
+
+void CanManager_dispatch(CanManager* me, const CanReceivers* rx, IO_CAN_DATA_FRAME* canMessage)
+{
+    //Timestamp every message we are keeping history for (used by CanManager_checkTimeouts)
+    AVLNode* history = me->canMessageHistory[canMessage->id & 0x7FF];
+    if (history != 0)
+    {
+        history->lastMessage_timeStamp = CycleClock_now();
+    }
+
+	switch (canMessage->id)
 	{
-		switch (canMessages[currMessage].id)
-		{
-        //-------------------------------------------------------------------------
-        //Motor controller
-        //-------------------------------------------------------------------------
-        case 0xA0:
-        case 0xA1:
-        case 0xA2:
-        case 0xA3:
-        case 0xA4:
-        case 0xA5:
-        case 0xA6:
-        case 0xA7:
-        case 0xA8:
-        case 0xA9:
-		case 0xAA:
-		case 0xAB:
-        case 0xAC:
-        case 0xAD:
-        case 0xAE:
-        case 0xAF:
-            MCM_parseCanMessage(mcm, &canMessages[currMessage]);
-            break;
-
-		//-------------------------------------------------------------------------
-		//BMS
-		//-------------------------------------------------------------------------
-		case 0x620:
-		case 0x621:
-		case 0x622:
-		case 0x623:
-		case 0x624:
-		case 0x625:
-		case 0x626:
-        case 0x627:
-        case 0x628:
-        case 0x629:
-            BMS_parseCanMessage(bms, &canMessages[currMessage]);
-			break;
-			
-		//-------------------------------------------------------------------------
-		//VCU Debug Control
-		//-------------------------------------------------------------------------
-		case 0x5FF:
-			SafetyChecker_parseCanMessage(sc, &canMessages[currMessage]);
-            MCM_parseCanMessage(mcm, &canMessages[currMessage]);
-			break;
-			//default:
-		}
+    //-------------------------------------------------------------------------
+    //Motor controller
+    //-------------------------------------------------------------------------
+    case 0xA0:
+    case 0xA1:
+    case 0xA2:
+    case 0xA3:
+    case 0xA4:
+    case 0xA5:
+    case 0xA6:
+    case 0xA7:
+    case 0xA8:
+    case 0xA9:
+	case 0xAA:
+	case 0xAB:
+    case 0xAC:
+    case 0xAD:
+    case 0xAE:
+    case 0xAF:
+        MCM_parseCanMessage(rx->mcm, canMessage);
+        break;
+
+	//-------------------------------------------------------------------------
+	//BMS
+	//-------------------------------------------------------------------------
+	case 0x620:
+	case 0x621:
+	case 0x622:
+	case 0x623:
+	case 0x624:
+	case 0x625:
+	case 0x626:
+    case 0x627:
+    case 0x628:
+    case 0x629:
+        BMS_parseCanMessage(rx->bms, canMessage);
+		break;
+		
+	//-------------------------------------------------------------------------
+	//VCU Debug Control
+	//-------------------------------------------------------------------------
+	case 0x5FF:
+        CanManager_dispatchDebugRequest(me, rx, canMessage);
+		break;
 	}
+}
+
+/*****************************************************************************
+* Receive
+******************************************************************************
+* CAN0 frames reach the objects in two steps.  CanManager_poll (producer) empties
+* the hardware FIFO into the receive ring - main calls it while waiting for the
+* next cycle, so the FIFO never has to hold more than a fraction of a cycle of
+* traffic.  CanManager_read (consumer) polls once more, then dispatches every
+* frame in the ring.  CAN1 is still read straight from its FIFO.
+****************************************************************************/
+void CanManager_poll(CanManager* me)
+{
+    ubyte1 canMessageCount;
 
-	//Echo message on lopri channel
-	//IO_CAN_WriteFIFO(me->can1_writeHandle, canMessages, messagesReceived);
-    CanManager_send(me, CAN1_LOPRI, canMessages, canMessageCount);
-    //IO_CAN_WriteMsg(canFifoHandle_LoPri_Write, canMessages);
+    CanManager_readFIFO(me, CAN0_HIPRI, me->pollBuffer, &canMessageCount);
+
+    for (ubyte1 currMessage = 0; currMessage < canMessageCount; currMessage++)
+    {
+        CanRxRing_push(me->can0_rxRing, &me->pollBuffer[currMessage]);
+    }
+}
+
+void CanManager_read(CanManager* me, CanChannel channel, const CanReceivers* rx)
+{
+    IO_CAN_DATA_FRAME* canMessages = me->readBuffer;
+    ubyte1 canMessageCount;  //FIFO queue only holds 128 messages max
+    ubyte2 framesRead = 0;
+
+    if (channel == CAN1_LOPRI)
+    {
+        CanManager_readFIFO(me, CAN1_LOPRI, canMessages, &canMessageCount);
+        me->health[CAN1_LOPRI].framesIn += canMessageCount;
+        if (canMessageCount == 0) { me->health[CAN1_LOPRI].oldData++; }
+        for (ubyte1 currMessage = 0; currMessage < canMessageCount; currMessage++)
+        {
+            CanManager_dispatch(me, rx, &canMessages[currMessage]);
+        }
+        return;
+    }
+
+    CanManager_poll(me);
+
+    //Drain the ring a buffer at a time so each batch can be echoed with one send
+    do
+    {
+        canMessageCount = 0;
+        while (canMessageCount < CAN_FIFO_MESSAGES_MAX
+               && CanRxRing_pop(me->can0_rxRing, &canMessages[canMessageCount]))
+        {
+            CanManager_dispatch(me, rx, &canMessages[canMessageCount]);
+            canMessageCount++;
+        }
+        me->health[CAN0_HIPRI].framesIn += canMessageCount;
+        framesRead += canMessageCount;
+
+        //Echo message on lopri channel (subscribed IDs only - see subscriptions)
+        //IO_CAN_WriteFIFO(me->can1_writeHandle, canMessages, messagesReceived);
+        if (canMessageCount > 0) { CanManager_send(me, CAN1_LOPRI, canMessages, canMessageCount); }
+        //IO_CAN_WriteMsg(canFifoHandle_LoPri_Write, canMessages);
+    } while (canMessageCount == CAN_FIFO_MESSAGES_MAX);
+
+    if (framesRead == 0) { me->health[CAN0_HIPRI].oldData++; }
+
+    if (me->rxOverrunReported == FALSE
+        && (CanRxRing_getDropped(me->can0_rxRing) > 0 || me->health[CAN0_HIPRI].fifoFull > 0))
+    {
+        SerialManager_send(me->sm, "CAN0 receive overrun - frames were lost\n");
+        me->rxOverrunReported = TRUE;
+    }
 }
 
 ubyte1 CanManager_getReadStatus(CanManager* me, CanChannel channel)
@@ -399,6 +776,46 @@ ubyte1 CanManager_getReadStatus(CanManager* me, CanChannel channel)
     return (channel == CAN0_HIPRI) ? me->ioErr_can0_read : me->ioErr_can1_read;
 }
 
+/*****************************************************************************
+* Receive timeout supervisor
+******************************************************************************
+* Walks only the supervised incoming IDs (not the whole history table) and
+* flags a node as stale if any of its required messages has not been received
+* within that message's timeBetweenMessages_Max.  Call once per cycle after
+* CanManager_read.
+*
+* The history nodes are stamped when CanManager_new creates them, before the
+* main loop's first CycleClock_update, so boot (sensor wait, EEPROM load)
+* would count against every timeout.  The first call restarts them all from
+* the current cycle instead.
+****************************************************************************/
+void CanManager_checkTimeouts(CanManager* me, SafetyChecker* sc)
+{
+    ubyte1 staleNodes = 0;
+
+    if (me->supervisionStarted == FALSE)
+    {
+        for (ubyte1 i = 0; i < me->supervisedCount; i++)
+        {
+            AVLNode* message = me->canMessageHistory[me->supervised_ids[i]];
+            if (message != 0) { message->lastMessage_timeStamp = CycleClock_now(); }
+        }
+        me->supervisionStarted = TRUE;
+    }
+
+    for (ubyte1 i = 0; i < me->supervisedCount; i++)
+    {
+        AVLNode* message = me->canMessageHistory[me->supervised_ids[i]];
+        if (message != 0 && message->required == TRUE
+            && CycleClock_since(message->lastMessage_timeStamp) > message->timeBetweenMessages_Max)
+        {
+            staleNodes |= me->supervised_nodes[i];
+        }
+    }
+
+    SafetyChecker_setCanTimeouts(sc, staleNodes);
+}
+
 
 
 
@@ -422,16 +839,69 @@ void canOutput_sendSensorMessages(CanManager* me)
 //----------------------------------------------------------------------------
 // 
 //----------------------------------------------------------------------------
-void canOutput_sendDebugMessage(CanManager* me, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm, WheelSpeeds* wss, SafetyChecker* sc)
+/*****************************************************************************
+* Debug telemetry (0x500-0x503)
+******************************************************************************
+* Signals are packed to their real bit widths, LSB first (Intel order), with
+* each signal starting at the bit after the previous one.  Values too large
+* for their width are clamped to the largest value that fits.
+*
+* 0x500 (every cycle)  throttle % (8)  brake % (8)  tps0 % (8)  tps1 % (8)
+*                      tps0 mV (13)  tps1 mV (13)  HVIL term sense (1)
+*                      HVIL override (1)  regen mode (3)
+* 0x501 (every cycle)  bps mV (13)  wheel speed FL/FR/RL/RR (12 each, 0.02 m/s)
+* 0x502 (every cycle)  faults (32)  warnings (16)  notices (16)
+* 0x503 (one page per cycle, round-robin) byte 0 = page
+*   page 0             tps0 calib min/max (13 each)  tps1 calib min/max (13 each)
+*   page 1             bps calib min/max (13 each)  LV battery mV (15)  LV SOC % (7)
+*   page 2             regen torque limit DNm (12)  regen torque at zero pedal DNm (12)
+*                      regen APPS for coasting (8)  regen BPS for max regen (8)
+* Pedal percents are scaled 0-0xFF.  Raw wheel frequencies are not sent - they
+* are the wheel speeds divided by a constant.
+****************************************************************************/
+static void packBits(ubyte1 data[8], ubyte1* bitPos, ubyte4 value, ubyte1 bits)
+{
+    ubyte4 maxValue = (bits >= 32) ? 0xFFFFFFFF : ((ubyte4)1 << bits) - 1;
+    if (value > maxValue) { value = maxValue; }
+
+    for (ubyte1 bit = 0; bit < bits; bit++, (*bitPos)++)
+    {
+        if (value & ((ubyte4)1 << bit))
+        {
+            data[*bitPos / 8] |= 1 << (*bitPos % 8);
+        }
+    }
+}
+
+//Clears the frame and returns it ready for packBits
+static IO_CAN_DATA_FRAME* canOutput_newTelemetryFrame(IO_CAN_DATA_FRAME canMessages[], ubyte2* canMessageCount, ubyte2 id)
+{
+    IO_CAN_DATA_FRAME* frame = &canMessages[(*canMessageCount)++];
+    frame->id_format = IO_CAN_STD_FRAME;
+    frame->id = id;
+    frame->length = 8;
+    for (ubyte1 i = 0; i < 8; i++) { frame->data[i] = 0; }
+    return frame;
+}
+
+//Regen settings are never negative, but keep a bad value from wrapping to the max
+static ubyte4 nonNegative(sbyte2 value)
 {
-    IO_CAN_DATA_FRAME canMessages[me->can0_write_messageLimit];
+    return (value < 0) ? 0 : value;
+}
+
+void canOutput_sendDebugMessage(CanManager* me, const VehicleState* state, MotorController* mcm, SafetyChecker* sc)
+{
+    const TorqueEncoder* tps = &state->tps;
+    const BrakePressureSensor* bps = &state->bps;
+    IO_CAN_DATA_FRAME canMessages[DEBUG_MESSAGE_FRAMES];
+    IO_CAN_DATA_FRAME* frame;
     ubyte1 errorCount;
     float4 tempPedalPercent;   //Pedal percent float (a decimal between 0 and 1
     ubyte1 tps0Percent;  //Pedal percent int   (a number from 0 to 100)
     ubyte1 tps1Percent;
     ubyte2 canMessageCount = 0;
-    ubyte2 canMessageID = 0x500;
-    ubyte1 byteNum;
+    ubyte1 bitPos;
 
     TorqueEncoder_getIndividualSensorPercent(tps, 0, &tempPedalPercent); //borrow the pedal percent variable
     tps0Percent = 0xFF * tempPedalPercent;
@@ -445,199 +915,502 @@ void canOutput_sendDebugMessage(CanManager* me, TorqueEncoder* tps, BrakePressur
     BrakePressureSensor_getPedalTravel(bps, &errorCount, &tempPedalPercent); //getThrottlePercent(TRUE, &errorCount);
     ubyte1 brakePercent = 0xFF * tempPedalPercent;
 
-	//500: TPS 0
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1; //500
-    canMessages[canMessageCount - 1].data[byteNum++] = throttlePercent;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps0Percent;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_TPS0.sensorValue; // tps->tps0_value;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_TPS0.sensorValue >> 8; //tps->tps0_value >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMin;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMin >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMax;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps0_calibMax >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//TPS 1
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = throttlePercent;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps1Percent;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_value;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_value >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMin;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMin >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMax;
-    canMessages[canMessageCount - 1].data[byteNum++] = tps->tps1_calibMax >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//BPS
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = brakePercent; //This should be bps0Percent, but for now bps0Percent = brakePercent
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_value;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_value >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMin;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMin >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMax;
-    canMessages[canMessageCount - 1].data[byteNum++] = bps->bps0_calibMax >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//WSS
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, FL) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, FL) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, FR) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, FR) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, RL) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, RL) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte2)(WheelSpeeds_getWheelSpeed(wss, RR) + 0.5);
-    canMessages[canMessageCount - 1].data[byteNum++] = ((ubyte2)(WheelSpeeds_getWheelSpeed(wss, RR) + 0.5)) >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//TEMP: WSS2
-	canMessageCount++;
-	byteNum = 0;
-	canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-	canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue >> 8;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue >> 16;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FL.sensorValue >> 24;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue >> 8;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue >> 16;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_FR.sensorValue >> 24;
-	canMessages[canMessageCount - 1].length = byteNum;
-
-	//TEMP: WSS3
-	canMessageCount++;
-	byteNum = 0;
-	canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-	canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;  //505
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue >> 8;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue >> 16;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RL.sensorValue >> 24;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue >> 8;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue >> 16;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_WSS_RR.sensorValue >> 24;
-	canMessages[canMessageCount - 1].length = byteNum;
-
-    //506: Safety Checker
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc);
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc) >> 16;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getFaults(sc) >> 24;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getWarnings(sc);
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getWarnings(sc) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getNotices(sc);
-    canMessages[canMessageCount - 1].data[byteNum++] = SafetyChecker_getNotices(sc) >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
-
-	//12v battery
-	float4 LVBatterySOC = 0;
-	if (Sensor_LVBattery.sensorValue < 12730)
-		LVBatterySOC = .0 + .1 * getPercent(Sensor_LVBattery.sensorValue, 9200, 12730, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 12866)
-		LVBatterySOC = .1 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12730, 12866, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 12996)
-		LVBatterySOC = .2 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12866, 12996, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13104)
-		LVBatterySOC = .3 + .1 * getPercent(Sensor_LVBattery.sensorValue, 12996, 13104, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13116)
-		LVBatterySOC = .4 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13104, 13116, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13130)
-		LVBatterySOC = .5 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13116, 13130, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13160)
-		LVBatterySOC = .6 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13130, 13160, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13270)
-		LVBatterySOC = .7 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13160, 13270, FALSE);
-	else if (Sensor_LVBattery.sensorValue < 13300)
-		LVBatterySOC = .8 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13270, 13300, FALSE);
-	else //if (Sensor_LVBattery.sensorValue < 14340)
-		LVBatterySOC = .9 + .1 * getPercent(Sensor_LVBattery.sensorValue, 13300, 14340, FALSE);
-
-	canMessageCount++;
-	byteNum = 0;
-	canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-	canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-	canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)Sensor_LVBattery.sensorValue;
-	canMessages[canMessageCount - 1].data[byteNum++] = Sensor_LVBattery.sensorValue >> 8;
-	canMessages[canMessageCount - 1].data[byteNum++] = (sbyte1)(100 * LVBatterySOC);
-	canMessages[canMessageCount - 1].length = byteNum;
-
-    //508: Regen settings
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenMode(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_getRegenTorqueLimitDNm(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenTorqueLimitDNm(mcm) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_getRegenTorqueAtZeroPedalDNm(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenTorqueAtZeroPedalDNm(mcm) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenAPPSForMaxCoastingZeroToFF(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getRegenBPSForMaxRegenZeroToFF(mcm);
-    canMessages[canMessageCount - 1].length = byteNum;
-
-    //509: MCM RTD Status
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id = canMessageID + canMessageCount - 1;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_HVILTerminationSense.sensorValue;
-    canMessages[canMessageCount - 1].data[byteNum++] = Sensor_HVILTerminationSense.sensorValue >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_getHvilOverrideStatus(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;
-    canMessages[canMessageCount - 1].length = byteNum;
+    //500: Pedals
+    frame = canOutput_newTelemetryFrame(canMessages, &canMessageCount, 0x500);
+    bitPos = 0;
+    packBits(frame->data, &bitPos, throttlePercent, 8);
+    packBits(frame->data, &bitPos, brakePercent, 8);  //This should be bps0Percent, but for now bps0Percent = brakePercent
+    packBits(frame->data, &bitPos, tps0Percent, 8);
+    packBits(frame->data, &bitPos, tps1Percent, 8);
+    packBits(frame->data, &bitPos, state->tps0.sensorValue, 13);
+    packBits(frame->data, &bitPos, tps->tps1_value, 13);
+    packBits(frame->data, &bitPos, state->hvilTermSense.sensorValue ? 1 : 0, 1);
+    packBits(frame->data, &bitPos, MCM_getHvilOverrideStatus(mcm) ? 1 : 0, 1);
+    packBits(frame->data, &bitPos, MCM_getRegenMode(mcm), 3);
+
+    //501: BPS, WSS
+    frame = canOutput_newTelemetryFrame(canMessages, &canMessageCount, 0x501);
+    bitPos = 0;
+    packBits(frame->data, &bitPos, bps->bps0_value, 13);
+    packBits(frame->data, &bitPos, (ubyte4)(state->wheelSpeed[FL] * 50 + 0.5), 12);
+    packBits(frame->data, &bitPos, (ubyte4)(state->wheelSpeed[FR] * 50 + 0.5), 12);
+    packBits(frame->data, &bitPos, (ubyte4)(state->wheelSpeed[RL] * 50 + 0.5), 12);
+    packBits(frame->data, &bitPos, (ubyte4)(state->wheelSpeed[RR] * 50 + 0.5), 12);
+
+    //502: Safety Checker
+    frame = canOutput_newTelemetryFrame(canMessages, &canMessageCount, 0x502);
+    bitPos = 0;
+    packBits(frame->data, &bitPos, SafetyChecker_getFaults(sc), 32);
+    packBits(frame->data, &bitPos, SafetyChecker_getWarnings(sc), 16);
+    packBits(frame->data, &bitPos, SafetyChecker_getNotices(sc), 16);
+
+    //503: Slow signals, one page per cycle
+    frame = canOutput_newTelemetryFrame(canMessages, &canMessageCount, TELEMETRY_SLOW_ID);
+    frame->data[0] = me->telemetryPage;
+    bitPos = 8;
+    switch (me->telemetryPage)
+    {
+    case 0:  //TPS calibration
+        packBits(frame->data, &bitPos, tps->tps0_calibMin, 13);
+        packBits(frame->data, &bitPos, tps->tps0_calibMax, 13);
+        packBits(frame->data, &bitPos, tps->tps1_calibMin, 13);
+        packBits(frame->data, &bitPos, tps->tps1_calibMax, 13);
+        break;
+
+    case 1:  //BPS calibration, 12v battery
+        {
+        float4 LVBatterySOC = 0;
+        if (state->lvBattery.sensorValue < 12730)
+            LVBatterySOC = .0 + .1 * getPercent(state->lvBattery.sensorValue, 9200, 12730, FALSE);
+        else if (state->lvBattery.sensorValue < 12866)
+            LVBatterySOC = .1 + .1 * getPercent(state->lvBattery.sensorValue, 12730, 12866, FALSE);
+        else if (state->lvBattery.sensorValue < 12996)
+            LVBatterySOC = .2 + .1 * getPercent(state->lvBattery.sensorValue, 12866, 12996, FALSE);
+        else if (state->lvBattery.sensorValue < 13104)
+            LVBatterySOC = .3 + .1 * getPercent(state->lvBattery.sensorValue, 12996, 13104, FALSE);
+        else if (state->lvBattery.sensorValue < 13116)
+            LVBatterySOC = .4 + .1 * getPercent(state->lvBattery.sensorValue, 13104, 13116, FALSE);
+        else if (state->lvBattery.sensorValue < 13130)
+            LVBatterySOC = .5 + .1 * getPercent(state->lvBattery.sensorValue, 13116, 13130, FALSE);
+        else if (state->lvBattery.sensorValue < 13160)
+            LVBatterySOC = .6 + .1 * getPercent(state->lvBattery.sensorValue, 13130, 13160, FALSE);
+        else if (state->lvBattery.sensorValue < 13270)
+            LVBatterySOC = .7 + .1 * getPercent(state->lvBattery.sensorValue, 13160, 13270, FALSE);
+        else if (state->lvBattery.sensorValue < 13300)
+            LVBatterySOC = .8 + .1 * getPercent(state->lvBattery.sensorValue, 13270, 13300, FALSE);
+        else //if (state->lvBattery.sensorValue < 14340)
+            LVBatterySOC = .9 + .1 * getPercent(state->lvBattery.sensorValue, 13300, 14340, FALSE);
+
+        packBits(frame->data, &bitPos, bps->bps0_calibMin, 13);
+        packBits(frame->data, &bitPos, bps->bps0_calibMax, 13);
+        packBits(frame->data, &bitPos, state->lvBattery.sensorValue, 15);
+        packBits(frame->data, &bitPos, (ubyte1)(100 * LVBatterySOC), 7);
+        }
+        break;
+
+    case 2:  //Regen settings
+        packBits(frame->data, &bitPos, nonNegative(MCM_getRegenTorqueLimitDNm(mcm)), 12);
+        packBits(frame->data, &bitPos, nonNegative(MCM_getRegenTorqueAtZeroPedalDNm(mcm)), 12);
+        packBits(frame->data, &bitPos, nonNegative(MCM_getRegenAPPSForMaxCoastingZeroToFF(mcm)), 8);
+        packBits(frame->data, &bitPos, nonNegative(MCM_getRegenBPSForMaxRegenZeroToFF(mcm)), 8);
+        break;
+    }
+    me->telemetryPage = (me->telemetryPage + 1) % TELEMETRY_SLOW_PAGES;
 
 	//Cooling?
 
     //510 - 51F reserved for dash
 
 
-    //Motor controller command message
-    canMessageCount++;
-    byteNum = 0;
-    canMessages[canMessageCount - 1].id_format = IO_CAN_STD_FRAME;
-    canMessages[canMessageCount - 1].id = 0xC0;
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_commands_getTorque(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_commands_getTorque(mcm) >> 8;
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;  //Speed (RPM?) - not needed - mcu should be in torque mode
-    canMessages[canMessageCount - 1].data[byteNum++] = 0;  //Speed (RPM?) - not needed - mcu should be in torque mode
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_commands_getDirection(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = (MCM_commands_getInverter(mcm) == ENABLED) ? 1 : 0; //unused/unused/unused/unused unused/unused/Discharge/Inverter Enable
-    canMessages[canMessageCount - 1].data[byteNum++] = (ubyte1)MCM_commands_getTorqueLimit(mcm);
-    canMessages[canMessageCount - 1].data[byteNum++] = MCM_commands_getTorqueLimit(mcm) >> 8;
-    canMessages[canMessageCount - 1].length = byteNum;
+    //Motor controller command message (0xC0) has its own path - see canOutput_sendMCMCommand
     //----------------------------------------------------------------------------
     //Additional sensors
     //----------------------------------------------------------------------------
 
     //Place the can messsages into the FIFO queue ---------------------------------------------------
     //IO_CAN_WriteFIFO(canFifoHandle_HiPri_Write, canMessages, canMessageCount);  //Important: Only transmit one message (the MCU message)
-    CanManager_send(me, CAN0_HIPRI, canMessages, canMessageCount);  //Important: Only transmit one message (the MCU message)
+    CanManager_send(me, CAN0_HIPRI, canMessages, canMessageCount);
     //IO_CAN_WriteFIFO(canFifoHandle_LoPri_Write, canMessages, canMessageCount);  
 
 }
+
+
+/*****************************************************************************
+* MCM command (MCM_COMMAND_ID)
+******************************************************************************
+* Written to a dedicated transmit message object as soon as
+* SafetyChecker_reduceTorque and MCM_inverterControl have run, so the command
+* never waits behind debug and telemetry frames in the CAN0 write FIFO.  Only
+* sent when MCM_commands_isSendDue says so (a real change, or the keep-alive
+* interval).  A command still pending when the next one is written is
+* replaced - only the newest torque matters.
+****************************************************************************/
+bool canOutput_sendMCMCommand(CanManager* me, MotorController* mcm)
+{
+    IO_CAN_DATA_FRAME canMessage;
+    ubyte1 byteNum = 0;
+    IO_ErrorType result;
+
+    if (!MCM_commands_isSendDue(mcm)) { return FALSE; }
+
+    canMessage.id_format = IO_CAN_STD_FRAME;
+    canMessage.id = MCM_COMMAND_ID;
+    canMessage.data[byteNum++] = (ubyte1)MCM_commands_getTorque(mcm);
+    canMessage.data[byteNum++] = MCM_commands_getTorque(mcm) >> 8;
+    canMessage.data[byteNum++] = 0;  //Speed (RPM?) - not needed - mcu should be in torque mode
+    canMessage.data[byteNum++] = 0;  //Speed (RPM?) - not needed - mcu should be in torque mode
+    canMessage.data[byteNum++] = MCM_commands_getDirection(mcm);
+    canMessage.data[byteNum++] = (MCM_commands_getInverter(mcm) == ENABLED) ? 1 : 0; //unused/unused/unused/unused unused/unused/Discharge/Inverter Enable
+    canMessage.data[byteNum++] = (ubyte1)MCM_commands_getTorqueLimit(mcm);
+    canMessage.data[byteNum++] = MCM_commands_getTorqueLimit(mcm) >> 8;
+    canMessage.length = byteNum;
+
+    result = IO_CAN_WriteMsg(me->can0_commandHandle, &canMessage);
+    if (result != IO_E_OK)
+    {
+        //Left due, so it is tried again next cycle
+        me->health[CAN0_HIPRI].writeFailures++;
+        CanManager_countError(&me->health[CAN0_HIPRI], result);
+        return FALSE;
+    }
+
+    me->health[CAN0_HIPRI].framesOut++;
+    MCM_commands_resetUpdateCountAndTime(mcm);
+    return TRUE;
+}
+
+
+/*****************************************************************************
+* Debug service responses (0x5FE)
+******************************************************************************
+* These are one-off answers to a request, so they bypass CanManager_send's
+* changed-data/min-time filtering and go straight to the FIFO.
+*
+* Fault history: 4 frames per page, one event each
+* byte 0    DebugService_FaultHistory
+* byte 1    age (0 = newest event)
+* byte 2    bits 7-6 severity (0 fault, 1 warning, 2 notice), bit 5 set, bits 4-0 flag bit number
+*           0xFF = no event this old; bytes 3-4 then hold the total event count
+* byte 3-5  timestamp (ms since boot, low 24 bits)
+* byte 6-7  context (TPS, BPS)
+*
+* Freeze frame: FREEZE_FRAME_CHUNKS frames, 6 bytes of the record each
+* byte 0    DebugService_FreezeFrame
+* byte 1    bits 7-4 age, bits 3-0 chunk number
+*           chunk 0xF = no frame that old; byte 2 then holds the frame count
+* byte 2-7  record bytes chunk*6 .. chunk*6+5, laid out as below
+*
+* Record (little endian, pedal percents scaled 0-0xFF):
+*  0 timestamp ms (4)   16 tps0 value (2)      31 bps value (2)     42 MCM DC V (2)
+*  4 trigger fault (4)  18 tps1 value (2)      33 bps % (1)         44 MCM DC A (2)
+*  8 faults (4)         20 tps0/tps1/tps % (3) 34 bps calib min (2) 46 BMS CCL, DCL (2)
+* 12 warnings (2)       23 tps0 calib min/max  36 bps calib max (2) 48 BMS avg/max temp (2)
+* 14 notices (2)        27 tps1 calib min/max  38 MCM torque (2)    50 LV battery mV (2)
+*                                              40 MCM RPM (2)       52 unused (2)
+****************************************************************************/
+#define FREEZE_FRAME_RECORD_SIZE 54
+#define FREEZE_FRAME_CHUNKS (FREEZE_FRAME_RECORD_SIZE / 6)
+
+static void pack2(ubyte1* buffer, ubyte1* pos, ubyte2 value)
+{
+    buffer[(*pos)++] = value;
+    buffer[(*pos)++] = value >> 8;
+}
+
+static void pack4(ubyte1* buffer, ubyte1* pos, ubyte4 value)
+{
+    pack2(buffer, pos, value);
+    pack2(buffer, pos, value >> 16);
+}
+
+static void canOutput_packFreezeFrame(const FreezeFrame* frame, ubyte1 buffer[FREEZE_FRAME_RECORD_SIZE])
+{
+    ubyte1 pos = 0;
+
+    pack4(buffer, &pos, frame->timestamp_ms);
+    pack4(buffer, &pos, frame->triggerFault);
+    pack4(buffer, &pos, frame->faults);
+    pack2(buffer, &pos, frame->warnings);
+    pack2(buffer, &pos, frame->notices);
+
+    pack2(buffer, &pos, frame->tps.tps0_value);
+    pack2(buffer, &pos, frame->tps.tps1_value);
+    buffer[pos++] = 0xFF * frame->tps.tps0_percent;
+    buffer[pos++] = 0xFF * frame->tps.tps1_percent;
+    buffer[pos++] = 0xFF * frame->tps.percent;
+    pack2(buffer, &pos, frame->tps.tps0_calibMin);
+    pack2(buffer, &pos, frame->tps.tps0_calibMax);
+    pack2(buffer, &pos, frame->tps.tps1_calibMin);
+    pack2(buffer, &pos, frame->tps.tps1_calibMax);
+
+    pack2(buffer, &pos, frame->bps.bps0_value);
+    buffer[pos++] = 0xFF * frame->bps.percent;
+    pack2(buffer, &pos, frame->bps.bps0_calibMin);
+    pack2(buffer, &pos, frame->bps.bps0_calibMax);
+
+    pack2(buffer, &pos, frame->mcmCommandedTorque);
+    pack2(buffer, &pos, frame->mcmRPM);
+    pack2(buffer, &pos, frame->mcmDCVoltage);
+    pack2(buffer, &pos, frame->mcmDCCurrent);
+
+    buffer[pos++] = frame->bmsCCL;
+    buffer[pos++] = frame->bmsDCL;
+    buffer[pos++] = frame->bmsAvgTemp;
+    buffer[pos++] = frame->bmsMaxTemp;
+
+    pack2(buffer, &pos, frame->LVBattery);
+
+    while (pos < FREEZE_FRAME_RECORD_SIZE) { buffer[pos++] = 0; }
+}
+
+//A fault history page, a whole freeze frame and every queued response
+COMPILE_TIME_ASSERT(4 + FREEZE_FRAME_CHUNKS + DEBUG_RESPONSE_MAX <= CAN_OUTPUT_FRAMES_MAX, debugResponseFrames);
+
+void canOutput_sendDebugResponses(CanManager* me, SafetyChecker* sc)
+{
+    IO_CAN_DATA_FRAME* canMessages = me->outputBuffer;
+    ubyte1 canMessageCount = 0;
+    ubyte1 page;
+    ubyte1 age;
+
+    if (SafetyChecker_getFaultHistoryRequest(sc, &page))
+    {
+        for (ubyte1 i = 0; i < 4; i++)
+        {
+            FaultEvent event;
+            ubyte1 eventAge = page * 4 + i;
+            IO_CAN_DATA_FRAME* frame = &canMessages[canMessageCount++];
+
+            frame->id_format = IO_CAN_STD_FRAME;
+            frame->id = 0x5FE;
+            frame->length = 8;
+            frame->data[0] = DebugService_FaultHistory;
+            frame->data[1] = eventAge;
+
+            if (page < (0x100 / 4) && SafetyChecker_getFaultEvent(sc, eventAge, &event))
+            {
+                ubyte1 bit = 0;
+                while (bit < 31 && (event.flag >> bit) != 1) { bit++; }
+
+                frame->data[2] = (event.severity << 6) | (event.set ? 0x20 : 0) | bit;
+                frame->data[3] = event.timestamp_ms;
+                frame->data[4] = event.timestamp_ms >> 8;
+                frame->data[5] = event.timestamp_ms >> 16;
+                frame->data[6] = event.context;
+                frame->data[7] = event.context >> 8;
+            }
+            else
+            {
+                ubyte2 eventCount = SafetyChecker_getFaultEventCount(sc);
+                frame->data[2] = 0xFF;
+                frame->data[3] = eventCount;
+                frame->data[4] = eventCount >> 8;
+                frame->data[5] = 0;
+                frame->data[6] = 0;
+                frame->data[7] = 0;
+            }
+        }
+    }
+
+    if (SafetyChecker_getFreezeFrameRequest(sc, &age))
+    {
+        const FreezeFrame* frame = SafetyChecker_getFreezeFrame(sc, age);
+
+        if (frame == NULL || age > 0xE)
+        {
+            IO_CAN_DATA_FRAME* response = &canMessages[canMessageCount++];
+            response->id_format = IO_CAN_STD_FRAME;
+            response->id = 0x5FE;
+            response->length = 3;
+            response->data[0] = DebugService_FreezeFrame;
+            response->data[1] = (age << 4) | 0xF;
+            response->data[2] = SafetyChecker_getFreezeFrameCount(sc);
+        }
+        else
+        {
+            ubyte1 record[FREEZE_FRAME_RECORD_SIZE];
+            canOutput_packFreezeFrame(frame, record);
+
+            for (ubyte1 chunk = 0; chunk < FREEZE_FRAME_CHUNKS; chunk++)
+            {
+                IO_CAN_DATA_FRAME* response = &canMessages[canMessageCount++];
+                response->id_format = IO_CAN_STD_FRAME;
+                response->id = 0x5FE;
+                response->length = 8;
+                response->data[0] = DebugService_FreezeFrame;
+                response->data[1] = (age << 4) | chunk;
+                for (ubyte1 i = 0; i < 6; i++)
+                {
+                    response->data[2 + i] = record[chunk * 6 + i];
+                }
+            }
+        }
+    }
+
+    //Parameter, DAQ, logger and profiler responses were encoded by their modules
+    //when the request was dispatched - oldest first
+    while (me->debugResponseCount > 0)
+    {
+        IO_CAN_DATA_FRAME* response = &canMessages[canMessageCount++];
+        response->id_format = IO_CAN_STD_FRAME;
+        response->id = 0x5FE;
+        response->length = 8;
+        for (ubyte1 i = 0; i < 8; i++)
+        {
+            response->data[i] = me->debugResponses[me->debugResponseHead][i];
+        }
+        me->debugResponseHead = (me->debugResponseHead + 1) % DEBUG_RESPONSE_MAX;
+        me->debugResponseCount--;
+    }
+
+    if (canMessageCount > 0)
+    {
+        CanManager_writeFIFO(me, CAN0_HIPRI, canMessages, canMessageCount);
+    }
+}
+
+
+/*****************************************************************************
+* DAQ lists (0x5E0-0x5EF)
+******************************************************************************
+* Sent straight to the FIFO: the host chose the rate, so CanManager_send's
+* changed-data filtering must not thin them out.
+****************************************************************************/
+COMPILE_TIME_ASSERT(DAQ_LIST_MAX * DAQ_FRAMES_PER_LIST <= CAN_OUTPUT_FRAMES_MAX, daqFrames);
+
+void canOutput_sendDAQ(CanManager* me, DataAcquisition* daq)
+{
+    IO_CAN_DATA_FRAME* canMessages = me->outputBuffer;
+    ubyte1 canMessageCount = DAQ_getDueFrames(daq, canMessages, DAQ_LIST_MAX * DAQ_FRAMES_PER_LIST);
+
+    if (canMessageCount > 0)
+    {
+        CanManager_writeFIFO(me, CAN0_HIPRI, canMessages, canMessageCount);
+    }
+}
+
+
+/*****************************************************************************
+* Logger upload (0x5F0)
+******************************************************************************
+* A few frames per cycle, and only while parked (stopped, inverter off), so
+* uploading never competes with the car's own traffic while driving.
+****************************************************************************/
+void canOutput_sendLoggerUpload(CanManager* me, DataLogger* logger, MotorController* mcm)
+{
+    IO_CAN_DATA_FRAME canMessages[LOG_UPLOAD_FRAMES_PER_CYCLE];
+    ubyte1 canMessageCount;
+
+    if (MCM_getGroundSpeedKPH(mcm) != 0 || MCM_getInverterStatus(mcm) == ENABLED) { return; }
+
+    canMessageCount = DataLogger_getUploadFrames(logger, canMessages, LOG_UPLOAD_FRAMES_PER_CYCLE);
+    if (canMessageCount > 0)
+    {
+        CanManager_writeFIFO(me, CAN0_HIPRI, canMessages, canMessageCount);
+    }
+}
+
+
+/*****************************************************************************
+* Boot timing (BOOT_TIMING_ID, once at startup)
+******************************************************************************
+* byte 0-1  EEPROM load ms        byte 4-5  sensor readiness wait ms
+* byte 2-3  bench switch read ms  byte 6-7  power up to main loop ms
+* (little endian; the same numbers are printed on serial)
+****************************************************************************/
+void canOutput_sendBootTiming(CanManager* me, ubyte2 eeprom_ms, ubyte2 benchDetect_ms, ubyte2 sensors_ms, ubyte2 total_ms)
+{
+    IO_CAN_DATA_FRAME canMessage;
+    ubyte1 pos = 0;
+
+    canMessage.id_format = IO_CAN_STD_FRAME;
+    canMessage.id = BOOT_TIMING_ID;
+    canMessage.length = 8;
+    pack2(canMessage.data, &pos, eeprom_ms);
+    pack2(canMessage.data, &pos, benchDetect_ms);
+    pack2(canMessage.data, &pos, sensors_ms);
+    pack2(canMessage.data, &pos, total_ms);
+
+    CanManager_writeFIFO(me, CAN0_HIPRI, &canMessage, 1);
+}
+
+
+/*****************************************************************************
+* Pedal-to-inverter latency (LATENCY_ID, once a second)
+******************************************************************************
+* byte 0-1  p50 us   byte 4-5  max us
+* byte 2-3  p99 us   byte 6-7  samples
+* (little endian, over the last period - each send resets the histogram)
+****************************************************************************/
+void canOutput_sendLatency(CanManager* me, Profiler* profiler)
+{
+    IO_CAN_DATA_FRAME canMessage;
+    ubyte2 p50_us, p99_us, max_us, count;
+    ubyte1 pos = 0;
+
+    if (CycleClock_since(me->timestamp_latencySent) < LATENCY_PERIOD_US) { return; }
+    me->timestamp_latencySent = CycleClock_now();
+
+    Profiler_getLatency(profiler, &p50_us, &p99_us, &max_us, &count);
+
+    canMessage.id_format = IO_CAN_STD_FRAME;
+    canMessage.id = LATENCY_ID;
+    canMessage.length = 8;
+    pack2(canMessage.data, &pos, p50_us);
+    pack2(canMessage.data, &pos, p99_us);
+    pack2(canMessage.data, &pos, max_us);
+    pack2(canMessage.data, &pos, count);
+
+    CanManager_writeFIFO(me, CAN0_HIPRI, &canMessage, 1);
+    Profiler_resetLatency(profiler);
+}
+
+
+/*****************************************************************************
+* CAN health (CAN_HEALTH_ID, once a second)
+******************************************************************************
+* Two pages per channel, data[0] = page (0/1 = CAN0, 2/3 = CAN1), little endian:
+* errors   page fifoFull(2) oldData(2) busOff(2) errorWarning
+* traffic  page writeFailures(2) maxFifoFill maxFramesIn maxFramesOut
+*          ringHighWater ringDropped
+* Error counters and ringDropped (low byte) are cumulative and wrap - diff
+* consecutive frames.  oldData counts cycles whose CanManager_read found no
+* frames, so it grows by at most ~30 a second.  maxFifoFill is the most frames one FIFO read has ever
+* returned; maxFramesIn/Out are the busiest cycle since the previous health
+* frame (saturating at 255).  The ring fields are 0 on CAN1, which has no ring.
+*
+* Call once per cycle after all other sends: it also closes the cycle's
+* frames in/out counts.
+****************************************************************************/
+void canOutput_sendCanHealth(CanManager* me)
+{
+    IO_CAN_DATA_FRAME canMessages[4];
+    ubyte1 canMessageCount = 0;
+
+    for (ubyte1 channel = 0; channel < 2; channel++)
+    {
+        CanChannelHealth* health = &me->health[channel];
+        if (health->framesIn > health->maxFramesIn) { health->maxFramesIn = health->framesIn; }
+        if (health->framesOut > health->maxFramesOut) { health->maxFramesOut = health->framesOut; }
+        health->framesIn = 0;
+        health->framesOut = 0;
+    }
+
+    if (CycleClock_since(me->timestamp_healthSent) < CAN_HEALTH_PERIOD_US) { return; }
+    me->timestamp_healthSent = CycleClock_now();
+
+    for (ubyte1 channel = 0; channel < 2; channel++)
+    {
+        CanChannelHealth* health = &me->health[channel];
+        IO_CAN_DATA_FRAME* errors = &canMessages[canMessageCount++];
+        IO_CAN_DATA_FRAME* traffic = &canMessages[canMessageCount++];
+        ubyte1 pos;
+
+        errors->id_format = IO_CAN_STD_FRAME;
+        errors->id = CAN_HEALTH_ID;
+        errors->length = 8;
+        errors->data[0] = channel * 2;
+        pos = 1;
+        pack2(errors->data, &pos, health->fifoFull);
+        pack2(errors->data, &pos, health->oldData);
+        pack2(errors->data, &pos, health->busOff);
+        errors->data[7] = health->errorWarning;
+
+        traffic->id_format = IO_CAN_STD_FRAME;
+        traffic->id = CAN_HEALTH_ID;
+        traffic->length = 8;
+        traffic->data[0] = channel * 2 + 1;
+        pos = 1;
+        pack2(traffic->data, &pos, health->writeFailures);
+        traffic->data[3] = health->maxFifoFill;
+        traffic->data[4] = (health->maxFramesIn > 0xFF) ? 0xFF : health->maxFramesIn;
+        traffic->data[5] = (health->maxFramesOut > 0xFF) ? 0xFF : health->maxFramesOut;
+        traffic->data[6] = (channel == CAN0_HIPRI) ? CanRxRing_getHighWater(me->can0_rxRing) : 0;
+        traffic->data[7] = (channel == CAN0_HIPRI) ? CanRxRing_getDropped(me->can0_rxRing) : 0;
+
+        health->maxFramesIn = 0;
+        health->maxFramesOut = 0;
+    }
+
+    CanManager_writeFIFO(me, CAN0_HIPRI, canMessages, canMessageCount);
+}
@@ -9,28 +9,82 @@
 #include "bms.h"
 #include "wheelSpeeds.h"
 #include "safety.h"
+#include "parameterTable.h"
+#include "dataAcquisition.h"
+#include "dataLogger.h"
+#include "profiler.h"
+#include "vehicleState.h"
+#include "debugServices.h"
 
 typedef enum { CAN0_HIPRI, CAN1_LOPRI } CanChannel;
 //CAN0: 48 messages per handle (48 read, 48 write)
 //CAN1: 16 messages per handle
 
+//Max number of incoming message IDs that can be checked for timeouts
+#define CAN_SUPERVISED_MAX 8
+
 typedef struct _CanManager CanManager;
 
 typedef struct _CanMessageNode CanMessageNode;
 
-//Note: Sum of messageLimits must be < 128 (hardware only does 128 total messages)
+//Largest messageLimit CanManager_new accepts (bigger ones are reduced to this).
+//Sets the size of CanManager's read/send frame buffers.
+#define CAN_FIFO_MESSAGES_MAX 40
+
+//Note: Sum of messageLimits must be < 128 (hardware only does 128 total messages,
+//and one of them is the MCM command's own message object)
 CanManager* CanManager_new(ubyte2 can0_busSpeed, ubyte1 can0_read_messageLimit, ubyte1 can0_write_messageLimit
                          , ubyte2 can1_busSpeed, ubyte1 can1_read_messageLimit, ubyte1 can1_write_messageLimit
                          , ubyte4 defaultSendDelayus, SerialManager* sm);
 IO_ErrorType CanManager_send(CanManager* me, CanChannel channel, IO_CAN_DATA_FRAME canMessages[], ubyte1 canMessageCount);
 
+//Objects that incoming CAN messages are handed to.  main fills this in once.
+typedef struct _CanReceivers
+{
+    MotorController* mcm;
+    BatteryManagementSystem* bms;
+    SafetyChecker* sc;
+    ParameterTable* params;
+    DataAcquisition* daq;
+    DataLogger* logger;
+    Profiler* profiler;
+} CanReceivers;
+
+//Moves any frames waiting in the CAN0 hardware FIFO into the receive ring.  Cheap when
+//nothing has arrived - call it as often as possible between cycles.
+void CanManager_poll(CanManager* me);
+
 //Reads and distributes can messages to their appropriate subsystem objects so they can updates themselves
-void CanManager_read(CanManager* me, CanChannel channel, MotorController* mcm, BatteryManagementSystem* bms, SafetyChecker* sc);
+void CanManager_read(CanManager* me, CanChannel channel, const CanReceivers* rx);
+
+//Hands one received frame to the object it belongs to.  CanManager_read calls this for
+//every FIFO frame; anything else that feeds frames in (trace replay) should call it too.
+void CanManager_dispatch(CanManager* me, const CanReceivers* rx, IO_CAN_DATA_FRAME* canMessage);
 
 void canOutput_sendSensorMessages(CanManager* me);
 //void canOutput_sendMCUControl(CanManager* me, MotorController* mcm, bool sendEvenIfNoChanges);
-void canOutput_sendDebugMessage(CanManager* me, TorqueEncoder* tps, BrakePressureSensor* bps, MotorController* mcm, WheelSpeeds* wss, SafetyChecker* sc);
+//Torque/inverter command (0xC0).  Call as soon as SafetyChecker_reduceTorque and
+//MCM_inverterControl have set this cycle's commands.  Returns TRUE if it was sent.
+bool canOutput_sendMCMCommand(CanManager* me, MotorController* mcm);
+void canOutput_sendDebugMessage(CanManager* me, const VehicleState* state, MotorController* mcm, SafetyChecker* sc);
+//Answers any debug service requests received this cycle (see DebugService)
+void canOutput_sendDebugResponses(CanManager* me, SafetyChecker* sc);
+//Sends any DAQ lists whose period has elapsed
+void canOutput_sendDAQ(CanManager* me, DataAcquisition* daq);
+//Sends boot phase durations once, on BOOT_TIMING_ID (see canManager.c)
+void canOutput_sendBootTiming(CanManager* me, ubyte2 eeprom_ms, ubyte2 benchDetect_ms, ubyte2 sensors_ms, ubyte2 total_ms);
+//Sends the next part of a requested logger upload, only while the car is parked
+void canOutput_sendLoggerUpload(CanManager* me, DataLogger* logger, MotorController* mcm);
+
+//Pedal-to-inverter latency percentiles from the profiler (0x5F2, once a second), then resets them
+void canOutput_sendLatency(CanManager* me, Profiler* profiler);
+
+//Driver error counters and traffic per channel.  Call last each cycle (see canManager.c).
+void canOutput_sendCanHealth(CanManager* me);
 
 ubyte1 CanManager_getReadStatus(CanManager* me, CanChannel channel);
 
+//Checks required incoming messages against their max period and reports stale nodes to the safety checker
+void CanManager_checkTimeouts(CanManager* me, SafetyChecker* sc);
+
 #endif // _CANMANAGER_H is defined
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "canRxRing.h"
+#include "memoryArena.h"
+
+struct _CanRxRing
+{
+    volatile IO_CAN_DATA_FRAME frames[CAN_RX_RING_SIZE];
+
+    //Free-running - the slot is index % CAN_RX_RING_SIZE, the fill level is head - tail
+    volatile ubyte2 head;     //Written by the producer only
+    volatile ubyte2 tail;     //Written by the consumer only
+
+    //Producer side statistics
+    volatile ubyte4 pushed;
+    volatile ubyte4 dropped;
+    ubyte2 highWater;
+};
+
+CanRxRing* CanRxRing_new(void)
+{
+    CanRxRing* me = (CanRxRing*)MemoryArena_alloc(sizeof(struct _CanRxRing));
+
+    me->head = 0;
+    me->tail = 0;
+    me->pushed = 0;
+    me->dropped = 0;
+    me->highWater = 0;
+
+    return me;
+}
+
+bool CanRxRing_push(CanRxRing* me, const IO_CAN_DATA_FRAME* frame)
+{
+    ubyte2 head = me->head;
+    ubyte2 fill = (ubyte2)(head - me->tail);
+
+    if (fill >= CAN_RX_RING_SIZE)
+    {
+        me->dropped++;
+        return FALSE;
+    }
+
+    //Frame first, then head - the consumer never sees a slot before it is complete
+    me->frames[head % CAN_RX_RING_SIZE] = *frame;
+    me->head = head + 1;
+
+    me->pushed++;
+    if (fill + 1 > me->highWater) { me->highWater = fill + 1; }
+    return TRUE;
+}
+
+bool CanRxRing_pop(CanRxRing* me, IO_CAN_DATA_FRAME* frame)
+{
+    ubyte2 tail = me->tail;
+
+    if (tail == me->head) { return FALSE; }
+
+    //Copy out before releasing the slot to the producer
+    *frame = me->frames[tail % CAN_RX_RING_SIZE];
+    me->tail = tail + 1;
+    return TRUE;
+}
+
+ubyte4 CanRxRing_getPushed(CanRxRing* me)
+{
+    return me->pushed;
+}
+
+ubyte4 CanRxRing_getDropped(CanRxRing* me)
+{
+    return me->dropped;
+}
+
+ubyte2 CanRxRing_getHighWater(CanRxRing* me)
+{
+    return me->highWater;
+}
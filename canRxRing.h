@@ -0,0 +1,41 @@
+#ifndef _CANRXRING_H
+#define _CANRXRING_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+/*****************************************************************************
+* CAN receive ring
+******************************************************************************
+* Single producer / single consumer queue of received frames.  The producer
+* (CanManager_poll - from the end-of-cycle wait, a fast tick or an interrupt)
+* moves frames out of the hardware FIFO as they arrive; the consumer
+* (CanManager_read, once per main loop cycle) takes them out.  No locks: only
+* the producer writes head, only the consumer writes tail, and both are 16-bit
+* so every update is a single store on the XC2000.
+*
+* A full ring drops the new frame.  pushed/dropped only ever count up, so a
+* reader comparing two samples sees exactly how many frames were lost.
+*
+* Nothing in here touches the hardware, so it can be built and tested on its own.
+****************************************************************************/
+#define CAN_RX_RING_SIZE 128  //Power of two.  Enough for one full cycle of inverter + BMS traffic.
+
+typedef struct _CanRxRing CanRxRing;
+
+CanRxRing* CanRxRing_new(void);
+
+//Producer side.  Returns FALSE (and counts a drop) if the ring is full.
+bool CanRxRing_push(CanRxRing* me, const IO_CAN_DATA_FRAME* frame);
+
+//Consumer side.  Returns FALSE if the ring is empty.
+bool CanRxRing_pop(CanRxRing* me, IO_CAN_DATA_FRAME* frame);
+
+//Frames accepted / dropped since boot (both wrap at 2^32)
+ubyte4 CanRxRing_getPushed(CanRxRing* me);
+ubyte4 CanRxRing_getDropped(CanRxRing* me);
+
+//Most frames ever waiting at once
+ubyte2 CanRxRing_getHighWater(CanRxRing* me);
+
+#endif // _CANRXRING_H
@@ -1,4 +1,3 @@
-#include <stdlib.h>
 #include "IO_Driver.h"
 //#include "IO_DIO.h"
 //#include "IO_PWM.h"
@@ -6,6 +5,7 @@
 #include "serial.h"
 #include "sensors.h"
 #include "cooling.h"
+#include "memoryArena.h"
 #include "motorController.h"
 #include "mathFunctions.h"
 #include "bms.h"
@@ -13,8 +13,8 @@
 //All temperatures in C
 CoolingSystem* CoolingSystem_new(SerialManager* serialMan)
 {
-    CoolingSystem* me = (CoolingSystem*)malloc(sizeof(struct _CoolingSystem));
-    SerialManager* sm = serialMan;
+    CoolingSystem* me = (CoolingSystem*)MemoryArena_alloc(sizeof(struct _CoolingSystem));
+    me->sm = serialMan;
 
     //Cooling systems:
     //Water pump (motor, controller) - PWM
@@ -42,6 +42,17 @@ CoolingSystem* CoolingSystem_new(SerialManager* serialMan)
     return me;
 }
 
+//Temperature thresholds are tunable over CAN (see parameterTable.h)
+void CoolingSystem_registerParameters(CoolingSystem* me, ParameterTable* params)
+{
+    ParameterTable_add(params, ParamID_Cooling_waterPumpLow, &me->waterPumpLow, PARAM_SBYTE1, 0, 100, EEPROMSlot_cooling_waterPumpLow);
+    ParameterTable_add(params, ParamID_Cooling_waterPumpHigh, &me->waterPumpHigh, PARAM_SBYTE1, 0, 100, EEPROMSlot_cooling_waterPumpHigh);
+    ParameterTable_add(params, ParamID_Cooling_motorFanLow, &me->motorFanLow, PARAM_SBYTE1, 0, 100, EEPROMSlot_cooling_motorFanLow);
+    ParameterTable_add(params, ParamID_Cooling_motorFanHigh, &me->motorFanHigh, PARAM_SBYTE1, 0, 100, EEPROMSlot_cooling_motorFanHigh);
+    ParameterTable_add(params, ParamID_Cooling_batteryFanLow, &me->batteryFanLow, PARAM_SBYTE1, 0, 100, EEPROMSlot_cooling_batteryFanLow);
+    ParameterTable_add(params, ParamID_Cooling_batteryFanHigh, &me->batteryFanHigh, PARAM_SBYTE1, 0, 100, EEPROMSlot_cooling_batteryFanHigh);
+}
+
 //-------------------------------------------------------------------
 // Cooling system calculations - turns fans on/off, sends water pump PWM control signal
 //Rinehart water temperature operating range: -30C to +80C before derating
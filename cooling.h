@@ -3,6 +3,9 @@
 
 #include "IO_Driver.h"
 
+#include "serial.h"
+#include "parameterTable.h"
+
 typedef struct _CoolingSystem
 {
     SerialManager* sm;
@@ -32,6 +35,7 @@ CoolingSystem;
 CoolingSystem* CoolingSystem_new(SerialManager* sm);
 void CoolingSystem_calculations(CoolingSystem* me, sbyte2 motorControllerTemp, sbyte2 motorTemp, sbyte1 batteryTemp);
 void CoolingSystem_enactCooling(CoolingSystem* me);
+void CoolingSystem_registerParameters(CoolingSystem* me, ParameterTable* params);
 
 
 
@@ -0,0 +1,57 @@
+#include "IO_Driver.h"
+#include "IO_RTC.h"
+
+#include "cycleClock.h"
+
+//IO_RTC_GetTimeUS wraps at 2^32 us.  The epoch is moved up long before that.
+#define CYCLECLOCK_REBASE_US 0x80000000
+
+static ubyte4 timestamp_epoch;      //RTC timestamp that epochStart_us corresponds to
+static ubyte8 epochStart_us;
+static ubyte4 cycleStartOffset_us;  //Time from the epoch to the last update
+static ubyte8 now_us;
+
+void CycleClock_init(void)
+{
+    IO_RTC_StartTime(&timestamp_epoch);
+    epochStart_us = 1;  //Keeps every real timestamp away from CYCLECLOCK_NEVER
+    cycleStartOffset_us = 0;
+    now_us = epochStart_us;
+}
+
+void CycleClock_update(void)
+{
+    ubyte4 elapsed_us = IO_RTC_GetTimeUS(timestamp_epoch);
+    now_us = epochStart_us + elapsed_us;
+    cycleStartOffset_us = elapsed_us;
+
+    //Only the few us between these two RTC reads are lost, once every ~36 minutes
+    if (elapsed_us >= CYCLECLOCK_REBASE_US)
+    {
+        IO_RTC_StartTime(&timestamp_epoch);
+        epochStart_us = now_us;
+        cycleStartOffset_us = 0;
+    }
+}
+
+ubyte8 CycleClock_now(void)
+{
+    return now_us;
+}
+
+ubyte8 CycleClock_read(void)
+{
+    return epochStart_us + IO_RTC_GetTimeUS(timestamp_epoch);
+}
+
+ubyte4 CycleClock_since(ubyte8 timestamp)
+{
+    if (timestamp == CYCLECLOCK_NEVER) { return 0xFFFFFFFF; }
+    if (timestamp >= now_us) { return 0; }
+    return (now_us - timestamp > 0xFFFFFFFF) ? 0xFFFFFFFF : (ubyte4)(now_us - timestamp);
+}
+
+ubyte4 CycleClock_getCycleElapsedUS(void)
+{
+    return IO_RTC_GetTimeUS(timestamp_epoch) - cycleStartOffset_us;
+}
@@ -0,0 +1,44 @@
+#ifndef _CYCLECLOCK_H
+#define _CYCLECLOCK_H
+
+#include "IO_Driver.h"
+
+/*****************************************************************************
+* Cycle clock
+******************************************************************************
+* The RTC is read once at the start of each main loop cycle and turned into a
+* 64-bit microsecond uptime that does not wrap.  IO_RTC_GetTimeUS on its own
+* wraps after ~71 minutes.  Main loop timers (send rates, CAN timeouts,
+* debounces, sound length) store a CycleClock_now() value and test it with
+* CycleClock_since().  A cycle then reads the RTC once instead of once per
+* check, and every module sees the same "now".
+*
+* Resolution is one cycle.  Code that times something *within* a cycle
+* (profiler, end-of-cycle wait, boot timeouts) still reads the RTC itself.
+****************************************************************************/
+typedef unsigned long long ubyte8;  //IO_Driver has no 64-bit type
+
+//Timestamp that has never been set (uptime starts at 1 us, so no real one is 0)
+#define CYCLECLOCK_NEVER 0
+
+//Starts uptime.  Call once, first thing at boot.
+void CycleClock_init(void);
+
+//Samples the RTC.  Call once at the start of every cycle (at least every ~71 minutes).
+void CycleClock_update(void);
+
+//Microseconds since CycleClock_init, as of the last CycleClock_update
+ubyte8 CycleClock_now(void);
+
+//Microseconds from timestamp to the last CycleClock_update.  Saturates at 0xFFFFFFFF
+//(~71 min, and for CYCLECLOCK_NEVER) and is 0 for timestamps after the last update.
+ubyte4 CycleClock_since(ubyte8 timestamp);
+
+//Microseconds since CycleClock_init, read live from the RTC.  For timestamps that
+//must be finer than a cycle (e.g. when a sensor was sampled).
+ubyte8 CycleClock_read(void);
+
+//Microseconds since the last CycleClock_update, read live from the RTC
+ubyte4 CycleClock_getCycleElapsedUS(void);
+
+#endif // _CYCLECLOCK_H
@@ -0,0 +1,211 @@
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "dataAcquisition.h"
+#include "memoryArena.h"
+#include "cycleClock.h"
+#include "debugServices.h"
+
+typedef struct _DAQEntry
+{
+    ubyte4 address;
+    ubyte1 size;    //1, 2 or 4 bytes
+    ubyte1 frame;   //Where it goes in the list's frames
+    ubyte1 offset;
+} DAQEntry;
+
+typedef struct _DAQList
+{
+    DAQEntry entries[DAQ_ENTRIES_MAX];
+    ubyte1 entryCount;
+    ubyte1 frameCount;      //Frames in use (last one may be partly filled)
+    ubyte1 nextOffset;      //Next free byte in the last frame
+
+    bool running;
+    ubyte4 period_us;
+    ubyte8 timestamp_lastSent;
+} DAQList;
+
+typedef enum
+{
+      DAQ_OK = 0
+    , DAQ_BAD_LIST = 1
+    , DAQ_BAD_SIZE = 2
+    , DAQ_LIST_FULL = 3
+    , DAQ_LIST_EMPTY = 4
+    , DAQ_BAD_ADDRESS = 5   //Not inside an object (see MemoryArena_contains)
+} DAQStatus;
+
+struct _DataAcquisition
+{
+    DAQList lists[DAQ_LIST_MAX];
+};
+
+static void DAQList_clear(DAQList* list)
+{
+    list->entryCount = 0;
+    list->frameCount = 0;
+    list->nextOffset = 8;  //Forces the first entry to open frame 0
+    list->running = FALSE;
+    list->period_us = 0;
+    list->timestamp_lastSent = CYCLECLOCK_NEVER;
+}
+
+DataAcquisition* DAQ_new(void)
+{
+    DataAcquisition* me = (DataAcquisition*)MemoryArena_alloc(sizeof(struct _DataAcquisition));
+
+    for (ubyte1 list = 0; list < DAQ_LIST_MAX; list++)
+    {
+        DAQList_clear(&me->lists[list]);
+    }
+
+    return me;
+}
+
+//Entries never straddle frames, so a host can decode each frame on its own
+static DAQStatus DAQList_addEntry(DAQList* list, ubyte4 address, ubyte1 size)
+{
+    DAQEntry* entry;
+
+    if (size != 1 && size != 2 && size != 4) { return DAQ_BAD_SIZE; }
+    //Sampled every period on a moving car - never read SFRs or unmapped space
+    if (!MemoryArena_contains((const void*)address, size)) { return DAQ_BAD_ADDRESS; }
+    if (list->entryCount >= DAQ_ENTRIES_MAX) { return DAQ_LIST_FULL; }
+    if (list->nextOffset + size > 8)
+    {
+        if (list->frameCount >= DAQ_FRAMES_PER_LIST) { return DAQ_LIST_FULL; }
+        list->frameCount++;
+        list->nextOffset = 0;
+    }
+
+    entry = &list->entries[list->entryCount++];
+    entry->address = address;
+    entry->size = size;
+    entry->frame = list->frameCount - 1;
+    entry->offset = list->nextOffset;
+    list->nextOffset += size;
+
+    return DAQ_OK;
+}
+
+/*****************************************************************************
+* CAN protocol (0x5FF request -> 0x5FE response, little endian)
+******************************************************************************
+* Clear  D5 list                          stops the list and removes all entries
+* Add    D6 list size a0 a1 a2 a3         appends a variable (size 1, 2 or 4 bytes)
+* Start  D7 list periodLo periodHi        period in ms, rounded up to whole main
+*                                         loop cycles.  Period 0 stops the list.
+* Every request is answered with
+*        svc list status frame offset entryCount
+* where frame/offset say where an added entry will appear (frame N is sent on
+* DAQ_BASE_ID + list * DAQ_FRAMES_PER_LIST + N).
+* status: 0 = OK, 1 = bad list, 2 = bad size, 3 = list full, 4 = list empty,
+*         5 = bad address (only fields of objects in the memory arena can be added)
+****************************************************************************/
+void DAQ_handleRequest(DataAcquisition* me, const IO_CAN_DATA_FRAME* request, ubyte1 response[8])
+{
+    DAQList* list;
+    DAQStatus status = DAQ_OK;
+    ubyte2 period_ms;
+
+    response[0] = request->data[0];
+    response[1] = request->data[1];
+
+    if (request->data[1] >= DAQ_LIST_MAX)
+    {
+        response[2] = DAQ_BAD_LIST;
+        return;
+    }
+    list = &me->lists[request->data[1]];
+
+    switch (request->data[0])
+    {
+    case DebugService_DAQClear:
+        DAQList_clear(list);
+        break;
+
+    case DebugService_DAQAdd:
+        list->running = FALSE;  //Layout is changing - restart once it's complete
+        status = DAQList_addEntry(list, (ubyte4)request->data[3]
+                                      | (ubyte4)request->data[4] << 8
+                                      | (ubyte4)request->data[5] << 16
+                                      | (ubyte4)request->data[6] << 24
+                                      , request->data[2]);
+        if (status == DAQ_OK)
+        {
+            response[3] = list->entries[list->entryCount - 1].frame;
+            response[4] = list->entries[list->entryCount - 1].offset;
+        }
+        break;
+
+    case DebugService_DAQStart:
+        period_ms = (ubyte2)request->data[3] << 8 | request->data[2];
+        if (period_ms == 0)
+        {
+            list->running = FALSE;
+        }
+        else if (list->entryCount == 0)
+        {
+            status = DAQ_LIST_EMPTY;
+        }
+        else
+        {
+            list->period_us = (ubyte4)period_ms * 1000;
+            list->running = TRUE;
+            list->timestamp_lastSent = CycleClock_now();
+        }
+        break;
+    }
+
+    response[2] = status;
+    response[5] = list->entryCount;
+}
+
+/*****************************************************************************
+* Sampling
+******************************************************************************
+* Values are copied when the list is sent, so every variable in a list is
+* sampled at the same point in the cycle.  Cost is one byte copy per
+* configured byte - lists nobody configured cost nothing.
+****************************************************************************/
+ubyte1 DAQ_getDueFrames(DataAcquisition* me, IO_CAN_DATA_FRAME canMessages[], ubyte1 maxMessages)
+{
+    ubyte1 canMessageCount = 0;
+
+    for (ubyte1 listNumber = 0; listNumber < DAQ_LIST_MAX; listNumber++)
+    {
+        DAQList* list = &me->lists[listNumber];
+        IO_CAN_DATA_FRAME* frames = &canMessages[canMessageCount];
+
+        if (list->running == FALSE
+            || CycleClock_since(list->timestamp_lastSent) < list->period_us
+            || canMessageCount + list->frameCount > maxMessages)
+        {
+            continue;
+        }
+        list->timestamp_lastSent = CycleClock_now();
+
+        for (ubyte1 frame = 0; frame < list->frameCount; frame++)
+        {
+            frames[frame].id_format = IO_CAN_STD_FRAME;
+            frames[frame].id = DAQ_BASE_ID + listNumber * DAQ_FRAMES_PER_LIST + frame;
+            frames[frame].length = (frame == list->frameCount - 1) ? list->nextOffset : 8;
+            for (ubyte1 byte = 0; byte < 8; byte++) { frames[frame].data[byte] = 0; }  //Gaps at the end of full frames
+        }
+
+        for (ubyte1 i = 0; i < list->entryCount; i++)
+        {
+            const DAQEntry* entry = &list->entries[i];
+            const ubyte1* source = (const ubyte1*)entry->address;
+            for (ubyte1 byte = 0; byte < entry->size; byte++)
+            {
+                frames[entry->frame].data[entry->offset + byte] = source[byte];
+            }
+        }
+
+        canMessageCount += list->frameCount;
+    }
+
+    return canMessageCount;
+}
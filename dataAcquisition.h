@@ -0,0 +1,37 @@
+#ifndef _DATAACQUISITION_H
+#define _DATAACQUISITION_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+/*****************************************************************************
+* Configurable measurement (DAQ) lists
+******************************************************************************
+* The host builds up to DAQ_LIST_MAX lists of RAM variables (address + size)
+* and gives each list a period.  Only fields of objects in the memory arena
+* are accepted (arena address from the linker map file plus the object's
+* offset, see MemoryArena_report) - the address arrives in an unauthenticated
+* CAN frame, so SFRs and unmapped space are refused.  Every
+* period the variables are copied into that list's frames and sent on
+* DAQ_BASE_ID + list * DAQ_FRAMES_PER_LIST + frame, in the VCU's own (little
+* endian) byte order.
+*
+* Lists start out empty and stopped, so nothing is sent until a host asks.
+* Configuration goes over the 0x5FF debug channel - see dataAcquisition.c.
+****************************************************************************/
+#define DAQ_BASE_ID 0x5E0          //0x5E0-0x5EF are reserved for DAQ lists
+#define DAQ_LIST_MAX 4
+#define DAQ_FRAMES_PER_LIST 4      //Up to 32 bytes per list
+#define DAQ_ENTRIES_MAX 16         //Per list
+
+typedef struct _DataAcquisition DataAcquisition;
+
+DataAcquisition* DAQ_new(void);
+
+//Handles a DAQ service request from 0x5FF and fills in its 0x5FE response (8 data bytes, zeroed by the caller)
+void DAQ_handleRequest(DataAcquisition* me, const IO_CAN_DATA_FRAME* request, ubyte1 response[8]);
+
+//Fills canMessages with the frames of every list whose period has elapsed.  Returns the frame count.
+ubyte1 DAQ_getDueFrames(DataAcquisition* me, IO_CAN_DATA_FRAME canMessages[], ubyte1 maxMessages);
+
+#endif // _DATAACQUISITION_H
@@ -0,0 +1,291 @@
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "dataLogger.h"
+#include "memoryArena.h"
+#include "debugServices.h"
+
+typedef enum
+{
+      LOG_RECORDING     //Filling the ring, waiting for a trigger
+    , LOG_POST_TRIGGER  //Triggered - recording the post-trigger samples
+    , LOG_FROZEN        //Buffer holds a complete capture
+    , LOG_UPLOADING     //Frozen, and being sent out on LOG_UPLOAD_ID
+} LoggerState;
+
+typedef enum
+{
+      LOG_OK = 0
+    , LOG_BAD_REQUEST = 1
+    , LOG_NO_ROOM = 2     //Channel doesn't fit in LOG_RECORD_MAX/LOG_CHANNELS_MAX
+    , LOG_NOT_FROZEN = 3  //Upload requested before a capture finished
+    , LOG_BAD_ADDRESS = 4 //Channel is not inside the memory arena
+} LoggerStatus;
+
+typedef struct _LogChannel
+{
+    const ubyte1* address;
+    ubyte1 size;
+} LogChannel;
+
+#define LOG_PRETRIGGER_HALF 0xFFFF
+
+struct _DataLogger
+{
+    LogChannel channels[LOG_CHANNELS_MAX];
+    ubyte1 channelCount;
+    ubyte1 recordSize;          //Sum of channel sizes
+    ubyte2 capacity;            //Samples that fit in the buffer
+
+    LoggerState state;
+    ubyte2 next;                //Sample slot the next record goes into
+    ubyte2 sampleCount;         //Samples in the buffer (max capacity)
+    ubyte2 preTriggerRequested; //LOG_PRETRIGGER_HALF = half the buffer
+    ubyte2 preTriggerSamples;   //Requested, clipped to fit this record size
+    ubyte2 postRemaining;       //Samples still to record after the trigger
+    ubyte2 triggerPosition;     //Samples (oldest first) before the trigger, once frozen
+    ubyte4 lastFaults;
+    bool faultsSeeded;          //FALSE until the first record after arming has read the faults
+
+    ubyte2 uploadOffset;        //Bytes already uploaded (oldest sample first)
+
+    ubyte1 buffer[LOG_BUFFER_BYTES];
+};
+
+//Empties the buffer and starts waiting for a trigger
+static void DataLogger_arm(DataLogger* me)
+{
+    me->capacity = (me->recordSize == 0) ? 0 : LOG_BUFFER_BYTES / me->recordSize;
+
+    //At least one sample is always kept after the trigger
+    me->preTriggerSamples = (me->preTriggerRequested == LOG_PRETRIGGER_HALF) ? me->capacity / 2 : me->preTriggerRequested;
+    if (me->capacity > 0 && me->preTriggerSamples >= me->capacity) { me->preTriggerSamples = me->capacity - 1; }
+
+    me->state = LOG_RECORDING;
+    me->next = 0;
+    me->sampleCount = 0;
+    me->postRemaining = 0;
+    me->triggerPosition = 0;
+    me->uploadOffset = 0;
+
+    //Faults already active when arming are the starting point, not a trigger
+    me->faultsSeeded = FALSE;
+}
+
+DataLogger* DataLogger_new(void)
+{
+    DataLogger* me = (DataLogger*)MemoryArena_alloc(sizeof(struct _DataLogger));
+
+    me->channelCount = 0;
+    me->recordSize = 0;
+    me->preTriggerRequested = LOG_PRETRIGGER_HALF;
+    DataLogger_arm(me);
+
+    return me;
+}
+
+bool DataLogger_addChannel(DataLogger* me, const void* address, ubyte1 size)
+{
+    if (size == 0 || me->channelCount >= LOG_CHANNELS_MAX || me->recordSize + size > LOG_RECORD_MAX
+        || !MemoryArena_contains(address, size))
+    {
+        return FALSE;
+    }
+
+    me->channels[me->channelCount].address = (const ubyte1*)address;
+    me->channels[me->channelCount].size = size;
+    me->channelCount++;
+    me->recordSize += size;
+
+    //Record layout changed - old samples can't be decoded any more
+    DataLogger_arm(me);
+    return TRUE;
+}
+
+void DataLogger_trigger(DataLogger* me)
+{
+    if (me->state == LOG_RECORDING && me->capacity > 0)
+    {
+        me->postRemaining = me->capacity - me->preTriggerSamples;
+        me->state = LOG_POST_TRIGGER;
+    }
+}
+
+static void DataLogger_freeze(DataLogger* me)
+{
+    me->triggerPosition = me->sampleCount - (me->capacity - me->preTriggerSamples);
+    me->state = LOG_FROZEN;
+}
+
+/*****************************************************************************
+* Recording
+******************************************************************************
+* One record per cycle: at most LOG_RECORD_MAX byte copies and no searching,
+* so the cost is the same every cycle.
+****************************************************************************/
+void DataLogger_record(DataLogger* me, ubyte4 faults)
+{
+    ubyte4 newFaults;
+
+    if (!me->faultsSeeded)
+    {
+        me->lastFaults = faults;
+        me->faultsSeeded = TRUE;
+    }
+    newFaults = faults & ~me->lastFaults;
+    me->lastFaults = faults;
+
+    if (newFaults != 0) { DataLogger_trigger(me); }
+
+    if ((me->state == LOG_RECORDING || me->state == LOG_POST_TRIGGER) && me->capacity > 0)
+    {
+        ubyte1* record = &me->buffer[(ubyte4)me->next * me->recordSize];
+        for (ubyte1 channel = 0; channel < me->channelCount; channel++)
+        {
+            for (ubyte1 byte = 0; byte < me->channels[channel].size; byte++)
+            {
+                *record++ = me->channels[channel].address[byte];
+            }
+        }
+
+        me->next = (me->next + 1 == me->capacity) ? 0 : me->next + 1;
+        if (me->sampleCount < me->capacity) { me->sampleCount++; }
+
+        //The post-trigger window includes the triggering cycle
+        if (me->state == LOG_POST_TRIGGER && --me->postRemaining == 0)
+        {
+            DataLogger_freeze(me);
+        }
+    }
+}
+
+/*****************************************************************************
+* CAN protocol (0x5FF request -> 0x5FE response, little endian)
+******************************************************************************
+* Channel  D8 size a0 a1 a2 a3      adds a channel (size 0 = remove all channels).
+*                                   The address must lie inside the memory arena
+*                                   (an object field - see MemoryArena_report).
+* Control  D9 command [preLo preHi] command 0 = arm (clear buffer, record again)
+*                                           with preLo/preHi samples kept before
+*                                           the trigger, 1 = trigger now,
+*                                           2 = upload frozen buffer, 3 = stop upload
+* Both are answered with
+*          svc status state recordSize capacityLo capacityHi preLo preHi
+*
+* Upload on LOG_UPLOAD_ID (only while parked):
+*   offsetLo offsetHi d0..d5      6 bytes of the buffer, oldest sample first
+*   FF FF countLo countHi recordSize trigLo trigHi 00   sent after the last data frame
+*   (trig = samples before the trigger, i.e. the index of the first post-trigger sample)
+****************************************************************************/
+void DataLogger_handleRequest(DataLogger* me, const IO_CAN_DATA_FRAME* request, ubyte1 response[8])
+{
+    LoggerStatus status = LOG_OK;
+
+    if (request->data[0] == DebugService_LoggerChannel)
+    {
+        const void* address = (const void*)((ubyte4)request->data[2]
+                                           | (ubyte4)request->data[3] << 8
+                                           | (ubyte4)request->data[4] << 16
+                                           | (ubyte4)request->data[5] << 24);
+
+        if (request->data[1] == 0)
+        {
+            me->channelCount = 0;
+            me->recordSize = 0;
+            DataLogger_arm(me);
+        }
+        else if (!MemoryArena_contains(address, request->data[1]))
+        {
+            status = LOG_BAD_ADDRESS;
+        }
+        else if (!DataLogger_addChannel(me, address, request->data[1]))
+        {
+            status = LOG_NO_ROOM;
+        }
+    }
+    else
+    {
+        switch (request->data[1])
+        {
+        case 0:
+            me->preTriggerRequested = (ubyte2)request->data[3] << 8 | request->data[2];
+            DataLogger_arm(me);
+            break;
+        case 1:
+            DataLogger_trigger(me);
+            break;
+        case 2:
+            if (me->state == LOG_FROZEN || me->state == LOG_UPLOADING)
+            {
+                me->uploadOffset = 0;
+                me->state = LOG_UPLOADING;
+            }
+            else
+            {
+                status = LOG_NOT_FROZEN;
+            }
+            break;
+        case 3:
+            if (me->state == LOG_UPLOADING) { me->state = LOG_FROZEN; }
+            break;
+        default:
+            status = LOG_BAD_REQUEST;
+            break;
+        }
+    }
+
+    response[0] = request->data[0];
+    response[1] = status;
+    response[2] = me->state;
+    response[3] = me->recordSize;
+    response[4] = me->capacity;
+    response[5] = me->capacity >> 8;
+    response[6] = me->preTriggerSamples;
+    response[7] = me->preTriggerSamples >> 8;
+}
+
+ubyte1 DataLogger_getUploadFrames(DataLogger* me, IO_CAN_DATA_FRAME canMessages[], ubyte1 maxMessages)
+{
+    ubyte1 canMessageCount = 0;
+    ubyte2 totalBytes = me->sampleCount * me->recordSize;
+    //Oldest sample is at next once the ring has wrapped, otherwise at 0
+    ubyte4 oldestByte = (me->sampleCount == me->capacity) ? (ubyte4)me->next * me->recordSize : 0;
+    ubyte2 usedBytes = me->capacity * me->recordSize;
+
+    if (me->state != LOG_UPLOADING) { return 0; }
+
+    while (canMessageCount < maxMessages && canMessageCount < LOG_UPLOAD_FRAMES_PER_CYCLE)
+    {
+        IO_CAN_DATA_FRAME* frame = &canMessages[canMessageCount++];
+        frame->id_format = IO_CAN_STD_FRAME;
+        frame->id = LOG_UPLOAD_ID;
+        frame->length = 8;
+
+        if (me->uploadOffset < totalBytes)
+        {
+            frame->data[0] = me->uploadOffset;
+            frame->data[1] = me->uploadOffset >> 8;
+            for (ubyte1 i = 0; i < 6; i++)
+            {
+                ubyte2 offset = me->uploadOffset + i;
+                frame->data[2 + i] = (offset < totalBytes) ? me->buffer[(oldestByte + offset) % usedBytes] : 0;
+            }
+            me->uploadOffset += 6;
+        }
+        else
+        {
+            frame->data[0] = 0xFF;
+            frame->data[1] = 0xFF;
+            frame->data[2] = me->sampleCount;
+            frame->data[3] = me->sampleCount >> 8;
+            frame->data[4] = me->recordSize;
+            frame->data[5] = me->triggerPosition;
+            frame->data[6] = me->triggerPosition >> 8;
+            frame->data[7] = 0;
+            me->state = LOG_FROZEN;
+            break;
+        }
+    }
+
+    return canMessageCount;
+}
@@ -0,0 +1,48 @@
+#ifndef _DATALOGGER_H
+#define _DATALOGGER_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+/*****************************************************************************
+* Onboard RAM data logger
+******************************************************************************
+* Records one sample of a channel set (address + size, up to LOG_RECORD_MAX
+* bytes per sample) every main loop cycle into a RAM ring buffer.  When
+* triggered it keeps recording for the post-trigger part of the buffer, then
+* freezes, so the buffer holds preTriggerSamples before the trigger and the
+* rest after it.
+*
+* Triggers: a new fault bit, DataLogger_trigger (dash button), or a CAN
+* command.  A frozen buffer is uploaded on LOG_UPLOAD_ID a few frames per
+* cycle, only while the car is parked.  See dataLogger.c for the protocol.
+****************************************************************************/
+#define LOG_BUFFER_BYTES 4096
+#define LOG_RECORD_MAX 16           //Bytes per sample (all channels together)
+#define LOG_CHANNELS_MAX 8
+#define LOG_UPLOAD_ID 0x5F0
+#define LOG_UPLOAD_FRAMES_PER_CYCLE 4
+
+typedef struct _DataLogger DataLogger;
+
+DataLogger* DataLogger_new(void);
+
+//Adds a channel and restarts recording with an empty buffer.  Returns FALSE if it doesn't fit
+//or the address range is not inside the memory arena.
+bool DataLogger_addChannel(DataLogger* me, const void* address, ubyte1 size);
+
+//Call once per cycle after the safety checks.  Records one sample (fixed cost) and
+//triggers on any fault bit that was not set last cycle.  Faults already set on the first
+//call after arming (boot, a new channel, or an arm command) do not trigger.
+void DataLogger_record(DataLogger* me, ubyte4 faults);
+
+//Starts the post-trigger countdown (ignored if already triggered or frozen)
+void DataLogger_trigger(DataLogger* me);
+
+//Handles a logger service request from 0x5FF and fills in its 0x5FE response (8 data bytes, zeroed by the caller)
+void DataLogger_handleRequest(DataLogger* me, const IO_CAN_DATA_FRAME* request, ubyte1 response[8]);
+
+//Fills canMessages with the next upload frames (none unless an upload is running).  Returns the frame count.
+ubyte1 DataLogger_getUploadFrames(DataLogger* me, IO_CAN_DATA_FRAME canMessages[], ubyte1 maxMessages);
+
+#endif // _DATALOGGER_H
@@ -0,0 +1,22 @@
+#ifndef _DEBUGSERVICES_H
+#define _DEBUGSERVICES_H
+
+//VCU debug services: requested on 0x5FF with the service code in data[0],
+//answered on 0x5FE with the same code in data[0].  Any other data[0] is passed
+//to the original 0x5FF handlers (0xC4 = safety bypass, data[1] = HVIL override).
+typedef enum
+{
+      DebugService_FaultHistory = 0xD0  //data[1] = page (4 events per page, page 0 = newest)
+    , DebugService_FreezeFrame  = 0xD1  //data[1] = frame age (0 = newest)
+    , DebugService_ParameterRead  = 0xD2  //See parameterTable.c for these three
+    , DebugService_ParameterWrite = 0xD3
+    , DebugService_ParameterInfo  = 0xD4
+    , DebugService_DAQClear       = 0xD5  //See dataAcquisition.c for these three
+    , DebugService_DAQAdd         = 0xD6
+    , DebugService_DAQStart       = 0xD7
+    , DebugService_LoggerChannel  = 0xD8  //See dataLogger.c for these two
+    , DebugService_LoggerControl  = 0xD9
+    , DebugService_Profile        = 0xDA  //See profiler.c
+} DebugService;
+
+#endif // _DEBUGSERVICES_H
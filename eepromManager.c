@@ -0,0 +1,233 @@
+#include <stddef.h>  //offsetof
+
+#include "IO_Driver.h"
+#include "IO_EEPROM.h"
+#include "IO_RTC.h"
+
+#include "eepromManager.h"
+#include "memoryArena.h"
+#include "mathFunctions.h"
+#include "serial.h"
+
+/*****************************************************************************
+* Record layout
+******************************************************************************
+* Two copies of the record are kept, A and B.  Each save goes to the copy that
+* does NOT hold the newest data, with a generation one higher than the newest.
+* The CRC is written last (it is the last field), so if power is lost mid-save
+* the half-written copy fails its CRC and the other copy is still loaded.
+****************************************************************************/
+#define EEPROM_RECORD_A_ADDRESS 0x0000
+#define EEPROM_RECORD_B_ADDRESS 0x0100  //Must be >= sizeof(EEPROMRecord) past A
+#define EEPROM_WRITE_CHUNK 32           //Bytes handed to the driver per cycle
+#define EEPROM_READ_TIMEOUT_US 100000
+#define EEPROM_WRITE_RETRIES 3
+
+typedef struct _EEPROMRecord
+{
+    ubyte2 version;       //EEPROM_LAYOUT_VERSION
+    ubyte2 size;          //sizeof(EEPROMRecord)
+    ubyte4 generation;    //Higher = newer (compared with wraparound)
+    ubyte4 validSlots;    //Bit n set = values[n] has been stored
+    ubyte4 values[EEPROM_SLOT_MAX];
+    ubyte4 crc;           //crc32 of every field above - MUST be last
+} EEPROMRecord;
+
+typedef enum { EEPROM_IDLE, EEPROM_WRITING, EEPROM_FAILED } EEPROMState;
+
+struct _EEPROMManager
+{
+    SerialManager* sm;
+
+    EEPROMRecord current;      //RAM copy used by get/set
+    EEPROMRecord writeBuffer;  //Snapshot being written - the driver reads from it asynchronously
+    ubyte1 activeRecord;       //0 = A, 1 = B: the copy holding the newest valid data
+
+    bool dirty;                //current has changes that are not in EEPROM yet
+    EEPROMState state;
+    ubyte1 writeTarget;
+    ubyte2 writeOffset;        //Bytes of writeBuffer already handed to the driver
+    ubyte1 writeFailures;
+};
+
+static ubyte2 EEPROMManager_recordAddress(ubyte1 record)
+{
+    return (record == 0) ? EEPROM_RECORD_A_ADDRESS : EEPROM_RECORD_B_ADDRESS;
+}
+
+static ubyte4 EEPROMManager_recordCRC(const EEPROMRecord* record)
+{
+    return crc32((const ubyte1*)record, offsetof(EEPROMRecord, crc));
+}
+
+//Boot only: waits for the driver, with a timeout so a dead EEPROM can't hang startup
+static bool EEPROMManager_waitWhileBusy(void)
+{
+    ubyte4 timestamp_start = 0;
+    IO_RTC_StartTime(&timestamp_start);
+    while (IO_EEPROM_GetStatus() == IO_E_BUSY)
+    {
+        if (IO_RTC_GetTimeUS(timestamp_start) > EEPROM_READ_TIMEOUT_US) { return FALSE; }
+    }
+    return TRUE;
+}
+
+static bool EEPROMManager_readRecord(ubyte1 record, EEPROMRecord* data)
+{
+    if (EEPROMManager_waitWhileBusy() == FALSE
+        || IO_EEPROM_Read(EEPROMManager_recordAddress(record), sizeof(EEPROMRecord), (ubyte1*)data) != IO_E_OK
+        || EEPROMManager_waitWhileBusy() == FALSE)
+    {
+        return FALSE;
+    }
+
+    return data->version == EEPROM_LAYOUT_VERSION
+        && data->size == sizeof(EEPROMRecord)
+        && data->crc == EEPROMManager_recordCRC(data);
+}
+
+/*****************************************************************************
+* Constructor - loads both copies once and keeps the newer valid one
+****************************************************************************/
+EEPROMManager* EEPROMManager_new(SerialManager* sm)
+{
+    EEPROMManager* me = (EEPROMManager*)MemoryArena_alloc(sizeof(struct _EEPROMManager));
+    EEPROMRecord recordB;
+    bool validA;
+    bool validB;
+
+    me->sm = sm;
+    me->dirty = FALSE;
+    me->state = EEPROM_IDLE;
+    me->writeTarget = 0;
+    me->writeOffset = 0;
+    me->writeFailures = 0;
+
+    IO_EEPROM_Init();
+
+    validA = EEPROMManager_readRecord(0, &me->current);
+    validB = EEPROMManager_readRecord(1, &recordB);
+
+    if (validB && (!validA || (sbyte4)(recordB.generation - me->current.generation) > 0))
+    {
+        me->current = recordB;
+        me->activeRecord = 1;
+    }
+    else if (validA)
+    {
+        me->activeRecord = 0;
+    }
+    else
+    {
+        //Nothing stored yet (or both copies corrupt) - everyone keeps their defaults
+        me->current.version = EEPROM_LAYOUT_VERSION;
+        me->current.size = sizeof(EEPROMRecord);
+        me->current.generation = 0;
+        me->current.validSlots = 0;
+        for (ubyte1 slot = 0; slot < EEPROM_SLOT_MAX; slot++)
+        {
+            me->current.values[slot] = 0;
+        }
+        me->activeRecord = 1;  //So the first save goes to A
+        SerialManager_send(me->sm, "EEPROM: no valid parameter record, using defaults.\n");
+    }
+
+    if (validA != validB)
+    {
+        SerialManager_send(me->sm, "EEPROM: one parameter record is invalid (interrupted save?).\n");
+    }
+
+    return me;
+}
+
+bool EEPROMManager_get(EEPROMManager* me, EEPROMSlot slot, ubyte4* value)
+{
+    if (slot >= EEPROMSlot_Count || (me->current.validSlots & ((ubyte4)1 << slot)) == 0)
+    {
+        return FALSE;
+    }
+    *value = me->current.values[slot];
+    return TRUE;
+}
+
+void EEPROMManager_set(EEPROMManager* me, EEPROMSlot slot, ubyte4 value)
+{
+    ubyte4 slotBit = (ubyte4)1 << slot;
+
+    if (slot >= EEPROMSlot_Count) { return; }
+    if ((me->current.validSlots & slotBit) > 0 && me->current.values[slot] == value) { return; }
+
+    me->current.values[slot] = value;
+    me->current.validSlots |= slotBit;
+    me->dirty = TRUE;
+}
+
+bool EEPROMManager_isBusy(EEPROMManager* me)
+{
+    return me->dirty || me->state == EEPROM_WRITING;
+}
+
+/*****************************************************************************
+* Background writer
+******************************************************************************
+* Hands at most one EEPROM_WRITE_CHUNK to the driver per call, and only once
+* the previous chunk has finished - it never waits on the EEPROM itself.
+****************************************************************************/
+void EEPROMManager_update(EEPROMManager* me)
+{
+    switch (me->state)
+    {
+    case EEPROM_IDLE:
+        if (me->dirty == FALSE) { break; }
+
+        //Snapshot the RAM copy so later sets can't tear the record being written
+        me->writeBuffer = me->current;
+        me->writeBuffer.generation = me->current.generation + 1;
+        me->writeBuffer.crc = EEPROMManager_recordCRC(&me->writeBuffer);
+        me->writeTarget = me->activeRecord ^ 1;
+        me->writeOffset = 0;
+        me->dirty = FALSE;
+        me->state = EEPROM_WRITING;
+        break;
+
+    case EEPROM_WRITING:
+        if (IO_EEPROM_GetStatus() == IO_E_BUSY) { break; }
+
+        if (me->writeOffset < sizeof(EEPROMRecord))
+        {
+            ubyte2 length = sizeof(EEPROMRecord) - me->writeOffset;
+            IO_ErrorType err;
+            if (length > EEPROM_WRITE_CHUNK) { length = EEPROM_WRITE_CHUNK; }
+
+            err = IO_EEPROM_Write(EEPROMManager_recordAddress(me->writeTarget) + me->writeOffset
+                                  , length, (const ubyte1*)&me->writeBuffer + me->writeOffset);
+            if (err == IO_E_OK)
+            {
+                me->writeOffset += length;
+            }
+            else if (err != IO_E_BUSY)
+            {
+                //Start the whole record over - the target copy is now invalid but the other is intact
+                me->dirty = TRUE;
+                me->state = EEPROM_IDLE;
+                if (++me->writeFailures >= EEPROM_WRITE_RETRIES)
+                {
+                    me->state = EEPROM_FAILED;
+                    SerialManager_send(me->sm, "EEPROM: parameter save failed.\n");
+                }
+            }
+        }
+        else
+        {
+            //Last chunk (with the CRC) is done - this copy is now the newest
+            me->current.generation = me->writeBuffer.generation;
+            me->activeRecord = me->writeTarget;
+            me->writeFailures = 0;
+            me->state = EEPROM_IDLE;
+        }
+        break;
+
+    default:  //EEPROM_FAILED: stop retrying until restart
+        break;
+    }
+}
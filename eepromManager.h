@@ -0,0 +1,59 @@
+#ifndef _EEPROMMANAGER_H
+#define _EEPROMMANAGER_H
+
+#include "IO_Driver.h"
+
+#include "serial.h"
+
+/*****************************************************************************
+* EEPROM parameter store
+******************************************************************************
+* Calibration and tuning values that must survive a power cycle.  Each value
+* lives in a numbered slot (4 bytes, stored raw - floats are stored by their
+* bit pattern).  Slot numbers are part of the EEPROM layout: add new slots at
+* the end, never renumber or reuse old ones.  If the meaning of existing slots
+* must change, bump EEPROM_LAYOUT_VERSION so old records are ignored.
+****************************************************************************/
+#define EEPROM_LAYOUT_VERSION 1
+#define EEPROM_SLOT_MAX 32  //Validity is tracked in a ubyte4 bitmask
+
+typedef enum
+{
+      EEPROMSlot_tps0_calibMin = 0
+    , EEPROMSlot_tps0_calibMax
+    , EEPROMSlot_tps1_calibMin
+    , EEPROMSlot_tps1_calibMax
+    , EEPROMSlot_bps0_calibMin
+    , EEPROMSlot_bps0_calibMax
+    //Persisted tuning parameters (see parameterTable.h)
+    , EEPROMSlot_regenCustom_torqueLimitDNm
+    , EEPROMSlot_regenCustom_torqueAtZeroPedalDNm
+    , EEPROMSlot_regenCustom_percentBPSForMaxRegen
+    , EEPROMSlot_regenCustom_percentAPPSForCoasting
+    , EEPROMSlot_cooling_waterPumpLow
+    , EEPROMSlot_cooling_waterPumpHigh
+    , EEPROMSlot_cooling_motorFanLow
+    , EEPROMSlot_cooling_motorFanHigh
+    , EEPROMSlot_cooling_batteryFanLow
+    , EEPROMSlot_cooling_batteryFanHigh
+    , EEPROMSlot_Count  //Must be <= EEPROM_SLOT_MAX
+} EEPROMSlot;
+
+typedef struct _EEPROMManager EEPROMManager;
+
+//Loads the newest valid record.  Blocks (once, at boot) until both records have been read.
+EEPROMManager* EEPROMManager_new(SerialManager* sm);
+
+//Returns FALSE (and leaves value alone) if the slot has never been stored
+bool EEPROMManager_get(EEPROMManager* me, EEPROMSlot slot, ubyte4* value);
+
+//Changes the RAM copy.  EEPROMManager_update writes it out in the background.
+void EEPROMManager_set(EEPROMManager* me, EEPROMSlot slot, ubyte4 value);
+
+//Call once per main loop cycle.  Never waits on the EEPROM.
+void EEPROMManager_update(EEPROMManager* me);
+
+//TRUE while a change is waiting to be (or being) written
+bool EEPROMManager_isBusy(EEPROMManager* me);
+
+#endif // _EEPROMMANAGER_H
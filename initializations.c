@@ -8,6 +8,7 @@
 #include "IO_PWM.h"
 #include "IO_CAN.h"
 #include "IO_DIO.h"
+#include "IO_RTC.h"
 
 #include "sensors.h"
 #include "initializations.h"
@@ -119,36 +120,106 @@ void vcu_initializeADC(bool benchMode)
 
 }
 
-//----------------------------------------------------------------------------
-// Waste CPU cycles until we have valid data
-//----------------------------------------------------------------------------
-void vcu_ADCWasteLoop(void)
+/*****************************************************************************
+* Boot readiness
+******************************************************************************
+* Instead of fixed delays, run short driver cycles until each input has
+* produced trustworthy data, with the old fixed delays as the upper bound.
+* - Digital inputs return valid data after 2 driver cycles (no fresh flag),
+*   so a switch is trusted once it has read the same value twice after that.
+* - Analog inputs are trusted after SENSOR_READY_STABLE_READS fresh readings
+*   in a row inside the sensor's plausible range (ratiometric 0.5-4.5V pedal
+*   sensors: anything near a rail means open/short circuit or not powered).
+*   Resistive bench pots have no such range, so only freshness is checked.
+****************************************************************************/
+#define BOOT_CYCLE_US 5000
+#define BENCH_DETECT_TIMEOUT_US 55555
+#define SENSOR_READY_TIMEOUT_US 1000000
+#define SENSOR_READY_STABLE_READS 2
+#define DI_VALID_AFTER_CYCLES 2
+
+//Waits until the cycle started at timestamp_cycle has lasted BOOT_CYCLE_US
+static void vcu_bootCycleEnd(ubyte4 timestamp_cycle)
+{
+    IO_Driver_TaskEnd();
+    while (IO_RTC_GetTimeUS(timestamp_cycle) < BOOT_CYCLE_US);
+}
+
+bool vcu_detectBenchMode(void)
 {
-    bool tempFresh = FALSE;
-    ubyte2 tempData;
-    ubyte4 timestamp_sensorpoll = 0;
-    IO_RTC_StartTime(&timestamp_sensorpoll);
-    while (IO_RTC_GetTimeUS(timestamp_sensorpoll) < 1000000)
+    bool bench = FALSE;
+    bool lastBench = FALSE;
+    ubyte1 cycles = 0;
+    ubyte1 matchingReads = 0;
+    ubyte4 timestamp_start = 0;
+    ubyte4 timestamp_cycle = 0;
+
+    IO_DI_Init(IO_DI_06, IO_DI_PD_10K);
+    IO_RTC_StartTime(&timestamp_start);
+    while (matchingReads < 2 && IO_RTC_GetTimeUS(timestamp_start) < BENCH_DETECT_TIMEOUT_US)
     {
+        IO_RTC_StartTime(&timestamp_cycle);
         IO_Driver_TaskBegin();
 
-        IO_PWM_SetDuty(IO_PWM_07, 0, NULL);  //Pin 103
+        IO_DI_Get(IO_DI_06, &bench);
+        if (++cycles > DI_VALID_AFTER_CYCLES)
+        {
+            matchingReads = (matchingReads > 0 && bench == lastBench) ? matchingReads + 1 : 1;
+        }
+        lastBench = bench;
+
+        vcu_bootCycleEnd(timestamp_cycle);
+    }
+    IO_DI_DeInit(IO_DI_06);
 
+    return bench;
+}
+
+ubyte1 vcu_waitForSensors(bool benchMode)
+{
+    //Ratiometric limits in mV; the bench's resistive pots accept any value
+    const ubyte1 channels[3] = { IO_ADC_5V_00, IO_ADC_5V_01, IO_ADC_5V_02 };
+    const ubyte1 channelBits[3] = { SENSOR_NOT_READY_TPS0, SENSOR_NOT_READY_TPS1, SENSOR_NOT_READY_BPS0 };
+    ubyte4 plausibleMin = benchMode ? 0 : 200;
+    ubyte4 plausibleMax = benchMode ? 0xFFFFFFFF : 4800;
+    ubyte1 goodReads[3] = { 0, 0, 0 };
+    ubyte1 notReady = SENSOR_NOT_READY_TPS0 | SENSOR_NOT_READY_TPS1 | SENSOR_NOT_READY_BPS0 | SENSOR_NOT_READY_SWITCHES;
+    ubyte1 cycles = 0;
+    ubyte4 value;
+    bool fresh;
+    bool tempSwitch;
+    ubyte4 timestamp_start = 0;
+    ubyte4 timestamp_cycle = 0;
+
+    IO_RTC_StartTime(&timestamp_start);
+    while (notReady != 0 && IO_RTC_GetTimeUS(timestamp_start) < SENSOR_READY_TIMEOUT_US)
+    {
+        IO_RTC_StartTime(&timestamp_cycle);
+        IO_Driver_TaskBegin();
+
+        //Keep the RTD sound and MCM relay off until the main loop takes over
+        IO_PWM_SetDuty(IO_PWM_07, 0, NULL);  //Pin 103
         IO_DO_Set(IO_DO_00, FALSE); //False = low
-        //IO_DO_Set(IO_DO_01, FALSE); //HVIL shutdown relay
-        //IO_DO_Set(IO_DO_06, FALSE); //Front WSS x2
-        //IO_DO_Set(IO_DO_07, FALSE); //Rear  WSS x2
-
-        //IO_DI (digital inputs) supposed to take 2 cycles before they return valid data
-        IO_DI_Get(IO_DI_04, &tempData);
-        IO_DI_Get(IO_DI_05, &tempData);
-        IO_ADC_Get(IO_ADC_5V_00, &tempData, &tempFresh);
-        IO_ADC_Get(IO_ADC_5V_01, &tempData, &tempFresh);
-
-        IO_Driver_TaskEnd();
-        //TODO: Find out if EACH pin needs 2 cycles or just the entire DIO unit
-        while (IO_RTC_GetTimeUS(timestamp_sensorpoll) < 12500);   // wait until 1/8/10s (125ms) have passed
+
+        for (ubyte1 i = 0; i < 3; i++)
+        {
+            fresh = FALSE;
+            IO_ADC_Get(channels[i], &value, &fresh);
+            goodReads[i] = (fresh == TRUE && value >= plausibleMin && value <= plausibleMax) ? goodReads[i] + 1 : 0;
+            if (goodReads[i] >= SENSOR_READY_STABLE_READS) { notReady &= ~channelBits[i]; }
+        }
+
+        IO_DI_Get(IO_DI_00, &tempSwitch);
+        IO_DI_Get(IO_DI_01, &tempSwitch);
+        IO_DI_Get(IO_DI_02, &tempSwitch);
+        IO_DI_Get(IO_DI_03, &tempSwitch);
+        IO_DI_Get(IO_DI_07, &tempSwitch);
+        if (++cycles >= DI_VALID_AFTER_CYCLES) { notReady &= ~SENSOR_NOT_READY_SWITCHES; }
+
+        vcu_bootCycleEnd(timestamp_cycle);
     }
+
+    return notReady;
 }
 
 /*****************************************************************************
@@ -22,5 +22,15 @@ void vcu_initializeVCU(void);
 void vcu_initializeADC(bool benchMode);
 void vcu_initializeCAN(void);
 void vcu_initializeMCU(void);
-void vcu_ADCWasteLoop(void);
+
+//Reads the bench mode switch (IO_DI_06) as soon as it gives a stable reading (55 ms at most)
+bool vcu_detectBenchMode(void);
+
+//Runs driver cycles until the pedal sensors and switches give trustworthy data, or 1 s has passed.
+//Returns the SENSOR_NOT_READY_ bits of the inputs that never became ready (0 = all ready).
+#define SENSOR_NOT_READY_TPS0     0x01
+#define SENSOR_NOT_READY_TPS1     0x02
+#define SENSOR_NOT_READY_BPS0     0x04
+#define SENSOR_NOT_READY_SWITCHES 0x08
+ubyte1 vcu_waitForSensors(bool benchMode);
 #endif //  _INITIALIZEVCU_H
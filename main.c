@@ -46,6 +46,14 @@
 #include "sensorCalculations.h"
 #include "serial.h"
 #include "cooling.h"
+#include "eepromManager.h"
+#include "parameterTable.h"
+#include "dataAcquisition.h"
+#include "dataLogger.h"
+#include "memoryArena.h"
+#include "profiler.h"
+#include "cycleClock.h"
+#include "vehicleState.h"
 
 //Application Database, needed for TTC-Downloader
 APDB appl_db =
@@ -107,8 +115,12 @@ extern Sensor Sensor_EcoButton;
 void main(void)
 {
     ubyte4 timestamp_startTime = 0;
-    ubyte4 timestamp_EcoButton = 0;
+    ubyte4 timestamp_bootPhase = 0;
+    ubyte2 bootEEPROM_ms, bootBenchDetect_ms, bootSensors_ms, bootTotal_ms;
+    ubyte1 sensorsNotReady;
+    ubyte8 timestamp_EcoButton = CYCLECLOCK_NEVER;
     ubyte1 calibrationErrors;  //NOT USED
+    bool calibrationWasRunning;
     
     /*******************************************/
     /*        Low Level Initializations        */
@@ -118,11 +130,14 @@ void main(void)
     //Initialize serial first so we can use it to debug init of other subsystems
     SerialManager* serialMan = SerialManager_new();
     IO_RTC_StartTime(&timestamp_startTime);
+    CycleClock_init();
     SerialManager_send(serialMan, "\n\n\n\n\n\n\n\n\n\n----------------------------------------------------\n");
     SerialManager_send(serialMan, "VCU serial is online.\n");
 
-    //Read initial values from EEPROM
-    //EEPROMManager* EEPROMManager_new();
+    //Read initial values from EEPROM (one blocking pass - the main loop isn't running yet)
+    IO_RTC_StartTime(&timestamp_bootPhase);
+    EEPROMManager* eepromMan = EEPROMManager_new(serialMan);
+    bootEEPROM_ms = IO_RTC_GetTimeUS(timestamp_bootPhase) / 1000;
 
 
     /*******************************************/
@@ -133,21 +148,9 @@ void main(void)
     //----------------------------------------------------------------------------
     // Check if we're on the bench or not
     //----------------------------------------------------------------------------
-    bool bench;
-    IO_DI_Init(IO_DI_06, IO_DI_PD_10K);
-    IO_RTC_StartTime(&timestamp_startTime);
-    while (IO_RTC_GetTimeUS(timestamp_startTime) < 55555)
-    {
-        IO_Driver_TaskBegin();
-
-        //IO_DI (digital inputs) supposed to take 2 cycles before they return valid data
-        IO_DI_Get(IO_DI_06, &bench);
-
-        IO_Driver_TaskEnd();
-        //TODO: Find out if EACH pin needs 2 cycles or just the entire DIO unit
-        while (IO_RTC_GetTimeUS(timestamp_startTime) < 10000);   // wait until 10ms have passed
-    }
-    IO_DI_DeInit(IO_DI_06);
+    IO_RTC_StartTime(&timestamp_bootPhase);
+    bool bench = vcu_detectBenchMode();
+    bootBenchDetect_ms = IO_RTC_GetTimeUS(timestamp_bootPhase) / 1000;
     SerialManager_send(serialMan, bench == TRUE ? "VCU is in bench mode.\n" : "VCU is NOT in bench mode.\n");
     
     //----------------------------------------------------------------------------
@@ -160,8 +163,10 @@ void main(void)
     //vcu_initializeCAN();
     //vcu_initializeMCU();
 
-    //Do some loops until the ADC stops outputting garbage values
-    vcu_ADCWasteLoop();
+    //Wait until the pedal sensors and switches give trustworthy data (not a fixed delay)
+    IO_RTC_StartTime(&timestamp_bootPhase);
+    sensorsNotReady = vcu_waitForSensors(bench);
+    bootSensors_ms = IO_RTC_GetTimeUS(timestamp_bootPhase) / 1000;
 
     //vcu_init functions may have to be performed BEFORE creating CAN Manager object
     CanManager* canMan = CanManager_new(500, 40, 40, 500, 20, 20, 200000, serialMan);  //3rd param = messages per node (can0/can1; read/write)
@@ -180,18 +185,46 @@ void main(void)
     //----------------------------------------------------------------------------    
     ReadyToDriveSound* rtds = RTDS_new();
 	//BatteryManagementSystem* bms = BMS_new();
-    MotorController* mcm0 = MotorController_new(serialMan, 0xA0, FORWARD, 1000, 5, 15); //CAN addr, direction, torque limit x10 (100 = 10Nm)
+    //CAN addr, torque limit x10 (100 = 10Nm), direction, min regen speed, regen rampdown start speed
+    static const MCMConfig mcm0Config = { 0xA0, 1000, FORWARD, 5, 15 };
+    MotorController* mcm0 = MotorController_new(serialMan, &mcm0Config);
 	TorqueEncoder* tps = TorqueEncoder_new(bench);
 	BrakePressureSensor* bps = BrakePressureSensor_new();
+    TorqueEncoder_loadCalibrationFromEEPROM(tps, eepromMan);
+    BrakePressureSensor_loadCalibrationFromEEPROM(bps, eepromMan);
 	WheelSpeeds* wss = WheelSpeeds_new(18, 18, 16, 16);
 	SafetyChecker* sc = SafetyChecker_new(serialMan, 320, 32);  //Must match amp limits 
 	BatteryManagementSystem* bms = BMS_new(serialMan, 0x620);
     CoolingSystem* cs = CoolingSystem_new(serialMan);
 
+    //Tunable values - registering also loads any saved over the defaults above
+    ParameterTable* params = ParameterTable_new(eepromMan);
+    MCM_registerParameters(mcm0, params);
+    CoolingSystem_registerParameters(cs, params);
+
+    //Measurement lists - empty until a host configures them over CAN
+    DataAcquisition* daq = DAQ_new();
+    Profiler* profiler = Profiler_new(serialMan);
+
+    //RAM logger - default channels catch pedal implausibility trips; hosts can change them over CAN
+    DataLogger* logger = DataLogger_new();
+    DataLogger_addChannel(logger, &tps->tps0_value, sizeof(tps->tps0_value));
+    DataLogger_addChannel(logger, &tps->tps1_value, sizeof(tps->tps1_value));
+    DataLogger_addChannel(logger, &tps->percent, sizeof(tps->percent));
+    DataLogger_addChannel(logger, &bps->percent, sizeof(bps->percent));
+
+    CanReceivers canReceivers = { mcm0, bms, sc, params, daq, logger, profiler };
+
+    //Every object has been created by now - only new outgoing CAN IDs allocate after this point (MemoryArena_tryAlloc)
+    MemoryArena_report(serialMan);
+    static ubyte1 message[96];  //Boot messages only - main's frame is never released, so keep it small
+    sprintf(message, "MCM object %u bytes (%u hot), BMS object %u bytes (%u hot)\n"
+        , MCM_stateBytes, MCM_hotStateBytes, BMS_stateBytes, BMS_hotStateBytes);
+    SerialManager_send(serialMan, message);
+
     //----------------------------------------------------------------------------
     // TODO: Additional Initial Power-up functions
     //----------------------------------------------------------------------------
-    //TODO: Read calibration data from EEPROM?
     //TODO: Run calibration functions?
     //TODO: Power-on error checking?
 
@@ -199,18 +232,28 @@ void main(void)
     /*       PERIODIC APPLICATION CODE         */
     /*******************************************/
     /* main loop, executed periodically with a defined cycle time (here: 5 ms) */
-    ubyte4 timestamp_mainLoopStart = 0;
     //IO_RTC_StartTime(&timestamp_calibStart);
+    bootTotal_ms = IO_RTC_GetTimeUS(timestamp_startTime) / 1000;
+    sprintf(message, "Boot: EEPROM %u ms, bench switch %u ms, sensors %u ms, total %u ms\n"
+        , bootEEPROM_ms, bootBenchDetect_ms, bootSensors_ms, bootTotal_ms);
+    SerialManager_send(serialMan, message);
+    if (sensorsNotReady != 0)
+    {
+        sprintf(message, "Inputs never became ready (0x%02X) - continuing anyway\n", sensorsNotReady);
+        SerialManager_send(serialMan, message);
+    }
+    canOutput_sendBootTiming(canMan, bootEEPROM_ms, bootBenchDetect_ms, bootSensors_ms, bootTotal_ms);
     SerialManager_send(serialMan, "VCU initializations complete.  Entering main loop.\n");
     while (1)
     {
         //----------------------------------------------------------------------------
         // Task management stuff (start)
         //----------------------------------------------------------------------------
-        //Get a timestamp of when this task started from the Real Time Clock
-        IO_RTC_StartTime(&timestamp_mainLoopStart);
+        //Sample the Real Time Clock once - everything timed this cycle uses CycleClock_now
+        CycleClock_update();
         //Mark the beginning of a task - what does this actually do?
         IO_Driver_TaskBegin();
+        Profiler_start(profiler, ProfileSection_Cycle);
 
         //SerialManager_send(serialMan, "VCU has entered main loop.");
 
@@ -225,8 +268,11 @@ void main(void)
 		sensors_updateSensors();
 
         //Pull messages from CAN FIFO and update our object representations.
-        //Also echoes can0 messages to can1 for DAQ.
-        CanManager_read(canMan, CAN0_HIPRI, mcm0, bms, sc);
+        //Also echoes them to can1 for DAQ - only the subscribed IDs (RMS, BMS,
+        //0x5FF), since the acceptance filters drop the rest of can0's traffic.
+        CanManager_read(canMan, CAN0_HIPRI, &canReceivers);
+        //Report any node whose required messages have stopped arriving
+        CanManager_checkTimeouts(canMan, sc);
         /*switch (CanManager_getReadStatus(canMan, CAN0_HIPRI))
         {
             case IO_E_OK: SerialManager_send(serialMan, "IO_E_OK: everything fine\n"); break;
@@ -250,12 +296,12 @@ void main(void)
 		//if (IO_RTC_GetTimeUS(timestamp_calibStart) < (ubyte4)5000000)
 		if (Sensor_EcoButton.sensorValue == TRUE)
 		{
-            if (timestamp_EcoButton == 0)
+            if (timestamp_EcoButton == CYCLECLOCK_NEVER)
             {
                 SerialManager_send(serialMan, "Eco button detected\n");
-                IO_RTC_StartTime(&timestamp_EcoButton);
+                timestamp_EcoButton = CycleClock_now();
             }
-            else if (IO_RTC_GetTimeUS(timestamp_EcoButton) >= 3000000)
+            else if (CycleClock_since(timestamp_EcoButton) >= 3000000)
             {
                 SerialManager_send(serialMan, "Eco button held 3s - starting calibrations\n");
                 //calibrateTPS(TRUE, 5);
@@ -267,17 +313,25 @@ void main(void)
 		}
         else
         {
-            if (IO_RTC_GetTimeUS(timestamp_EcoButton) > 10000 && IO_RTC_GetTimeUS(timestamp_EcoButton) < 1000000)
+            if (CycleClock_since(timestamp_EcoButton) > 10000 && CycleClock_since(timestamp_EcoButton) < 1000000)
             {
                 SerialManager_send(serialMan, "Eco mode requested\n");
+                DataLogger_trigger(logger);  //Short press also marks the moment in the RAM log
             }
-            timestamp_EcoButton = 0;
+            timestamp_EcoButton = CYCLECLOCK_NEVER;
         }
 		TorqueEncoder_update(tps);
         //Every cycle: if the calibration was started and hasn't finished, check the values again
+        calibrationWasRunning = tps->runCalibration || bps->runCalibration;
         TorqueEncoder_calibrationCycle(tps, &calibrationErrors); //Todo: deal with calibration errors
 		BrakePressureSensor_update(bps, bench);
 		BrakePressureSensor_calibrationCycle(bps, &calibrationErrors);
+        //Calibration just finished: queue it for EEPROM (written in the background by EEPROMManager_update)
+        if (calibrationWasRunning && !tps->runCalibration && !bps->runCalibration)
+        {
+            TorqueEncoder_saveCalibrationToEEPROM(tps, eepromMan);
+            BrakePressureSensor_saveCalibrationToEEPROM(bps, eepromMan);
+        }
 
 		//TractionControl_update(tps, mcm0, wss, daq);
 
@@ -291,6 +345,10 @@ void main(void)
 			StateObserver //choose driver command or ctrl law
 		*/	
 
+        //Acquisition is done - everything below works from this one snapshot
+        VehicleState_publish(tps, bps, wss);
+        const VehicleState* state = VehicleState_get();
+
         CoolingSystem_calculations(cs, MCM_getTemp(mcm0), MCM_getMotorTemp(mcm0), BMS_getMaxTemp(bms));
         //CoolingSystem_calculations(cs, 20, 20, 20);
         CoolingSystem_enactCooling(cs); //This belongs under outputs but it doesn't really matter for cooling
@@ -298,16 +356,19 @@ void main(void)
         //Assign motor controls to MCM command message
         //motorController_setCommands(rtds);
         //DOES NOT set inverter command or rtds flag
-        MCM_readTCSSettings(mcm0, &Sensor_TCSSwitchUp, &Sensor_TCSSwitchDown, &Sensor_TCSKnob);
-        MCM_calculateCommands(mcm0, tps, bps);
+        MCM_readTCSSettings(mcm0, &state->tcsSwitchUp, &state->tcsSwitchDown, &state->tcsKnob);
+        MCM_calculateCommands(mcm0, state);
 
-        SafetyChecker_update(sc, mcm0, bms, tps, bps, &Sensor_HVILTerminationSense, &Sensor_LVBattery);
+        SafetyChecker_update(sc, mcm0, bms, state);
 
         /*******************************************/
         /*  Output Adjustments by Safety Checker   */
         /*******************************************/
         SafetyChecker_reduceTorque(sc, mcm0, bms);
 
+        //One sample per cycle; a new fault freezes the log around it
+        DataLogger_record(logger, SafetyChecker_getFaults(sc));
+
         /*******************************************/
         /*              Enact Outputs              */
         /*******************************************/
@@ -315,15 +376,24 @@ void main(void)
         //SafetyChecker_setErrorLight(sc);
         Light_set(Light_dashError, (SafetyChecker_getFaults(sc) == 0) ? 0 : 1);
         //Handle motor controller startup procedures
-        MCM_relayControl(mcm0, &Sensor_HVILTerminationSense);
-        MCM_inverterControl(mcm0, tps, bps, rtds);
+        MCM_relayControl(mcm0, state);
+        MCM_inverterControl(mcm0, state, rtds);
+        if (canOutput_sendMCMCommand(canMan, mcm0))  //Before any telemetry is queued
+        {
+            Profiler_recordLatency(profiler, MCM_commands_getTorqueSampleTime(mcm0));
+        }
         //CanManager_sendMCMCommandMessage(mcm0, canMan, FALSE);
 
         //Drop the sensor readings into CAN (just raw data, not calculated stuff)
         //canOutput_sendMCUControl(mcm0, FALSE);
 
         //Send debug data
-        canOutput_sendDebugMessage(canMan, tps, bps, mcm0, wss, sc);
+        canOutput_sendDebugMessage(canMan, state, mcm0, sc);
+        canOutput_sendDebugResponses(canMan, sc);
+        canOutput_sendDAQ(canMan, daq);
+        canOutput_sendLoggerUpload(canMan, logger, mcm0);
+        canOutput_sendLatency(canMan, profiler);
+        canOutput_sendCanHealth(canMan);
         //canOutput_sendSensorMessages();
         //canOutput_sendStatusMessages(mcm0);
 
@@ -333,13 +403,16 @@ void main(void)
         // Task management stuff (end)
         //----------------------------------------------------------------------------
         RTDS_shutdownHelper(rtds); //Stops the RTDS from playing if the set time has elapsed
+        EEPROMManager_update(eepromMan); //Writes at most one chunk of any pending parameter changes
+        Profiler_stop(profiler, ProfileSection_Cycle);
 
         //Task end function for IO Driver - This function needs to be called at the end of every SW cycle
         IO_Driver_TaskEnd();
         //wait until the cycle time is over
-        while (IO_RTC_GetTimeUS(timestamp_mainLoopStart) < 33000) // 1000 = 1ms
+        while (CycleClock_getCycleElapsedUS() < 33000) // 1000 = 1ms
         {
             IO_UART_Task();  //The task function shall be called every SW cycle.
+            CanManager_poll(canMan);  //Keep the CAN0 hardware FIFO empty between reads
         }
 
     } //end of main loop
@@ -78,6 +78,23 @@ bool blink(ubyte4* clock, ubyte2 highPeriod)
 
 
 
+ubyte4 crc32(const ubyte1* data, ubyte4 length)
+{
+    ubyte4 crc = 0xFFFFFFFF;
+
+    for (ubyte4 i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        for (ubyte1 bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+
+    return ~crc;
+}
+
+
 //byte swapping functions used by BMS
 
 ubyte1 swap_uint8(ubyte1 val)
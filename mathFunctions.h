@@ -18,6 +18,23 @@ float4 getPercent(float4 value, float4 start, float4 end, bool zeroToOneOnly);
 ubyte2 max(ubyte2 a, ubyte2 b);
 
 
+/*-------------------------------------------------------------------
+* crc32
+* Standard CRC-32 (poly 0xEDB88320, init/xorout 0xFFFFFFFF) over length bytes.
+* Bitwise - no lookup table - so it costs no RAM/flash but is slow; only use
+* it on small blocks (EEPROM records), not every cycle.
+-------------------------------------------------------------------*/
+ubyte4 crc32(const ubyte1* data, ubyte4 length);
+
+
+/*-------------------------------------------------------------------
+* COMPILE_TIME_ASSERT
+* Breaks the build (negative array size) when cond is false.  name must be
+* unique within the file and shows up in the compiler error.
+-------------------------------------------------------------------*/
+#define COMPILE_TIME_ASSERT(cond, name) typedef char compileTimeAssert_##name[(cond) ? 1 : -1]
+
+
 /*
 *  Functions for endian conversion
 */
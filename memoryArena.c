@@ -0,0 +1,79 @@
+#include <stdio.h>  //sprintf
+#include <string.h> //strlen
+
+#include "IO_Driver.h"
+#include "IO_UART.h"
+
+#include "memoryArena.h"
+#include "serial.h"
+
+//ubyte4 elements so the start of the arena is aligned for any object
+static ubyte4 arena[MEMORY_ARENA_BYTES / sizeof(ubyte4)];
+static ubyte4 arenaUsed = 0;
+static ubyte4 arenaShortfall = 0;  //Bytes tryAlloc was asked for that did not fit
+
+void* MemoryArena_tryAlloc(ubyte4 size)
+{
+    void* block;
+
+    size = (size + MEMORY_ARENA_ALIGN - 1) / MEMORY_ARENA_ALIGN * MEMORY_ARENA_ALIGN;
+    if (size > MEMORY_ARENA_BYTES - arenaUsed)
+    {
+        arenaShortfall += size;
+        return NULL;
+    }
+
+    block = (ubyte1*)arena + arenaUsed;
+    arenaUsed += size;
+    return block;
+}
+
+void* MemoryArena_alloc(ubyte4 size)
+{
+    void* block = MemoryArena_tryAlloc(size);
+    ubyte1 line[96];
+    ubyte1 written;
+
+    if (block != NULL) { return block; }
+
+    //Every constructor writes to its object straight away, so there is no way to carry on.
+    //SerialManager_new is the first allocation and can't fail, so the UART is already up.
+    sprintf(line, "MEMORY ARENA TOO SMALL: %lu bytes requested, %lu free - raise MEMORY_ARENA_BYTES\n"
+        , (unsigned long)size, (unsigned long)(MEMORY_ARENA_BYTES - arenaUsed));
+    IO_UART_Write(IO_UART_CH0, line, strlen(line), &written);
+    while (TRUE)
+    {
+        IO_UART_Task();
+    }
+}
+
+bool MemoryArena_contains(const void* address, ubyte4 size)
+{
+    const ubyte1* start = (const ubyte1*)arena;
+    const ubyte1* bytes = (const ubyte1*)address;
+
+    return bytes >= start && size <= arenaUsed && bytes <= start + arenaUsed - size;
+}
+
+ubyte4 MemoryArena_getUsed(void)
+{
+    return arenaUsed;
+}
+
+ubyte4 MemoryArena_getFree(void)
+{
+    return MEMORY_ARENA_BYTES - arenaUsed;
+}
+
+void MemoryArena_report(SerialManager* sm)
+{
+    ubyte1 line[96];
+
+    sprintf(line, "Memory arena at 0x%06lX: %lu bytes used, %lu free\n", (unsigned long)arena, (unsigned long)arenaUsed, (unsigned long)(MEMORY_ARENA_BYTES - arenaUsed));
+    SerialManager_send(sm, line);
+    if (arenaShortfall > 0)
+    {
+        sprintf(line, "Memory arena full: %lu bytes of history nodes dropped\n", (unsigned long)arenaShortfall);
+        SerialManager_send(sm, line);
+    }
+}
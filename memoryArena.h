@@ -0,0 +1,48 @@
+#ifndef _MEMORYARENA_H
+#define _MEMORYARENA_H
+
+#include "IO_Driver.h"
+
+#include "serial.h"
+
+/*****************************************************************************
+* Static memory arena
+******************************************************************************
+* Every object is created once at boot and lives until power off, so instead
+* of a heap the constructors take their memory from one statically sized
+* block.  Nothing is ever freed.  The block shows up in the linker map file,
+* and MemoryArena_report prints how much of it boot actually used.
+*
+* Constructors use MemoryArena_alloc, which never returns NULL: if an object
+* doesn't fit it prints the shortfall on serial and halts before the main
+* loop has started, so nothing is driven.  Raise MEMORY_ARENA_BYTES until it
+* boots.  Allocations made while the car is running (CAN history nodes for
+* new outgoing IDs) use MemoryArena_tryAlloc instead and cope with NULL.
+*
+* Measured with 32-bit pointers (gcc -m32 sizeof): the boot objects take
+* 20440 bytes, 10348 of them CanManager, plus 26 history nodes of 28 bytes
+* created by CanManager_new - 21168 bytes, leaving room for about 120
+* history nodes created at run time.
+****************************************************************************/
+#ifndef MEMORY_ARENA_BYTES  //Host builds (replay/) have 64-bit pointers and need more
+#define MEMORY_ARENA_BYTES 24576
+#endif
+#define MEMORY_ARENA_ALIGN 4   //Largest alignment any stored type needs on the XC2000 (ubyte4/ubyte8/float4/pointers)
+
+//Returns size bytes (rounded up to MEMORY_ARENA_ALIGN).  Boot only: halts if the arena is full.
+void* MemoryArena_alloc(ubyte4 size);
+
+//As MemoryArena_alloc, but returns NULL (and counts the shortfall) if the arena is full
+void* MemoryArena_tryAlloc(ubyte4 size);
+
+//TRUE if all size bytes from address lie in memory the arena has handed out.  Used
+//to vet addresses that arrive over CAN before anything reads through them.
+bool MemoryArena_contains(const void* address, ubyte4 size);
+
+ubyte4 MemoryArena_getUsed(void);
+ubyte4 MemoryArena_getFree(void);
+
+//Prints bytes used/free (and any tryAlloc shortfall) to serial.  Call after every object has been created.
+void MemoryArena_report(SerialManager* sm);
+
+#endif // _MEMORYARENA_H
@@ -1,10 +1,13 @@
-#include <stdlib.h>  //Needed for malloc
+#include <stddef.h>  //offsetof
+
 #include "IO_Driver.h"
 #include "IO_DIO.h"     //TEMPORARY - until MCM relay control  / ADC stuff gets its own object
 #include "IO_RTC.h"
 #include "IO_CAN.h"
 
 #include "motorController.h"
+#include "memoryArena.h"
+#include "cycleClock.h"
 #include "mathFunctions.h"
 #include "sensors.h"
 #include "sensorCalculations.h"
@@ -17,16 +20,6 @@
 #include "canManager.h"
 
 
-extern Sensor Sensor_BenchTPS0;
-extern Sensor Sensor_BenchTPS1;
-
-extern Sensor Sensor_RTDButton;
-extern Sensor Sensor_EcoButton;
-extern Sensor Sensor_TCSSwitchUp; // used currently for regen
-extern Sensor Sensor_TCSSwitchDown; // used currently for regen
-extern Sensor Sensor_TCSKnob;    // used currently for regen
-extern Sensor Sensor_HVILTerminationSense;
-
 /*****************************************************************************
  * Motor Controller (MCM)
  ******************************************************************************
@@ -34,107 +27,82 @@ extern Sensor Sensor_HVILTerminationSense;
  ****************************************************************************/
 
 struct _MotorController {
-    SerialManager* serialMan;
 	//----------------------------------------------------------------------------
-	// Controller statuses/properties
+	// Hot state - read or written every cycle
 	//----------------------------------------------------------------------------
-	// These represent the state of the controller (set at run time, not compile
-	// time.)  These are updated by canInput.c
+	// Widest fields first so the compiler adds no padding.  Keep new per-cycle
+	// fields in here (and in the right size group), above the cold block.
 	//----------------------------------------------------------------------------
-	ubyte2 canMessageBaseId;  //Starting message ID for messages that will come in from this controller
-	ubyte4 timeStamp_inverterEnabled;
+    ubyte8 timeStamp_lastCommandSent;  //from CycleClock_now()
+    ubyte8 timeStamp_HVILLost;
+    ubyte8 timeStamp_HVILOverrideCommandReceived;
+    ubyte8 timeStamp_torqueSampled;    //Pedal sample behind commands_torque (from TorqueEncoder)
+
+    const MCMConfig* config;
+    SerialManager* serialMan;
+
+	sbyte4 DC_Voltage;
+	sbyte4 DC_Current;
+
+	float4 regen_percentBPSForMaxRegen;   //Tuneable value.  Amount of brake pedal required for full regen. Value between zero and one.
+	float4 regen_percentAPPSForCoasting;  //Tuneable value.  Amount of accel pedal required to exit regen.  Value between zero and one.
 
     //Motor controller torque units are in 10ths (500 = 50.0 Nm)
     //Positive = accel, negative = regen
     //Reverse not allowed
-	ubyte2 torqueMaximumDNm;  //Max torque that can be commanded in deciNewton*meters ("100" = 10.0 Nm)
-	
-	//Regen torque calculations in whole Nm..?
-	ubyte1 regen_mode;					  //Software reading of regen knob position.  Each mode has different regen behavior (variables below).
+	sbyte2 commands_torque;
+	sbyte2 commands_torqueLimit;
+	sbyte2 commands_torqueSent;       //commands_torque as of the last 0xC0 (see MCM_commands_isSendDue)
+	sbyte2 commandedTorque;
+	sbyte2 motorRPM;
+	sbyte2 motor_temp;
+	ubyte2 torqueMaximumDNm;  //Max torque that can be commanded in deciNewton*meters ("100" = 10.0 Nm).  Tunable up to config->torqueMaximumDNm.
 	ubyte2 regen_torqueLimitDNm;          //Tuneable value.  Regen torque (in Nm) at full regen.  Positive value.
 	ubyte2 regen_torqueAtZeroPedalDNm;    //Tuneable value.  Amount of regen torque (in Nm) to apply when both pedals at 0% travel.  Positive value.
-	float4 regen_percentBPSForMaxRegen;   //Tuneable value.  Amount of brake pedal required for full regen. Value between zero and one.
-	float4 regen_percentAPPSForCoasting;  //Tuneable value.  Amount of accel pedal required to exit regen.  Value between zero and one.
-    sbyte1 regen_minimumSpeedKPH;  //Assigned by main
-    sbyte1 regen_SpeedRampStart;
+	ubyte2 updateCount; //Number of updates since lastCommandSent
 
+    Status lockoutStatus;
+	Status inverterStatus;
+	//unused/unused/unused/unused unused/unused/Discharge/Inverter Enable
+	Status commands_discharge;
+	Status commands_inverter;
+
+	ubyte1 regen_mode;					  //Software reading of regen knob position.  Each mode has different regen behavior (variables above).
+	ubyte1 commands_direction;
+    ubyte1 startupStage;
     bool relayState;
     bool previousHVILState;
-    ubyte4 timeStamp_HVILLost;
-
-    ubyte4 timeStamp_HVILOverrideCommandReceived;
     bool HVILOverride;
-
-    ubyte1 startupStage;
-    Status lockoutStatus;
-	Status inverterStatus;
 	bool startRTDS;
-	/*ubyte4 vsmStatus0;      //0xAA Byte 0,1
-    ubyte4 vsmStatus1;      //0xAA Byte 0,1
-    ubyte4 vsmStatus2;      //0xAA Byte 0,1
-    ubyte4 vsmStatus3;      //0xAA Byte 0,1
-    ubyte4 faultCodesPOST; //0xAB Byte 0-3
-    ubyte4 faultCodesRUN;  //0xAB Byte 4-7*/
-
-    ubyte1 faultHistory[8];
-
-	sbyte2 motor_temp;
-	sbyte4 DC_Voltage;
-	sbyte4 DC_Current;
-
-	sbyte2 commandedTorque;
-	ubyte4 currentPower;
 
-	sbyte2 motorRPM;
-	//----------------------------------------------------------------------------
-	// Control parameters
 	//----------------------------------------------------------------------------
-	// These are updated by ??? and will be sent to the MCM over CAN
+	// Cold state - only changed by the parameter table (CAN) or at boot
 	//----------------------------------------------------------------------------
-	//struct _commands {
-	ubyte4 timeStamp_lastCommandSent;  //from IO_RTC_StartTime(&)
-	ubyte2 updateCount; //Number of updates since lastCommandSent
-
-	sbyte2 commands_torque;
-	sbyte2 commands_torqueLimit;
-	ubyte1 commands_direction;
-	//unused/unused/unused/unused unused/unused/Discharge/Inverter Enable
-	Status commands_discharge;
-	Status commands_inverter;
-	//ubyte1 controlSwitches; // example: 0b00000001 = inverter is enabled, discharge is disabled
-    
-    /*
-    //----------------------------------------------------------------------------
-    // Control functions - for functions nested within struct
-    //----------------------------------------------------------------------------
-    void(*setTorque)(MotorController* me, ubyte2 torque); //Will be divided by 10 e.g. pass in 100 for 10.0 Nm
-    void(*setDirection)(MotorController* me, Direction rotation);
-    void(*setInverter)(MotorController* me, Status inverterState);
-    void(*setDischarge)(MotorController* me, Status dischargeState);
-    void(*setTorqueLimit)(MotorController* me, ubyte2 torqueLimit);
-    //        void(*motorController_setTorque)(MotorController* me, ubyte2 torque); //Will be divided by 10 e.g. pass in 100 for 10.0 Nm
-    //        void(*motorController_setDirection)(MotorController* me, Direction rotation);
-    //        void(*motorController_setInverter)(MotorController* me, Status inverterState);
-    //        void(*motorController_setDischarge)(MotorController* me, Status dischargeState);
-    //        void(*motorController_setTorqueLimit)(MotorController* me, ubyte2 torqueLimit);
-    void(*updateLockoutStatus)(MotorController* me, Status newState);
-    void(*updateInverterStatus)(MotorController* me, Status newState);
-    void(*getLockoutStatus)(MotorController* me);
-    void(*getInverterStatus)(MotorController* me);
-    }
-    */
-    //_commands commands;
-    //};
+    //Regen settings for knob position 4 (user customizable) - tuned over CAN, see MCM_registerParameters
+    float4 regenCustom_percentBPSForMaxRegen;
+    float4 regenCustom_percentAPPSForCoasting;
+    ubyte2 regenCustom_torqueLimitDNm;
+    ubyte2 regenCustom_torqueAtZeroPedalDNm;
 };
 
-MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID, Direction initialDirection, sbyte2 torqueMaxInDNm, sbyte1 minRegenSpeedKPH, sbyte1 regenRampdownStartSpeed)
+//The cold block must stay out of the part of the struct the control path walks
+#define MCM_HOT_STATE_BYTES offsetof(struct _MotorController, regenCustom_percentBPSForMaxRegen)
+COMPILE_TIME_ASSERT(MCM_HOT_STATE_BYTES <= MCM_HOT_STATE_BUDGET, mcmHotStateBudget);
+
+const ubyte2 MCM_stateBytes = sizeof(struct _MotorController);
+const ubyte2 MCM_hotStateBytes = MCM_HOT_STATE_BYTES;
+
+MotorController* MotorController_new(SerialManager* sm, const MCMConfig* config)
 {
-	MotorController* me = (MotorController*)malloc(sizeof(struct _MotorController));
+	MotorController* me = (MotorController*)MemoryArena_alloc(sizeof(struct _MotorController));
     me->serialMan = sm;
+    me->config = config;
 
-	me->canMessageBaseId = canMessageBaseID;
 	//Dummy timestamp for last MCU message
 	MCM_commands_resetUpdateCountAndTime(me);
+    me->timeStamp_HVILLost = CYCLECLOCK_NEVER;
+    me->timeStamp_HVILOverrideCommandReceived = CYCLECLOCK_NEVER;
+    me->timeStamp_torqueSampled = CYCLECLOCK_NEVER;
 
 	me->lockoutStatus = UNKNOWN;
 	me->inverterStatus = UNKNOWN;
@@ -144,18 +112,21 @@ MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID,
     me->DC_Voltage = 0;
     me->DC_Current = 0;
 
-	me->commands_direction = initialDirection;
-	me->commands_torqueLimit = me->torqueMaximumDNm = torqueMaxInDNm;
+	me->commands_torqueSent = me->commands_torque = 0;
+	me->commands_direction = config->initialDirection;
+	me->commands_torqueLimit = me->torqueMaximumDNm = config->torqueMaximumDNm;
 
 	me->regen_mode = 0xFF;
 	me->regen_torqueLimitDNm = 0;
 	me->regen_torqueAtZeroPedalDNm = 0;
     me->regen_percentBPSForMaxRegen = 1; //zero to one.. 1 = 100%
 	me->regen_percentAPPSForCoasting = 0;
-    me->regen_minimumSpeedKPH = minRegenSpeedKPH;  //Assigned by main
-    me->regen_SpeedRampStart = regenRampdownStartSpeed;  //Assigned by main
 
-    //me->faultHistory = { 0,0,0,0,0,0,0,0 };  //Todo: read from eeprom instead of defaulting to 0
+    //Position 4 defaults to no regen until tuned
+    me->regenCustom_torqueLimitDNm = 0;
+    me->regenCustom_torqueAtZeroPedalDNm = 0;
+    me->regenCustom_percentBPSForMaxRegen = 0;
+    me->regenCustom_percentAPPSForCoasting = 0;
 
 	me->startupStage = 0; //Off
     
@@ -190,7 +161,7 @@ me->getInverterStatus = &getInverterStatus;
 // 4    3DA  986
 // .    3DA  986
 
-void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSwitchDown, Sensor* TCSPot)
+void MCM_readTCSSettings(MotorController* me, const Sensor* TCSSwitchUp, const Sensor* TCSSwitchDown, const Sensor* TCSPot)
 {	
 	 
 
@@ -231,14 +202,14 @@ void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSw
 	else if (TCSPot->sensorValue >= 0x383)  //Position 4 = User customizable
 	{
 		me->regen_mode = 4;
-		me->regen_torqueLimitDNm = 0;
-		me->regen_torqueAtZeroPedalDNm = 0;
-		me->regen_percentBPSForMaxRegen = 0; //zero to one.. 1 = 100%
-		me->regen_percentAPPSForCoasting = 0;
+		me->regen_torqueLimitDNm = me->regenCustom_torqueLimitDNm;
+		me->regen_torqueAtZeroPedalDNm = me->regenCustom_torqueAtZeroPedalDNm;
+		me->regen_percentBPSForMaxRegen = me->regenCustom_percentBPSForMaxRegen; //zero to one.. 1 = 100%
+		me->regen_percentAPPSForCoasting = me->regenCustom_percentAPPSForCoasting;
 	}
 	else  //This should never happen
 	{
-		me->regen_mode = 0xFFFF;  //Default: Regen off
+		me->regen_mode = 0xFF;    //Default: Regen off
 		me->regen_torqueLimitDNm = 0;
 		me->regen_torqueAtZeroPedalDNm = 0;
 		me->regen_percentBPSForMaxRegen = 0; //zero to one.. 1 = 100%
@@ -246,6 +217,19 @@ void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSw
 	}
 }
 
+//Tunable over CAN (see parameterTable.h).  The torque maximum can only be lowered
+//from MCMConfig's value, and is not persisted, so a power cycle always returns
+//to the compiled-in limit.
+void MCM_registerParameters(MotorController* me, ParameterTable* params)
+{
+    ParameterTable_add(params, ParamID_MCM_torqueMaximumDNm, &me->torqueMaximumDNm, PARAM_UBYTE2, 0, me->config->torqueMaximumDNm, PARAM_NOT_PERSISTED);
+
+    ParameterTable_add(params, ParamID_MCM_regenCustom_torqueLimitDNm, &me->regenCustom_torqueLimitDNm, PARAM_UBYTE2, 0, me->torqueMaximumDNm, EEPROMSlot_regenCustom_torqueLimitDNm);
+    ParameterTable_add(params, ParamID_MCM_regenCustom_torqueAtZeroPedalDNm, &me->regenCustom_torqueAtZeroPedalDNm, PARAM_UBYTE2, 0, me->torqueMaximumDNm, EEPROMSlot_regenCustom_torqueAtZeroPedalDNm);
+    ParameterTable_add(params, ParamID_MCM_regenCustom_percentBPSForMaxRegen, &me->regenCustom_percentBPSForMaxRegen, PARAM_FLOAT4, 0, 1, EEPROMSlot_regenCustom_percentBPSForMaxRegen);
+    ParameterTable_add(params, ParamID_MCM_regenCustom_percentAPPSForCoasting, &me->regenCustom_percentAPPSForCoasting, PARAM_FLOAT4, 0, 1, EEPROMSlot_regenCustom_percentAPPSForCoasting);
+}
+
 /*****************************************************************************
 * Motor Control Functions
 * Reads sensor objects and sets MCM control object values, which will be picked up
@@ -267,8 +251,11 @@ void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSw
 * > Enable inverter
 * > Play RTDS
 ****************************************************************************/
-void MCM_calculateCommands(MotorController* me, TorqueEncoder* tps, BrakePressureSensor* bps)
+void MCM_calculateCommands(MotorController* me, const VehicleState* state)
 {
+    const TorqueEncoder* tps = &state->tps;
+    const BrakePressureSensor* bps = &state->bps;
+
 	//----------------------------------------------------------------------------
 	// Control commands
     //Note: Safety checks (torque command limiting) are done EXTERNALLY.  This is a preliminary calculation
@@ -288,20 +275,21 @@ void MCM_calculateCommands(MotorController* me, TorqueEncoder* tps, BrakePressur
 	torqueOutput = appsTorque + bpsTorque;
     //torqueOutput = me->torqueMaximumDNm * tps->percent;  //REMOVE THIS LINE TO ENABLE REGEN
     MCM_commands_setTorqueDNm(me, torqueOutput);
+    me->timeStamp_torqueSampled = tps->timestamp_sampled;
 
-    me->HVILOverride = (IO_RTC_GetTimeUS(me->timeStamp_HVILOverrideCommandReceived) < 1000000);
+    me->HVILOverride = (CycleClock_since(me->timeStamp_HVILOverrideCommandReceived) < 1000000);
 }
 
-void MCM_relayControl(MotorController* me, Sensor* HVILTermSense)
+void MCM_relayControl(MotorController* me, const VehicleState* state)
 {    
     //If HVIL Term Sense is low (HV is down)
-    if (HVILTermSense->sensorValue == FALSE && me->HVILOverride == FALSE)
+    if (state->hvilTermSense.sensorValue == FALSE && me->HVILOverride == FALSE)
     {
         //If we just noticed the HVIL went low
         if (me->previousHVILState == TRUE)
         {
             SerialManager_send(me->serialMan, "Term sense went low\n");
-            IO_RTC_StartTime(&me->timeStamp_HVILLost);
+            me->timeStamp_HVILLost = CycleClock_now();
         }
 
         //If the MCM is on (and we lost HV)
@@ -309,7 +297,7 @@ void MCM_relayControl(MotorController* me, Sensor* HVILTermSense)
         {
             //Okay to turn MCM off once 0 torque is commanded, or after 2 sec
             //TODO: SIMILAR CODE SHOULD BE EMPLOYED AT HVIL SHUTDOWN CONTROL PIN
-            if (me->commandedTorque == 0 || IO_RTC_GetTimeUS(me->timeStamp_HVILLost) > 2000000)  //EXTRA 0
+            if (me->commandedTorque == 0 || CycleClock_since(me->timeStamp_HVILLost) > 2000000)  //EXTRA 0
             {
                 IO_DO_Set(IO_DO_00, FALSE);  //Need MCM relay object
                 me->relayState = FALSE;
@@ -343,10 +331,12 @@ void MCM_relayControl(MotorController* me, Sensor* HVILTermSense)
 }
 
 //See diagram at https://onedrive.live.com/redir?resid=F9BB8F0F8FDB5CF8!30410&authkey=!ABSF-uVH-VxQRAs&ithint=file%2chtml
-void MCM_inverterControl(MotorController* me, TorqueEncoder* tps, BrakePressureSensor* bps, ReadyToDriveSound* rtds)
+void MCM_inverterControl(MotorController* me, const VehicleState* state, ReadyToDriveSound* rtds)
 {
+    const TorqueEncoder* tps = &state->tps;
+    const BrakePressureSensor* bps = &state->bps;
     float4 RTDPercent;
-    RTDPercent = (Sensor_RTDButton.sensorValue == TRUE ? 1 : 0);
+    RTDPercent = (state->rtdButton.sensorValue == TRUE ? 1 : 0);
     
 	//----------------------------------------------------------------------------
 	// Determine inverter state
@@ -376,7 +366,7 @@ void MCM_inverterControl(MotorController* me, TorqueEncoder* tps, BrakePressureS
         //Nothing: wait for RTD button
 
         //How to transition to next state ------------------------------------------------
-        if (Sensor_RTDButton.sensorValue == TRUE 
+        if (state->rtdButton.sensorValue == TRUE 
             && tps->calibrated == TRUE
             && bps->calibrated == TRUE
             && tps->percent < .1
@@ -561,7 +551,7 @@ void MCM_parseCanMessage(MotorController* me, IO_CAN_DATA_FRAME* mcmCanMessage)
         //0,1 Commanded Torque
         if (mcmCanMessage->data[1] > 0)
         {
-            IO_RTC_StartTime(&me->timeStamp_HVILOverrideCommandReceived);
+            me->timeStamp_HVILOverrideCommandReceived = CycleClock_now();
         }
         //2,3 Torque Feedback
         break;
@@ -576,9 +566,9 @@ void MCM_parseCanMessage(MotorController* me, IO_CAN_DATA_FRAME* mcmCanMessage)
 *
 ****************************************************************************/
 //Will be divided by 10 e.g. pass in 100 for 10.0 Nm
+//Not counted in updateCount - torque is compared with the last sent value instead (see MCM_commands_isSendDue)
 void MCM_commands_setTorqueDNm(MotorController* me, sbyte2 newTorque)
 {
-	me->updateCount += (me->commands_torque == newTorque) ? 0 : 1;
 	me->commands_torque = newTorque;
 }
 
@@ -628,6 +618,10 @@ Direction MCM_commands_getDirection(MotorController* me)
 {
 	return me->commands_direction;
 }
+ubyte8 MCM_commands_getTorqueSampleTime(MotorController* me)
+{
+	return me->timeStamp_torqueSampled;
+}
 Status MCM_commands_getInverter(MotorController* me)
 {
 	return me->commands_inverter;
@@ -684,12 +678,38 @@ ubyte2 MCM_commands_getUpdateCount(MotorController* me)
 void MCM_commands_resetUpdateCountAndTime(MotorController* me)
 {
 	me->updateCount = 0;
-	IO_RTC_StartTime(&(me->timeStamp_lastCommandSent));
+	me->commands_torqueSent = me->commands_torque;
+	me->timeStamp_lastCommandSent = CycleClock_now();
+}
+
+/*****************************************************************************
+* Command send policy
+******************************************************************************
+* 0xC0 goes out when something the inverter needs to act on has changed -
+* enable, direction, discharge or torque limit, or torque by more than
+* MCM_COMMAND_TORQUE_DEADBAND_DNM since the last one sent.  main asks once
+* per cycle, so that is also the fastest it can go; a change to enable or
+* the torque limit is never held back a cycle.  With nothing changing it is
+* repeated every MCM_COMMAND_MAX_INTERVAL_US so the inverter's command
+* timeout never trips.  Pedal noise alone therefore costs no bus load.
+****************************************************************************/
+bool MCM_commands_isSendDue(MotorController* me)
+{
+	ubyte4 sinceSent_us = CycleClock_since(me->timeStamp_lastCommandSent);
+	sbyte4 torqueChange = (sbyte4)me->commands_torque - me->commands_torqueSent;
+
+	if (sinceSent_us >= MCM_COMMAND_MAX_INTERVAL_US) { return TRUE; }
+
+	return me->updateCount > 0
+	    || torqueChange > MCM_COMMAND_TORQUE_DEADBAND_DNM
+	    || torqueChange < -MCM_COMMAND_TORQUE_DEADBAND_DNM
+	    //Always let the command settle exactly on zero torque
+	    || (me->commands_torque == 0 && me->commands_torqueSent != 0);
 }
 
 ubyte4 MCM_commands_getTimeSinceLastCommandSent(MotorController* me)
 {
-	return IO_RTC_GetTimeUS(me->timeStamp_lastCommandSent);
+	return CycleClock_since(me->timeStamp_lastCommandSent);
 }
 
 
@@ -720,6 +740,21 @@ sbyte2 MCM_getMotorTemp(MotorController* me)
     return me->motor_temp;
 }
 
+sbyte2 MCM_getMotorRPM(MotorController* me)
+{
+    return me->motorRPM;
+}
+
+sbyte4 MCM_getDCVoltage(MotorController* me)
+{
+    return me->DC_Voltage;
+}
+
+sbyte4 MCM_getDCCurrent(MotorController* me)
+{
+    return me->DC_Current;
+}
+
 sbyte2 MCM_getGroundSpeedKPH(MotorController* me)
 {
     sbyte2 wheelRPM = me->motorRPM / 3;
@@ -751,11 +786,11 @@ sbyte2 MCM_getRegenAPPSForMaxCoastingZeroToFF(MotorController* me)
 
 sbyte1 MCM_getRegenMinSpeed(MotorController* me)
 {
-    return me->regen_minimumSpeedKPH;
+    return me->config->regen_minimumSpeedKPH;
 }
 sbyte1 MCM_getRegenRampdownStartSpeed(MotorController* me)
 {
-    return me->regen_SpeedRampStart;
+    return me->config->regen_SpeedRampStart;
 }
 
 
@@ -7,8 +7,10 @@
 #include "torqueEncoder.h"
 #include "brakePressureSensor.h"
 #include "readyToDriveSound.h"
+#include "vehicleState.h"
 //#include "safety.h"
 #include "serial.h"
+#include "parameterTable.h"
 
 //typedef enum { TORQUE, DIRECTION, INVERTER, DISCHARGE, TORQUELIMIT} MCMCommand;
 typedef enum { ENABLED, DISABLED, UNKNOWN } Status;
@@ -20,7 +22,25 @@ typedef enum { CLOCKWISE, COUNTERCLOCKWISE, FORWARD, REVERSE, _0, _1 } Direction
 
 typedef struct _MotorController MotorController;
 
-MotorController* MotorController_new(SerialManager* sm, ubyte2 canMessageBaseID, Direction initialDirection, sbyte2 torqueMaxInDNm, sbyte1 minRegenSpeedKPH, sbyte1 regenRampdownStartSpeed);
+//Settings that never change at run time.  Declare the instance const so it
+//stays in flash - the MCM object only keeps a pointer to it.
+typedef struct _MCMConfig
+{
+    ubyte2 canMessageBaseId;        //Starting message ID for messages that will come in from this controller
+    sbyte2 torqueMaximumDNm;        //Boot value, and upper limit when tuned over CAN (100 = 10.0 Nm)
+    Direction initialDirection;
+    sbyte1 regen_minimumSpeedKPH;
+    sbyte1 regen_SpeedRampStart;
+} MCMConfig;
+
+//Bytes at the front of the MCM object touched every cycle (build fails if exceeded)
+#define MCM_HOT_STATE_BUDGET 120
+
+//sizeof the whole MCM object and of its hot part, for the boot report
+extern const ubyte2 MCM_stateBytes;
+extern const ubyte2 MCM_hotStateBytes;
+
+MotorController* MotorController_new(SerialManager* sm, const MCMConfig* config);
 
 //----------------------------------------------------------------------------
 // Command Functions
@@ -38,11 +58,22 @@ void MCM_commands_setTorqueLimit(MotorController* me, sbyte2 torqueLimit);
 sbyte2 MCM_commands_getTorque(MotorController* me); //Will be divided by 10 e.g. pass in 100 for 10.0 Nm
 Direction MCM_commands_getDirection(MotorController* me);
 Status MCM_commands_getInverter(MotorController* me);
+//CycleClock_read() time of the pedal sample the torque command was calculated from.
+//SafetyChecker_reduceTorque only scales the command, so it keeps the same sample time.
+ubyte8 MCM_commands_getTorqueSampleTime(MotorController* me);
 Status MCM_commands_getDischarge(MotorController* me);
 sbyte2 MCM_commands_getTorqueLimit(MotorController* me); 
 
 ubyte2 MCM_commands_getUpdateCount(MotorController* me);
-void MCM_commands_resetUpdateCountAndTime(MotorController* me);
+void MCM_commands_resetUpdateCountAndTime(MotorController* me);  //Call when 0xC0 has been sent
+
+//0xC0 send policy (see MCM_commands_isSendDue)
+#define MCM_COMMAND_TORQUE_DEADBAND_DNM 20   //Smaller torque changes wait for the max interval (20 = 2.0 Nm)
+//Same keep-alive the old CanManager_send used (maxTimeExceeded 50000 - every 2nd 33 ms
+//cycle, ~66 ms).  Must stay well inside the RMS command message timeout set in the
+//inverter's EEPROM; check that parameter before raising it.
+#define MCM_COMMAND_MAX_INTERVAL_US 50000
+bool MCM_commands_isSendDue(MotorController* me);
 ubyte4 MCM_commands_getTimeSinceLastCommandSent(MotorController* me);
 
 //----------------------------------------------------------------------------
@@ -73,6 +104,9 @@ bool MCM_getRTDSFlag(MotorController* me);
 
 sbyte2 MCM_getTemp(MotorController* me);
 sbyte2 MCM_getMotorTemp(MotorController* me);
+sbyte2 MCM_getMotorRPM(MotorController* me);
+sbyte4 MCM_getDCVoltage(MotorController* me);  //Volts
+sbyte4 MCM_getDCCurrent(MotorController* me);  //Amps
 
 sbyte2 MCM_getGroundSpeedKPH(MotorController* me);
 sbyte1 MCM_getRegenMinSpeed(MotorController* me);
@@ -87,11 +121,12 @@ sbyte2 MCM_getRegenAPPSForMaxCoastingZeroToFF(MotorController* me);
 //----------------------------------------------------------------------------
 //Inter-object functions
 //----------------------------------------------------------------------------
-void MCM_readTCSSettings(MotorController* me, Sensor* TCSSwitchUp, Sensor* TCSSwitchDown, Sensor* TCSPot);
-void MCM_calculateCommands(MotorController* mcm, TorqueEncoder* tps, BrakePressureSensor* bps);
+void MCM_readTCSSettings(MotorController* me, const Sensor* TCSSwitchUp, const Sensor* TCSSwitchDown, const Sensor* TCSPot);
+void MCM_registerParameters(MotorController* me, ParameterTable* params);
+void MCM_calculateCommands(MotorController* mcm, const VehicleState* state);
 
-void MCM_relayControl(MotorController* mcm, Sensor* HVILTermSense);
-void MCM_inverterControl(MotorController* mcm, TorqueEncoder* tps, BrakePressureSensor* bps, ReadyToDriveSound* rtds);
+void MCM_relayControl(MotorController* mcm, const VehicleState* state);
+void MCM_inverterControl(MotorController* mcm, const VehicleState* state, ReadyToDriveSound* rtds);
 
 void MCM_parseCanMessage(MotorController* mcm, IO_CAN_DATA_FRAME* mcmCanMessage);
 
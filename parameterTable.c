@@ -0,0 +1,202 @@
+#include <string.h>  //memcpy
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "parameterTable.h"
+#include "memoryArena.h"
+#include "eepromManager.h"
+#include "debugServices.h"
+
+typedef struct _Parameter
+{
+    ParameterID id;
+    void* address;
+    ParameterType type;
+    float4 min;
+    float4 max;
+    EEPROMSlot persistSlot;  //PARAM_NOT_PERSISTED = not saved
+} Parameter;
+
+typedef enum
+{
+      PARAM_OK = 0
+    , PARAM_UNKNOWN_ID = 1
+    , PARAM_OUT_OF_RANGE = 2
+} ParameterStatus;
+
+struct _ParameterTable
+{
+    EEPROMManager* eep;
+
+    Parameter parameters[PARAMETER_MAX];
+    ubyte1 count;
+};
+
+ParameterTable* ParameterTable_new(EEPROMManager* eep)
+{
+    ParameterTable* me = (ParameterTable*)MemoryArena_alloc(sizeof(struct _ParameterTable));
+
+    me->eep = eep;
+    me->count = 0;
+
+    return me;
+}
+
+/*****************************************************************************
+* Raw value conversion
+******************************************************************************
+* On CAN and in EEPROM every value is 4 bytes: integers sign/zero extended,
+* floats as their IEEE bit pattern.
+****************************************************************************/
+static ubyte4 Parameter_getRaw(const Parameter* param)
+{
+    ubyte4 raw = 0;
+    switch (param->type)
+    {
+    case PARAM_UBYTE1: raw = *(ubyte1*)param->address; break;
+    case PARAM_SBYTE1: raw = (sbyte4)*(sbyte1*)param->address; break;
+    case PARAM_UBYTE2: raw = *(ubyte2*)param->address; break;
+    case PARAM_SBYTE2: raw = (sbyte4)*(sbyte2*)param->address; break;
+    case PARAM_UBYTE4: raw = *(ubyte4*)param->address; break;
+    case PARAM_SBYTE4: raw = *(sbyte4*)param->address; break;
+    case PARAM_FLOAT4: memcpy(&raw, param->address, 4); break;
+    }
+    return raw;
+}
+
+static float4 Parameter_rawToFloat(const Parameter* param, ubyte4 raw)
+{
+    float4 value;
+    switch (param->type)
+    {
+    case PARAM_UBYTE1:
+    case PARAM_UBYTE2:
+    case PARAM_UBYTE4: value = raw; break;
+    case PARAM_FLOAT4: memcpy(&value, &raw, 4); break;
+    default:           value = (sbyte4)raw; break;
+    }
+    return value;
+}
+
+//Range is checked on the full 4-byte value, so an oversized write can't wrap into range
+static ParameterStatus Parameter_setRaw(Parameter* param, ubyte4 raw)
+{
+    float4 value = Parameter_rawToFloat(param, raw);
+    if (!(value >= param->min && value <= param->max))  //Also rejects NaN
+    {
+        return PARAM_OUT_OF_RANGE;
+    }
+
+    switch (param->type)
+    {
+    case PARAM_UBYTE1: *(ubyte1*)param->address = raw; break;
+    case PARAM_SBYTE1: *(sbyte1*)param->address = raw; break;
+    case PARAM_UBYTE2: *(ubyte2*)param->address = raw; break;
+    case PARAM_SBYTE2: *(sbyte2*)param->address = raw; break;
+    case PARAM_UBYTE4: *(ubyte4*)param->address = raw; break;
+    case PARAM_SBYTE4: *(sbyte4*)param->address = raw; break;
+    case PARAM_FLOAT4: memcpy(param->address, &raw, 4); break;
+    }
+    return PARAM_OK;
+}
+
+void ParameterTable_add(ParameterTable* me, ParameterID id, void* address, ParameterType type
+                      , float4 min, float4 max, EEPROMSlot persistSlot)
+{
+    Parameter* param;
+    ubyte4 stored;
+
+    if (me->count >= PARAMETER_MAX) { return; }
+
+    param = &me->parameters[me->count++];
+    param->id = id;
+    param->address = address;
+    param->type = type;
+    param->min = min;
+    param->max = max;
+    param->persistSlot = persistSlot;
+
+    //Out-of-range stored values are ignored (the default stays)
+    if (persistSlot != PARAM_NOT_PERSISTED && EEPROMManager_get(me->eep, persistSlot, &stored))
+    {
+        Parameter_setRaw(param, stored);
+    }
+}
+
+static Parameter* ParameterTable_find(ParameterTable* me, ubyte2 id)
+{
+    for (ubyte1 i = 0; i < me->count; i++)
+    {
+        if (me->parameters[i].id == id) { return &me->parameters[i]; }
+    }
+    return NULL;
+}
+
+/*****************************************************************************
+* CAN protocol (0x5FF request -> 0x5FE response, little endian)
+******************************************************************************
+* Read   request  D2 idLo idHi
+* Write  request  D3 idLo idHi v0 v1 v2 v3
+*        response D2/D3 idLo idHi status|type<<4 v0 v1 v2 v3  (value after the write)
+* Info   request  D4 index
+*        response D4 index idLo idHi status|type<<4 persisted count 00
+*        (walk index 0..count-1 to list every parameter)
+* status: 0 = OK, 1 = unknown ID/index, 2 = out of range (not written)
+****************************************************************************/
+void ParameterTable_handleRequest(ParameterTable* me, const IO_CAN_DATA_FRAME* request, ubyte1 response[8])
+{
+    Parameter* param = NULL;
+    ParameterStatus status = PARAM_OK;
+    ubyte4 raw = 0;
+
+    response[0] = request->data[0];
+
+    if (request->data[0] == DebugService_ParameterInfo)
+    {
+        response[1] = request->data[1];
+        if (request->data[1] < me->count)
+        {
+            param = &me->parameters[request->data[1]];
+            response[2] = param->id;
+            response[3] = param->id >> 8;
+            response[4] = PARAM_OK | (param->type << 4);
+            response[5] = (param->persistSlot != PARAM_NOT_PERSISTED);
+        }
+        else
+        {
+            response[4] = PARAM_UNKNOWN_ID;
+        }
+        response[6] = me->count;
+        return;
+    }
+
+    response[1] = request->data[1];
+    response[2] = request->data[2];
+    param = ParameterTable_find(me, (ubyte2)request->data[2] << 8 | request->data[1]);
+    if (param == NULL)
+    {
+        response[3] = PARAM_UNKNOWN_ID;
+        return;
+    }
+
+    if (request->data[0] == DebugService_ParameterWrite)
+    {
+        raw = (ubyte4)request->data[3]
+            | (ubyte4)request->data[4] << 8
+            | (ubyte4)request->data[5] << 16
+            | (ubyte4)request->data[6] << 24;
+        status = Parameter_setRaw(param, raw);
+        if (status == PARAM_OK && param->persistSlot != PARAM_NOT_PERSISTED)
+        {
+            EEPROMManager_set(me->eep, param->persistSlot, raw);
+        }
+    }
+
+    raw = Parameter_getRaw(param);
+    response[3] = status | (param->type << 4);
+    response[4] = raw;
+    response[5] = raw >> 8;
+    response[6] = raw >> 16;
+    response[7] = raw >> 24;
+}
@@ -0,0 +1,59 @@
+#ifndef _PARAMETERTABLE_H
+#define _PARAMETERTABLE_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "eepromManager.h"
+
+/*****************************************************************************
+* Runtime parameter table
+******************************************************************************
+* Tunable values stay as ordinary fields in their owning objects - the table
+* only records where each one lives, so the control code reads them exactly
+* as before (no per-cycle cost).  A write over CAN changes the field
+* directly; the owning object sees the new value on its next update.
+*
+* Each object registers its own fields in X_registerParameters(), which also
+* loads any persisted value from EEPROM.  The value in the field at
+* registration time is the default.
+*
+* IDs are part of the CAN protocol: never renumber, only add.
+****************************************************************************/
+#define PARAMETER_MAX 32
+
+typedef enum
+{
+    //Motor controller 0x01xx
+      ParamID_MCM_torqueMaximumDNm              = 0x0100
+    , ParamID_MCM_regenCustom_torqueLimitDNm    = 0x0110  //Regen knob position 4
+    , ParamID_MCM_regenCustom_torqueAtZeroPedalDNm
+    , ParamID_MCM_regenCustom_percentBPSForMaxRegen
+    , ParamID_MCM_regenCustom_percentAPPSForCoasting
+
+    //Cooling 0x02xx
+    , ParamID_Cooling_waterPumpLow              = 0x0200
+    , ParamID_Cooling_waterPumpHigh
+    , ParamID_Cooling_motorFanLow
+    , ParamID_Cooling_motorFanHigh
+    , ParamID_Cooling_batteryFanLow
+    , ParamID_Cooling_batteryFanHigh
+} ParameterID;
+
+typedef enum { PARAM_UBYTE1, PARAM_SBYTE1, PARAM_UBYTE2, PARAM_SBYTE2, PARAM_UBYTE4, PARAM_SBYTE4, PARAM_FLOAT4 } ParameterType;
+
+//Pass as the slot for values that should reset to their default at power-up
+#define PARAM_NOT_PERSISTED EEPROMSlot_Count
+
+typedef struct _ParameterTable ParameterTable;
+
+ParameterTable* ParameterTable_new(EEPROMManager* eep);
+
+//Registers a field.  If persistSlot holds a valid, in-range value it is loaded into the field now.
+void ParameterTable_add(ParameterTable* me, ParameterID id, void* address, ParameterType type
+                      , float4 min, float4 max, EEPROMSlot persistSlot);
+
+//Handles a parameter service request from 0x5FF and fills in its 0x5FE response (8 data bytes, zeroed by the caller)
+void ParameterTable_handleRequest(ParameterTable* me, const IO_CAN_DATA_FRAME* request, ubyte1 response[8]);
+
+#endif // _PARAMETERTABLE_H
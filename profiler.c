@@ -0,0 +1,232 @@
+#include <stdio.h>  //sprintf
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+#include "IO_RTC.h"
+
+#include "profiler.h"
+#include "memoryArena.h"
+#include "serial.h"
+#include "cycleClock.h"
+
+//Worst acceptable time for each section in us (main loop period is 33 ms)
+static const ubyte4 budget_us[ProfileSection_Count] =
+{
+      20000 //Cycle
+};
+
+static const char* const sectionNames[ProfileSection_Count] =
+{
+      "main loop cycle"
+};
+
+typedef struct _ProfileStats
+{
+    ubyte4 timestamp_start;
+    ubyte4 total_us;        //Since the last reset
+    ubyte2 max_us;
+    ubyte2 count;
+    ubyte2 overruns;
+    bool overrunReported;
+} ProfileStats;
+
+//Profiler_handleRequest section number for the latency histogram
+#define PROFILER_LATENCY 0xFE
+
+typedef struct _LatencyHistogram
+{
+    ubyte2 buckets[LATENCY_BUCKETS];
+    ubyte2 count;
+    ubyte2 max_us;
+} LatencyHistogram;
+
+struct _Profiler
+{
+    SerialManager* sm;
+    ProfileStats sections[ProfileSection_Count];
+    LatencyHistogram latency;
+};
+
+static void ProfileStats_reset(ProfileStats* stats)
+{
+    stats->total_us = 0;
+    stats->max_us = 0;
+    stats->count = 0;
+    stats->overruns = 0;
+}
+
+static void LatencyHistogram_reset(LatencyHistogram* histogram)
+{
+    for (ubyte2 bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+    {
+        histogram->buckets[bucket] = 0;
+    }
+    histogram->count = 0;
+    histogram->max_us = 0;
+}
+
+Profiler* Profiler_new(SerialManager* sm)
+{
+    Profiler* me = (Profiler*)MemoryArena_alloc(sizeof(struct _Profiler));
+
+    me->sm = sm;
+    for (ubyte1 section = 0; section < ProfileSection_Count; section++)
+    {
+        ProfileStats_reset(&me->sections[section]);
+        me->sections[section].timestamp_start = 0;
+        me->sections[section].overrunReported = FALSE;
+    }
+    LatencyHistogram_reset(&me->latency);
+
+    return me;
+}
+
+void Profiler_start(Profiler* me, ProfileSection section)
+{
+    IO_RTC_StartTime(&me->sections[section].timestamp_start);
+}
+
+void Profiler_stop(Profiler* me, ProfileSection section)
+{
+    ProfileStats* stats = &me->sections[section];
+    ubyte4 elapsed_us = IO_RTC_GetTimeUS(stats->timestamp_start);
+
+    //Counters stop rather than wrap, so a long run without a reset still reads sensibly
+    if (stats->count < 0xFFFF)
+    {
+        stats->total_us += elapsed_us;
+        stats->count++;
+    }
+    if (elapsed_us > stats->max_us) { stats->max_us = (elapsed_us > 0xFFFF) ? 0xFFFF : elapsed_us; }
+
+    if (elapsed_us > budget_us[section])
+    {
+        if (stats->overruns < 0xFFFF) { stats->overruns++; }
+        if (stats->overrunReported == FALSE)
+        {
+            ubyte1 message[80];
+            sprintf(message, "%s over budget: %lu us > %lu us\n", sectionNames[section], (unsigned long)elapsed_us, (unsigned long)budget_us[section]);
+            SerialManager_send(me->sm, message);
+            stats->overrunReported = TRUE;
+        }
+    }
+}
+
+/*****************************************************************************
+* Pedal-to-inverter latency
+******************************************************************************
+* One sample per cycle.  Recording is a bucket increment; the percentiles are
+* only worked out when someone asks for them.  The histogram is cleared after
+* each 0x5F2 frame, so it holds about 30 samples and never gets near the
+* 0xFFFF stop.
+****************************************************************************/
+void Profiler_recordLatency(Profiler* me, ubyte8 timestamp_sampled)
+{
+    LatencyHistogram* histogram = &me->latency;
+    ubyte8 latency_us;
+    ubyte4 bucket;
+
+    //No pedal sample yet, or the histogram is full (stops rather than wraps, like the sections)
+    if (timestamp_sampled == CYCLECLOCK_NEVER || histogram->count == 0xFFFF) { return; }
+
+    latency_us = CycleClock_read() - timestamp_sampled;
+    if (latency_us > 0xFFFF) { latency_us = 0xFFFF; }
+
+    bucket = (ubyte4)latency_us / LATENCY_BUCKET_US;
+    if (bucket >= LATENCY_BUCKETS) { bucket = LATENCY_BUCKETS - 1; }
+
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    if (latency_us > histogram->max_us) { histogram->max_us = (ubyte2)latency_us; }
+}
+
+//Upper edge of the bucket holding the sample at this percentile
+static ubyte2 LatencyHistogram_percentile(const LatencyHistogram* histogram, ubyte1 percent)
+{
+    ubyte4 target = ((ubyte4)histogram->count * percent + 99) / 100;
+    ubyte4 seen = 0;
+    ubyte4 edge_us;
+
+    if (histogram->count == 0) { return 0; }
+
+    for (ubyte2 bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+    {
+        seen += histogram->buckets[bucket];
+        if (seen >= target)
+        {
+            edge_us = (ubyte4)(bucket + 1) * LATENCY_BUCKET_US;
+            return (edge_us > histogram->max_us) ? histogram->max_us : edge_us;
+        }
+    }
+    return histogram->max_us;
+}
+
+void Profiler_getLatency(Profiler* me, ubyte2* p50_us, ubyte2* p99_us, ubyte2* max_us, ubyte2* count)
+{
+    *p50_us = LatencyHistogram_percentile(&me->latency, 50);
+    *p99_us = LatencyHistogram_percentile(&me->latency, 99);
+    *max_us = me->latency.max_us;
+    *count = me->latency.count;
+}
+
+void Profiler_resetLatency(Profiler* me)
+{
+    LatencyHistogram_reset(&me->latency);
+}
+
+/*****************************************************************************
+* CAN protocol (0x5FF request -> 0x5FE response, little endian)
+******************************************************************************
+* Read   DA section reset            reset 1 = clear the section's numbers
+*                                    after reading them
+* Answer DA section avgLo avgHi maxLo maxHi overrunsLo overrunsHi
+*        (us since the last reset; section 0xFF = no such section)
+*
+* Section FE is the pedal-to-inverter latency histogram:
+* Answer DA FE p50Lo p50Hi p99Lo p99Hi maxLo maxHi
+* The same numbers (plus the sample count) are sent on CAN once a second -
+* see canOutput_sendLatency - and that send starts a new window, so a read
+* only covers the time since the last 0x5F2 frame.
+****************************************************************************/
+void Profiler_handleRequest(Profiler* me, const IO_CAN_DATA_FRAME* request, ubyte1 response[8])
+{
+    ProfileStats* stats;
+    ubyte4 average_us;
+
+    response[0] = request->data[0];
+
+    if (request->data[1] == PROFILER_LATENCY)
+    {
+        ubyte2 p50_us, p99_us, max_us, count;
+        Profiler_getLatency(me, &p50_us, &p99_us, &max_us, &count);
+        response[1] = PROFILER_LATENCY;
+        response[2] = p50_us;
+        response[3] = p50_us >> 8;
+        response[4] = p99_us;
+        response[5] = p99_us >> 8;
+        response[6] = max_us;
+        response[7] = max_us >> 8;
+        if (request->data[2] == 1) { LatencyHistogram_reset(&me->latency); }
+        return;
+    }
+
+    if (request->data[1] >= ProfileSection_Count)
+    {
+        response[1] = 0xFF;
+        return;
+    }
+    stats = &me->sections[request->data[1]];
+
+    average_us = (stats->count == 0) ? 0 : stats->total_us / stats->count;
+    if (average_us > 0xFFFF) { average_us = 0xFFFF; }
+
+    response[1] = request->data[1];
+    response[2] = average_us;
+    response[3] = average_us >> 8;
+    response[4] = stats->max_us;
+    response[5] = stats->max_us >> 8;
+    response[6] = stats->overruns;
+    response[7] = stats->overruns >> 8;
+
+    if (request->data[2] == 1) { ProfileStats_reset(stats); }
+}
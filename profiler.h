@@ -0,0 +1,57 @@
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "serial.h"
+#include "cycleClock.h"
+
+/*****************************************************************************
+* Hot path profiler
+******************************************************************************
+* Times the main loop cycle on the VCU itself (RTC, 1 us resolution) and
+* checks it against a budget.  The first time a section goes over budget it
+* is reported on serial; after that overruns are only counted.  Averages,
+* maximums and overrun counts can be read (and reset) over the 0x5FF debug
+* channel - see profiler.c.
+*
+* Per-function costs are measured on the host instead, by replay/bench, which
+* has a checked-in baseline and fails on a regression.  Only what depends on
+* the real CPU, bus and IO driver is timed here, so the control loop carries
+* no per-function RTC reads.
+*
+* It also keeps a histogram of the end-to-end pedal-to-inverter latency: from
+* the pedal ADC read in sensors_updateSensors to the 0xC0 command write.
+****************************************************************************/
+#define LATENCY_BUCKET_US 250       //Latency histogram resolution
+#define LATENCY_BUCKETS 160         //The last bucket also holds everything over 40 ms
+
+typedef enum
+{
+      ProfileSection_Cycle              //Whole cycle, task begin to task end
+    , ProfileSection_Count
+} ProfileSection;
+
+typedef struct _Profiler Profiler;
+
+Profiler* Profiler_new(SerialManager* sm);
+
+void Profiler_start(Profiler* me, ProfileSection section);
+void Profiler_stop(Profiler* me, ProfileSection section);
+
+//Adds one pedal-to-inverter latency sample.  Call right after the torque command is
+//written, with the sample time it was calculated from (MCM_commands_getTorqueSampleTime).
+void Profiler_recordLatency(Profiler* me, ubyte8 timestamp_sampled);
+
+//Latency since the last reset: p50/p99 (upper edge of their histogram bucket, never
+//above the max), maximum and sample count
+void Profiler_getLatency(Profiler* me, ubyte2* p50_us, ubyte2* p99_us, ubyte2* max_us, ubyte2* count);
+
+//Starts a new latency window.  canOutput_sendLatency calls it after every 0x5F2 frame.
+void Profiler_resetLatency(Profiler* me);
+
+//Handles a profiler service request from 0x5FF and fills in its 0x5FE response (8 data bytes, zeroed by the caller)
+void Profiler_handleRequest(Profiler* me, const IO_CAN_DATA_FRAME* request, ubyte1 response[8]);
+
+#endif // _PROFILER_H
@@ -0,0 +1,405 @@
+/*****************************************************************************
+* Hot path microbenchmark (host only)
+******************************************************************************
+* Calls the main loop's hot functions directly, millions of times each, on
+* the host build of the firmware and prints the cost per call:
+*
+*   make -C replay bench              run and check against the baseline
+*   make -C replay bench-baseline     run and rewrite the baseline
+*
+* Every iteration is one simulated 33 ms cycle: the virtual clock moves on
+* and CycleClock_update runs, so send intervals and debounces behave as they
+* do on the car.  The cost of that (and of picking the iteration's input) is
+* measured on its own and subtracted.  Each function is timed in several
+* runs and the fastest counts, which keeps host noise out of the numbers.
+*
+* Inputs are synthetic - a pedal sweep, changing telemetry and the Elithion
+* 0x622-0x629 frames - unless -t gives a .trc, whose BMS frames are used.
+*
+* Memory is only ever allocated from the static arena.  Any arena bytes taken
+* while a function is being timed are reported and fail the run, because the
+* car must not allocate once the main loop is running.
+*
+* With -b, each function is compared with its line in the baseline file and
+* the run exits 1 if one is more than the tolerance (plus BENCH_SLACK_NS)
+* slower.  Baselines are host-specific: regenerate them on the machine that
+* runs the check.
+****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "serial.h"
+#include "cycleClock.h"
+#include "memoryArena.h"
+#include "eepromManager.h"
+#include "canManager.h"
+#include "torqueEncoder.h"
+#include "brakePressureSensor.h"
+#include "wheelSpeeds.h"
+#include "vehicleState.h"
+
+#include "trcReader.h"
+#include "replayIO.h"
+
+#define BENCH_CYCLE_US 33000
+#define BENCH_RUNS 5                //Each function is timed this many times; the fastest run counts
+#define BENCH_INPUTS 256            //Inputs are cycled through, so the pattern repeats every 256 calls
+#define BENCH_TOLERANCE_PERCENT 50  //Default allowed slowdown against the baseline
+#define BENCH_SLACK_NS 5            //Also allowed, so the few-ns functions don't fail on timer noise
+#define BENCH_NAME_MAX 40
+#define BENCH_TELEMETRY_FRAMES 4    //0x500-0x503, as canOutput_sendDebugMessage sends them
+
+extern Sensor Sensor_TPS0;
+extern Sensor Sensor_TPS1;
+
+typedef struct _BenchResult
+{
+    const char* name;
+    double ns;                      //Per call, cycle overhead subtracted
+    ubyte4 arenaBytes;              //Allocated while timed
+} BenchResult;
+
+//Objects, as main creates them
+static SerialManager* serialMan;
+static CanManager* canMan;
+static MotorController* mcm0;
+static TorqueEncoder* tps;
+static BrakePressureSensor* bps;
+static WheelSpeeds* wss;
+static SafetyChecker* sc;
+static BatteryManagementSystem* bms;
+static const VehicleState* state;
+
+//Inputs, indexed by iteration % BENCH_INPUTS
+static ubyte4 pedal_mV[BENCH_INPUTS];
+static IO_CAN_DATA_FRAME telemetry[BENCH_INPUTS][BENCH_TELEMETRY_FRAMES];
+static IO_CAN_DATA_FRAME* bmsFrames = NULL;
+static ubyte4 bmsFrameCount = 0;
+
+static ubyte4 iterations = 2000000;
+
+
+/*****************************************************************************
+* Setup
+****************************************************************************/
+static void createObjects(void)
+{
+    static const MCMConfig mcm0Config = { 0xA0, 1000, FORWARD, 5, 15 };
+
+    IO_Driver_Init(NULL);
+    serialMan = SerialManager_new();
+    CycleClock_init();
+    EEPROMManager* eepromMan = EEPROMManager_new(serialMan);
+
+    canMan = CanManager_new(500, 40, 40, 500, 20, 20, 200000, serialMan);
+    mcm0 = MotorController_new(serialMan, &mcm0Config);
+    tps = TorqueEncoder_new(FALSE);
+    bps = BrakePressureSensor_new();
+    TorqueEncoder_loadCalibrationFromEEPROM(tps, eepromMan);
+    BrakePressureSensor_loadCalibrationFromEEPROM(bps, eepromMan);
+    wss = WheelSpeeds_new(18, 18, 16, 16);
+    sc = SafetyChecker_new(serialMan, 320, 32);
+    bms = BMS_new(serialMan, 0x620);
+
+    //A calibrated pedal, so TorqueEncoder_update does the real arithmetic
+    tps->tps0_calibMin = 500;
+    tps->tps0_calibMax = 4500;
+    tps->tps1_calibMin = 500;
+    tps->tps1_calibMax = 4500;
+    tps->calibrated = TRUE;
+
+    CycleClock_update();
+    VehicleState_publish(tps, bps, wss);
+    state = VehicleState_get();
+}
+
+static void createSyntheticInputs(void)
+{
+    for (ubyte4 i = 0; i < BENCH_INPUTS; i++)
+    {
+        //Triangle sweep over the calibrated range
+        ubyte4 phase = i % 128;
+        pedal_mV[i] = 500 + ((phase < 64) ? phase : 127 - phase) * 62;
+
+        for (ubyte1 f = 0; f < BENCH_TELEMETRY_FRAMES; f++)
+        {
+            IO_CAN_DATA_FRAME* frame = &telemetry[i][f];
+            frame->id_format = IO_CAN_STD_FRAME;
+            frame->id = 0x500 + f;
+            frame->length = 8;
+            for (ubyte1 b = 0; b < 8; b++) { frame->data[b] = (ubyte1)(i * (f + 1) + b); }
+        }
+    }
+
+    //One of each Elithion broadcast, with changing values
+    bmsFrameCount = BENCH_INPUTS;
+    bmsFrames = (IO_CAN_DATA_FRAME*)calloc(bmsFrameCount, sizeof(IO_CAN_DATA_FRAME));
+    for (ubyte4 i = 0; i < bmsFrameCount; i++)
+    {
+        bmsFrames[i].id_format = IO_CAN_STD_FRAME;
+        bmsFrames[i].id = 0x622 + (i % 8);
+        bmsFrames[i].length = 8;
+        for (ubyte1 b = 0; b < 8; b++) { bmsFrames[i].data[b] = (ubyte1)(i + b * 17); }
+    }
+}
+
+//Replaces the synthetic BMS frames with the trace's.  FALSE if it has none.
+static bool loadTraceInputs(const char* path)
+{
+    Trace* trace = Trace_load(path);
+    ubyte4 count = 0;
+
+    if (trace == NULL) { return FALSE; }
+    for (ubyte4 i = 0; i < trace->count; i++)
+    {
+        if (trace->frames[i].frame.id >= 0x620 && trace->frames[i].frame.id <= 0x62F) { count++; }
+    }
+    if (count == 0)
+    {
+        fprintf(stderr, "%s has no BMS frames (0x620-0x62F)\n", path);
+        Trace_free(trace);
+        return FALSE;
+    }
+
+    free(bmsFrames);
+    bmsFrames = (IO_CAN_DATA_FRAME*)malloc(count * sizeof(IO_CAN_DATA_FRAME));
+    bmsFrameCount = 0;
+    for (ubyte4 i = 0; i < trace->count; i++)
+    {
+        if (trace->frames[i].frame.id >= 0x620 && trace->frames[i].frame.id <= 0x62F)
+        {
+            bmsFrames[bmsFrameCount++] = trace->frames[i].frame;
+        }
+    }
+    Trace_free(trace);
+    return TRUE;
+}
+
+
+/*****************************************************************************
+* Benchmarked calls
+******************************************************************************
+* Each takes the iteration number and makes one call.  nextCycle is the part
+* every one of them shares, and is timed on its own as the overhead.
+****************************************************************************/
+static void nextCycle(ubyte4 i)
+{
+    ReplayIO_advanceTime(BENCH_CYCLE_US);
+    CycleClock_update();
+}
+
+static void call_none(ubyte4 i)
+{
+}
+
+static void call_CanManager_send(ubyte4 i)
+{
+    CanManager_send(canMan, CAN0_HIPRI, telemetry[i % BENCH_INPUTS], BENCH_TELEMETRY_FRAMES);
+}
+
+static void call_canOutput_sendDebugMessage(ubyte4 i)
+{
+    canOutput_sendDebugMessage(canMan, state, mcm0, sc);
+}
+
+static void call_SafetyChecker_update(ubyte4 i)
+{
+    SafetyChecker_update(sc, mcm0, bms, state);
+}
+
+static void call_MCM_calculateCommands(ubyte4 i)
+{
+    MCM_calculateCommands(mcm0, state);
+}
+
+static void call_TorqueEncoder_update(ubyte4 i)
+{
+    Sensor_TPS0.sensorValue = pedal_mV[i % BENCH_INPUTS];
+    Sensor_TPS1.sensorValue = pedal_mV[(i + 1) % BENCH_INPUTS];
+    TorqueEncoder_update(tps);
+}
+
+static void call_BMS_parseCanMessage(ubyte4 i)
+{
+    BMS_parseCanMessage(bms, &bmsFrames[i % bmsFrameCount]);
+}
+
+typedef struct _Bench
+{
+    const char* name;
+    void (*call)(ubyte4 i);
+} Bench;
+
+static const Bench benches[] =
+{
+      { "CanManager_send",              call_CanManager_send }
+    , { "canOutput_sendDebugMessage",   call_canOutput_sendDebugMessage }
+    , { "SafetyChecker_update",         call_SafetyChecker_update }
+    , { "MCM_calculateCommands",        call_MCM_calculateCommands }
+    , { "TorqueEncoder_update",         call_TorqueEncoder_update }
+    , { "BMS_parseCanMessage",          call_BMS_parseCanMessage }
+};
+#define BENCH_COUNT (sizeof(benches) / sizeof(benches[0]))
+
+
+/*****************************************************************************
+* Timing
+****************************************************************************/
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+//Fastest of BENCH_RUNS runs, in ns per iteration (cycle overhead included)
+static double timeCalls(void (*call)(ubyte4 i), ubyte4* arenaBytes)
+{
+    double best_ns = 0;
+    ubyte4 arenaBefore = MemoryArena_getUsed();
+
+    //Warm up: caches, and the first send of every outgoing ID creates its history node
+    for (ubyte4 i = 0; i < BENCH_INPUTS; i++)
+    {
+        nextCycle(i);
+        call(i);
+    }
+    arenaBefore = MemoryArena_getUsed();
+
+    for (ubyte1 run = 0; run < BENCH_RUNS; run++)
+    {
+        double start_ns = now_ns();
+        for (ubyte4 i = 0; i < iterations; i++)
+        {
+            nextCycle(i);
+            call(i);
+        }
+        double run_ns = (now_ns() - start_ns) / iterations;
+        if (run == 0 || run_ns < best_ns) { best_ns = run_ns; }
+    }
+
+    *arenaBytes = MemoryArena_getUsed() - arenaBefore;
+    return best_ns;
+}
+
+
+/*****************************************************************************
+* Baseline file: one "name ns_per_call" line per function, # comments
+****************************************************************************/
+static bool findBaseline(const char* path, const char* name, double* ns)
+{
+    FILE* file = fopen(path, "r");
+    char line[128];
+    char lineName[BENCH_NAME_MAX + 1];
+    bool found = FALSE;
+
+    if (file == NULL) { return FALSE; }
+    while (!found && fgets(line, sizeof(line), file) != NULL)
+    {
+        if (line[0] == '#') { continue; }
+        found = (sscanf(line, "%40s %lf", lineName, ns) == 2 && strcmp(lineName, name) == 0);
+    }
+    fclose(file);
+    return found;
+}
+
+static bool writeBaseline(const char* path, const BenchResult results[], ubyte1 count)
+{
+    FILE* file = fopen(path, "w");
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "Can't write %s\n", path);
+        return FALSE;
+    }
+    fprintf(file, "# Host ns per call from replay/bench (%lu calls per run, fastest of %u runs).\n"
+        , (unsigned long)iterations, BENCH_RUNS);
+    fprintf(file, "# Regenerate with make -C replay bench-baseline after an intended change.\n");
+    for (ubyte1 r = 0; r < count; r++)
+    {
+        fprintf(file, "%-32s %10.1f\n", results[r].name, results[r].ns);
+    }
+    fclose(file);
+    return TRUE;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: bench [options]\n"
+        "  -n calls       calls per run (default 2000000)\n"
+        "  -t trace.trc   take the BMS frames from a trace\n"
+        "  -b baseline    fail if a function is slower than its baseline by more than the tolerance\n"
+        "  -x percent     tolerance for -b (default %u)\n"
+        "  -w baseline    write the results as the new baseline\n", BENCH_TOLERANCE_PERCENT);
+    exit(2);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* tracePath = NULL;
+    const char* baselinePath = NULL;
+    const char* writePath = NULL;
+    ubyte4 tolerance = BENCH_TOLERANCE_PERCENT;
+    BenchResult results[BENCH_COUNT];
+    ubyte4 overheadArena;
+    bool failed = FALSE;
+
+    for (int arg = 1; arg < argc; arg++)
+    {
+        if (strcmp(argv[arg], "-n") == 0 && arg + 1 < argc) { iterations = strtoul(argv[++arg], NULL, 10); }
+        else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc) { tracePath = argv[++arg]; }
+        else if (strcmp(argv[arg], "-b") == 0 && arg + 1 < argc) { baselinePath = argv[++arg]; }
+        else if (strcmp(argv[arg], "-x") == 0 && arg + 1 < argc) { tolerance = strtoul(argv[++arg], NULL, 10); }
+        else if (strcmp(argv[arg], "-w") == 0 && arg + 1 < argc) { writePath = argv[++arg]; }
+        else { usage(); }
+    }
+    if (iterations == 0) { usage(); }
+
+    createObjects();
+    createSyntheticInputs();
+    if (tracePath != NULL && !loadTraceInputs(tracePath)) { return 1; }
+
+    double overhead_ns = timeCalls(call_none, &overheadArena);
+
+    printf("%-32s %10s %12s %10s\n", "function", "ns/call", "arena bytes", "baseline");
+    for (ubyte1 b = 0; b < BENCH_COUNT; b++)
+    {
+        double baseline_ns;
+        BenchResult* result = &results[b];
+
+        result->name = benches[b].name;
+        result->ns = timeCalls(benches[b].call, &result->arenaBytes) - overhead_ns;
+        if (result->ns < 0) { result->ns = 0; }
+
+        printf("%-32s %10.1f %12lu", result->name, result->ns, (unsigned long)result->arenaBytes);
+        if (baselinePath != NULL && findBaseline(baselinePath, result->name, &baseline_ns))
+        {
+            bool slower = result->ns > baseline_ns * (100 + tolerance) / 100 + BENCH_SLACK_NS;
+            printf(" %10.1f%s", baseline_ns, slower ? "  SLOWER" : "");
+            failed |= slower;
+        }
+        else if (baselinePath != NULL)
+        {
+            printf(" %10s  NOT IN BASELINE", "-");
+            failed = TRUE;
+        }
+        if (result->arenaBytes != 0)
+        {
+            printf("  ALLOCATES");
+            failed = TRUE;
+        }
+        printf("\n");
+    }
+    printf("(%lu calls per run, fastest of %u runs, %.1f ns/call cycle overhead subtracted)\n"
+        , (unsigned long)iterations, BENCH_RUNS, overhead_ns);
+
+    if (writePath != NULL && !writeBaseline(writePath, results, BENCH_COUNT)) { return 1; }
+    if (failed && baselinePath != NULL) { printf("FAILED: over the baseline by more than %lu%%, or allocating\n", (unsigned long)tolerance); }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+/*****************************************************************************
+* CAN receive ring test (host only)
+******************************************************************************
+* Builds canRxRing.c on its own and checks it from both sides:
+*
+*   make -C replay test
+*
+* - Threaded: a pthread producer pushes sequence-numbered frames as fast as
+*   it can (standing in for CanManager_poll) while the main thread pops them
+*   (CanManager_read).  Every frame must come out in order, once, and whole;
+*   the sequence numbers that never come out must be exactly the drops, and
+*   pushed == popped + dropped.  Millions of frames wrap the 16-bit head and
+*   tail many times over (the test fails if fewer than 2^17 get through).
+* - Single-threaded: highWater must be right when the fill level is reached
+*   across the 16-bit wrap, and a full ring must drop rather than overwrite.
+*
+* The ring relies on the order of its volatile stores, which x86 keeps
+* between threads as the XC2000 does between the interrupt and main loop.
+* Exits 1 on the first failure.
+****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "canRxRing.h"
+
+#define THREADED_FRAMES 4000000
+
+typedef struct _Producer
+{
+    CanRxRing* ring;
+    ubyte4 frames;          //Push attempts to make
+    ubyte4 refused;         //Push attempts the ring turned down
+    volatile bool done;
+} Producer;
+
+static void fail(const char* what, unsigned long a, unsigned long b)
+{
+    printf("FAILED: %s (%lu, %lu)\n", what, a, b);
+    exit(1);
+}
+
+//Sequence number in data[0-3], its complement in data[4-7] so a torn copy shows up
+static void makeFrame(IO_CAN_DATA_FRAME* frame, ubyte4 sequence)
+{
+    frame->id_format = IO_CAN_STD_FRAME;
+    frame->id = sequence & 0x7FF;
+    frame->length = 8;
+    for (ubyte1 i = 0; i < 4; i++)
+    {
+        frame->data[i] = (ubyte1)(sequence >> (8 * i));
+        frame->data[4 + i] = (ubyte1)(~sequence >> (8 * i));
+    }
+}
+
+static ubyte4 frameSequence(const IO_CAN_DATA_FRAME* frame)
+{
+    ubyte4 sequence = 0;
+    ubyte4 check = 0;
+
+    for (ubyte1 i = 0; i < 4; i++)
+    {
+        sequence |= (ubyte4)frame->data[i] << (8 * i);
+        check |= (ubyte4)frame->data[4 + i] << (8 * i);
+    }
+    if (check != ~sequence || frame->id != (sequence & 0x7FF) || frame->length != 8)
+    {
+        fail("torn frame", sequence, check);
+    }
+    return sequence;
+}
+
+static void* produce(void* arg)
+{
+    Producer* producer = (Producer*)arg;
+    IO_CAN_DATA_FRAME frame;
+
+    for (ubyte4 sequence = 0; sequence < producer->frames; sequence++)
+    {
+        makeFrame(&frame, sequence);
+        //Let the consumer catch up after a drop, or on one core nearly everything would be dropped
+        if (CanRxRing_push(producer->ring, &frame) == FALSE)
+        {
+            producer->refused++;
+            sched_yield();
+        }
+    }
+    producer->done = TRUE;
+    return NULL;
+}
+
+static void testThreaded(void)
+{
+    Producer producer = { CanRxRing_new(), THREADED_FRAMES, 0, FALSE };
+    pthread_t thread;
+    IO_CAN_DATA_FRAME frame;
+    ubyte4 popped = 0;
+    ubyte4 skipped = 0;         //Sequence numbers that never came out
+    ubyte4 expected = 0;        //Lowest sequence number that may come out next
+    bool finished = FALSE;
+
+    if (pthread_create(&thread, NULL, produce, &producer) != 0) { fail("pthread_create", 0, 0); }
+
+    while (!finished)
+    {
+        //Read done before popping, so an empty ring after that really is the end
+        finished = producer.done;
+        if (CanRxRing_pop(producer.ring, &frame) == FALSE)
+        {
+            if (!finished) { sched_yield(); }
+            continue;
+        }
+        finished = FALSE;
+
+        ubyte4 sequence = frameSequence(&frame);
+        if (sequence < expected) { fail("out of order or duplicate", sequence, expected); }
+        skipped += sequence - expected;
+        expected = sequence + 1;
+        popped++;
+    }
+    pthread_join(thread, NULL);
+    skipped += producer.frames - expected;
+
+    printf("Threaded: %lu pushes, %lu popped, %lu dropped, high water %u\n", (unsigned long)producer.frames
+        , (unsigned long)popped, (unsigned long)CanRxRing_getDropped(producer.ring), CanRxRing_getHighWater(producer.ring));
+
+    if (CanRxRing_getPushed(producer.ring) + CanRxRing_getDropped(producer.ring) != producer.frames)
+    {
+        fail("pushed + dropped != push attempts", CanRxRing_getPushed(producer.ring), CanRxRing_getDropped(producer.ring));
+    }
+    if (CanRxRing_getPushed(producer.ring) != popped) { fail("pushed != popped", CanRxRing_getPushed(producer.ring), popped); }
+    if (CanRxRing_getDropped(producer.ring) != producer.refused) { fail("dropped != refused pushes", CanRxRing_getDropped(producer.ring), producer.refused); }
+    if (skipped != producer.refused) { fail("missing frames != drops", skipped, producer.refused); }
+    if (popped < 0x20000) { fail("too few frames through to wrap head/tail", popped, 0x20000); }
+    if (CanRxRing_getHighWater(producer.ring) > CAN_RX_RING_SIZE) { fail("high water over ring size", CanRxRing_getHighWater(producer.ring), CAN_RX_RING_SIZE); }
+}
+
+static void testWrap(void)
+{
+    CanRxRing* ring = CanRxRing_new();
+    IO_CAN_DATA_FRAME frame;
+    ubyte4 pushed = 0;
+    ubyte4 popped = 0;
+
+    //One in, one out until head and tail are just short of the 16-bit wrap
+    while (pushed < 0xFFFF - 20)
+    {
+        makeFrame(&frame, pushed++);
+        CanRxRing_push(ring, &frame);
+        if (CanRxRing_pop(ring, &frame) == FALSE || frameSequence(&frame) != popped++) { fail("lockstep pop", popped, pushed); }
+    }
+    if (CanRxRing_getHighWater(ring) != 1) { fail("lockstep high water", CanRxRing_getHighWater(ring), 1); }
+
+    //Fill level 50 with head crossing the wrap
+    for (ubyte1 i = 0; i < 50; i++)
+    {
+        makeFrame(&frame, pushed++);
+        if (CanRxRing_push(ring, &frame) == FALSE) { fail("push across wrap", pushed, 0); }
+    }
+    if (CanRxRing_getHighWater(ring) != 50) { fail("high water across wrap", CanRxRing_getHighWater(ring), 50); }
+
+    //Tail crosses the wrap too, then fill it completely - the extra frames must be dropped
+    for (ubyte1 i = 0; i < 40; i++)
+    {
+        if (CanRxRing_pop(ring, &frame) == FALSE || frameSequence(&frame) != popped++) { fail("pop across wrap", popped, pushed); }
+    }
+    for (ubyte1 i = 0; i < CAN_RX_RING_SIZE - 10 + 5; i++)
+    {
+        makeFrame(&frame, pushed);
+        if (CanRxRing_push(ring, &frame) == TRUE) { pushed++; }
+    }
+    if (CanRxRing_getHighWater(ring) != CAN_RX_RING_SIZE) { fail("high water when full", CanRxRing_getHighWater(ring), CAN_RX_RING_SIZE); }
+    if (CanRxRing_getDropped(ring) != 5) { fail("drops when full", CanRxRing_getDropped(ring), 5); }
+
+    while (CanRxRing_pop(ring, &frame) == TRUE)
+    {
+        if (frameSequence(&frame) != popped++) { fail("drain after full", popped, pushed); }
+    }
+    if (popped != pushed || CanRxRing_getPushed(ring) != pushed) { fail("drain count", popped, pushed); }
+
+    printf("Wrap:     %lu frames through head/tail 0x%04lX, high water %u, %lu dropped\n", (unsigned long)pushed
+        , (unsigned long)(pushed & 0xFFFF), CanRxRing_getHighWater(ring), (unsigned long)CanRxRing_getDropped(ring));
+}
+
+int main(void)
+{
+    testWrap();
+    testThreaded();
+    printf("PASSED\n");
+    return 0;
+}
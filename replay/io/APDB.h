@@ -0,0 +1,44 @@
+#ifndef _APDB_H
+#define _APDB_H
+
+#include "IO_Driver.h"
+
+//Only the layout main.c fills in - the replay never reads it
+typedef struct _bl_t_date { ubyte4 date; } BL_T_DATE;
+typedef struct _bl_t_can_id { ubyte4 extended; ubyte4 ID; } BL_T_CAN_ID;
+
+typedef struct _bl_apdb
+{
+    ubyte4 versionAPDB;
+    BL_T_DATE flashDate;
+    BL_T_DATE buildDate;
+    ubyte4 nodeType;
+    ubyte4 startAddress;
+    ubyte4 codeSize;
+    ubyte4 legacyAppCRC;
+    ubyte4 appCRC;
+    ubyte1 nodeNr;
+    ubyte4 CRCInit;
+    ubyte4 flags;
+    ubyte4 hook1;
+    ubyte4 hook2;
+    ubyte4 hook3;
+    ubyte4 mainAddress;
+    BL_T_CAN_ID canDownloadID;
+    BL_T_CAN_ID canUploadID;
+    ubyte4 legacyHeaderCRC;
+    ubyte4 version;
+    ubyte2 canBaudrate;
+    ubyte1 canChannel;
+    ubyte1 reserved[8 * 4];
+    ubyte4 headerCRC;
+} APDB;
+
+#define RTS_TTC_FLASH_DATE_YEAR     0
+#define RTS_TTC_FLASH_DATE_MONTH    0
+#define RTS_TTC_FLASH_DATE_DAY      0
+#define RTS_TTC_FLASH_DATE_HOUR     0
+#define RTS_TTC_FLASH_DATE_MINUTE   0
+#define APPL_START                  0
+
+#endif // _APDB_H
@@ -0,0 +1,15 @@
+#ifndef _IO_ADC_H
+#define _IO_ADC_H
+
+#include "IO_Driver.h"
+
+#define IO_ADC_RATIOMETRIC  0
+#define IO_ADC_RESISTIVE    1
+
+typedef struct _io_adc_safety_conf IO_ADC_SAFETY_CONF;
+
+IO_ErrorType IO_ADC_ChannelInit(ubyte1 adc_channel, ubyte1 type, ubyte1 range, ubyte1 pupd, ubyte1 sensor_supply, const IO_ADC_SAFETY_CONF* const safety_conf);
+IO_ErrorType IO_ADC_ChannelDeInit(ubyte1 adc_channel);
+IO_ErrorType IO_ADC_Get(ubyte1 adc_channel, ubyte4* const adc_value, bool* const fresh);
+
+#endif // _IO_ADC_H
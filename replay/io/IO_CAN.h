@@ -0,0 +1,30 @@
+#ifndef _IO_CAN_H
+#define _IO_CAN_H
+
+#include "IO_Driver.h"
+
+#define IO_CAN_CHANNEL_0    0
+#define IO_CAN_CHANNEL_1    1
+
+#define IO_CAN_MSG_READ     0
+#define IO_CAN_MSG_WRITE    1
+
+#define IO_CAN_STD_FRAME    0
+#define IO_CAN_EXT_FRAME    1
+
+typedef struct _io_can_data_frame
+{
+    ubyte1 data[8];
+    ubyte1 length;
+    ubyte1 id_format;
+    ubyte4 id;
+} IO_CAN_DATA_FRAME;
+
+IO_ErrorType IO_CAN_Init(ubyte1 channel, ubyte2 baudrate, ubyte1 tseg1, ubyte1 tseg2, ubyte1 sjw);
+IO_ErrorType IO_CAN_ConfigMsg(ubyte1* const handle, ubyte1 channel, ubyte1 mode, ubyte1 id_format, ubyte4 id, ubyte4 ac_mask);
+IO_ErrorType IO_CAN_ConfigFIFO(ubyte1* const handle, ubyte1 channel, ubyte1 size, ubyte1 mode, ubyte1 id_format, ubyte4 id, ubyte4 ac_mask);
+IO_ErrorType IO_CAN_ReadFIFO(ubyte1 handle, IO_CAN_DATA_FRAME* const buffer, ubyte1 buffer_size, ubyte1* const rx_frames);
+IO_ErrorType IO_CAN_WriteFIFO(ubyte1 handle, const IO_CAN_DATA_FRAME* const data, ubyte1 length);
+IO_ErrorType IO_CAN_WriteMsg(ubyte1 handle, const IO_CAN_DATA_FRAME* const data);
+
+#endif // _IO_CAN_H
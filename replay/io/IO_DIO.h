@@ -0,0 +1,14 @@
+#ifndef _IO_DIO_H
+#define _IO_DIO_H
+
+#include "IO_Driver.h"
+
+#define IO_DI_PD_10K    0
+
+IO_ErrorType IO_DI_Init(ubyte1 di_channel, ubyte1 mode);
+IO_ErrorType IO_DI_DeInit(ubyte1 di_channel);
+IO_ErrorType IO_DI_Get(ubyte1 di_channel, bool* const di_value);
+IO_ErrorType IO_DO_Init(ubyte1 do_channel);
+IO_ErrorType IO_DO_Set(ubyte1 do_channel, bool do_value);
+
+#endif // _IO_DIO_H
@@ -0,0 +1,98 @@
+#ifndef _IO_DRIVER_H
+#define _IO_DRIVER_H
+
+/*****************************************************************************
+* Host stand-in for the TTTech IO driver (replay builds only)
+******************************************************************************
+* Declares just the types, constants and functions the firmware uses, with
+* the HY-TTC 50 signatures.  The constant values are this stub's own - only
+* the names match the real headers.  Implemented in replay/ioStubs.c.
+****************************************************************************/
+#include <stddef.h>  //NULL
+
+typedef unsigned char ubyte1;
+typedef unsigned short ubyte2;
+typedef unsigned int ubyte4;    //32 bits on the host as on the XC2000
+typedef signed char sbyte1;
+typedef signed short sbyte2;
+typedef signed int sbyte4;
+typedef float float4;
+typedef unsigned char bool;
+
+#define TRUE 1
+#define FALSE 0
+
+typedef ubyte2 IO_ErrorType;
+
+#define IO_E_OK                         0
+#define IO_E_BUSY                       1
+#define IO_E_NULL_POINTER               2
+#define IO_E_INVALID_CHANNEL_ID         3
+#define IO_E_CHANNEL_NOT_CONFIGURED     4
+#define IO_E_CAN_BUS_OFF                10
+#define IO_E_CAN_ERROR_PASSIVE          11
+#define IO_E_CAN_ERROR_WARNING          12
+#define IO_E_CAN_FIFO_FULL              13
+#define IO_E_CAN_OLD_DATA               14
+#define IO_E_CAN_WRONG_HANDLE           15
+#define IO_E_CAN_MAX_HANDLES_REACHED    16
+
+//Pins.  Every input/output is an index into the stub's pin tables (IO_PIN_COUNT entries).
+#define IO_ADC_5V_00            0
+#define IO_ADC_5V_01            1
+#define IO_ADC_5V_02            2
+#define IO_ADC_5V_03            3
+#define IO_ADC_5V_04            4
+#define IO_ADC_5V_05            5
+#define IO_ADC_5V_06            6
+#define IO_ADC_5V_07            7
+#define IO_ADC_UBAT             8
+#define IO_ADC_CUR_00           9
+#define IO_ADC_CUR_01           10
+#define IO_ADC_CUR_02           11
+#define IO_ADC_CUR_03           12
+#define IO_DI_00                13
+#define IO_DI_01                14
+#define IO_DI_02                15
+#define IO_DI_03                16
+#define IO_DI_06                17
+#define IO_DI_07                18
+#define IO_DO_00                19
+#define IO_DO_01                20
+#define IO_DO_02                21
+#define IO_DO_03                22
+#define IO_DO_04                23
+#define IO_DO_05                24
+#define IO_DO_06                25
+#define IO_DO_07                26
+#define IO_PWM_00               27
+#define IO_PWM_01               28
+#define IO_PWM_02               29
+#define IO_PWM_03               30
+#define IO_PWM_04               31
+#define IO_PWM_05               32
+#define IO_PWM_06               33
+#define IO_PWM_07               34
+#define IO_PWD_08               35
+#define IO_PWD_09               36
+#define IO_PWD_10               37
+#define IO_PWD_11               38
+#define IO_ADC_SENSOR_SUPPLY_0  39
+#define IO_ADC_SENSOR_SUPPLY_1  40
+#define IO_SENSOR_SUPPLY_VAR    41
+#define IO_PIN_269              42
+#define IO_PIN_COUNT            43
+
+#define IO_POWER_ON             1
+#define IO_POWER_8_5_V          2
+#define IO_POWER_14_5_V         3
+
+typedef struct _io_driver_safety_conf IO_DRIVER_SAFETY_CONF;
+
+IO_ErrorType IO_Driver_Init(const IO_DRIVER_SAFETY_CONF* const safety_conf);
+IO_ErrorType IO_Driver_TaskBegin(void);
+IO_ErrorType IO_Driver_TaskEnd(void);
+
+IO_ErrorType IO_POWER_Set(ubyte1 pin, ubyte1 mode);
+
+#endif // _IO_DRIVER_H
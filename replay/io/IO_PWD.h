@@ -0,0 +1,14 @@
+#ifndef _IO_PWD_H
+#define _IO_PWD_H
+
+#include "IO_Driver.h"
+
+#define IO_PWD_FALLING_VAR  0
+#define IO_PWD_HIGH_TIME    0
+
+IO_ErrorType IO_PWD_FreqInit(ubyte1 timer_channel, ubyte1 freq_mode);
+IO_ErrorType IO_PWD_FreqGet(ubyte1 timer_channel, ubyte4* const frequency);
+IO_ErrorType IO_PWD_PulseInit(ubyte1 timer_channel, ubyte1 pulse_mode);
+IO_ErrorType IO_PWD_PulseGet(ubyte1 timer_channel, ubyte4* const pulse_time);
+
+#endif // _IO_PWD_H
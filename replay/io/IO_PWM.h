@@ -0,0 +1,12 @@
+#ifndef _IO_PWM_H
+#define _IO_PWM_H
+
+#include "IO_Driver.h"
+#include "IO_PWD.h"     //initializations.c gets the timer input modes through this header
+
+typedef struct _io_pwm_safety_conf IO_PWM_SAFETY_CONF;
+
+IO_ErrorType IO_PWM_Init(ubyte1 pwm_channel, ubyte2 frequency, bool polarity, bool diag_margin, ubyte1 max_current, bool current_control, const IO_PWM_SAFETY_CONF* const safety_conf);
+IO_ErrorType IO_PWM_SetDuty(ubyte1 pwm_channel, ubyte2 duty, ubyte2* const current);
+
+#endif // _IO_PWM_H
@@ -0,0 +1,9 @@
+#ifndef _IO_RTC_H
+#define _IO_RTC_H
+
+#include "IO_Driver.h"
+
+IO_ErrorType IO_RTC_StartTime(ubyte4* const timestamp);
+ubyte4 IO_RTC_GetTimeUS(ubyte4 timestamp);
+
+#endif // _IO_RTC_H
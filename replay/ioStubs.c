@@ -0,0 +1,443 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "IO_Driver.h"
+#include "IO_ADC.h"
+#include "IO_CAN.h"
+#include "IO_DIO.h"
+#include "IO_EEPROM.h"
+#include "IO_PWD.h"
+#include "IO_PWM.h"
+#include "IO_RTC.h"
+#include "IO_UART.h"
+
+#include "replayIO.h"
+
+#define RTC_READ_COST_US 1
+#define IDLE_STEP_US 500            //Longest jump an idle RTC read makes (limits cycle start jitter)
+#define CAN_HANDLES_MAX 32
+#define CAN_FIFO_FRAMES_MAX 64      //Largest FIFO the driver allows
+#define EEPROM_BYTES 0x10000
+
+typedef struct _StubCanHandle
+{
+    ubyte1 channel;
+    ubyte1 mode;                    //IO_CAN_MSG_READ/WRITE
+    bool isFIFO;                    //FALSE for a single message object
+    ubyte4 id;
+    ubyte4 mask;
+    ubyte1 size;
+    IO_CAN_DATA_FRAME frames[CAN_FIFO_FRAMES_MAX];
+    ubyte1 head;                    //Next frame to read
+    ubyte1 count;
+    bool overflowed;                //Reported (and cleared) by the next read
+} StubCanHandle;
+
+static TraceTime now_us = 0;        //Virtual time since power on
+static bool idle = FALSE;           //Between IO_Driver_TaskEnd and the next IO_Driver_TaskBegin
+
+static const Trace* trace = NULL;
+static ubyte4 nextFrame = 0;
+static bool traceStarted = FALSE;
+static TraceTime traceStart_us = 0; //Virtual time of the first trace frame
+
+static StubCanHandle canHandles[CAN_HANDLES_MAX];
+static ubyte1 canHandleCount = 0;
+
+static ubyte4 inputs[IO_PIN_COUNT];
+static ubyte1 eeprom[EEPROM_BYTES];
+static bool eepromInitialized = FALSE;
+static bool serialEcho = FALSE;
+
+static ReplayIO_FrameHandler frameHandler = NULL;
+static ReplayIO_CycleHandler cycleHandler = NULL;
+static ReplayIOStats stats;
+
+
+/*****************************************************************************
+* Replay setup
+****************************************************************************/
+void ReplayIO_setTrace(const Trace* newTrace)
+{
+    trace = newTrace;
+    nextFrame = 0;
+}
+
+void ReplayIO_setInput(ubyte1 pin, ubyte4 value)
+{
+    if (pin < IO_PIN_COUNT) { inputs[pin] = value; }
+}
+
+void ReplayIO_setSerialEcho(bool echo)
+{
+    serialEcho = echo;
+}
+
+void ReplayIO_setFrameHandler(ReplayIO_FrameHandler onWrite)
+{
+    frameHandler = onWrite;
+}
+
+void ReplayIO_setCycleHandler(ReplayIO_CycleHandler onCycleEnd)
+{
+    cycleHandler = onCycleEnd;
+}
+
+TraceTime ReplayIO_getTraceTime(void)
+{
+    TraceTime firstFrame_us = (trace != NULL && trace->count > 0) ? trace->frames[0].time_us : 0;
+    return traceStarted ? firstFrame_us + (now_us - traceStart_us) : firstFrame_us;
+}
+
+bool ReplayIO_isTraceDone(void)
+{
+    return trace == NULL || nextFrame >= trace->count;
+}
+
+const ReplayIOStats* ReplayIO_getStats(void)
+{
+    return &stats;
+}
+
+void ReplayIO_advanceTime(TraceTime step_us)
+{
+    now_us += step_us;
+}
+
+
+/*****************************************************************************
+* Driver and clock
+****************************************************************************/
+IO_ErrorType IO_Driver_Init(const IO_DRIVER_SAFETY_CONF* const safety_conf)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_Driver_TaskBegin(void)
+{
+    idle = FALSE;
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_Driver_TaskEnd(void)
+{
+    idle = TRUE;
+    stats.cycles++;
+    if (cycleHandler != NULL) { cycleHandler(); }
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_RTC_StartTime(ubyte4* const timestamp)
+{
+    *timestamp = (ubyte4)now_us;
+    return IO_E_OK;
+}
+
+//Virtual time of the next trace frame, or 0 if there is none
+static TraceTime nextFrameDue(void)
+{
+    if (!traceStarted || trace == NULL || nextFrame >= trace->count) { return 0; }
+    return traceStart_us + (trace->frames[nextFrame].time_us - trace->frames[0].time_us);
+}
+
+ubyte4 IO_RTC_GetTimeUS(ubyte4 timestamp)
+{
+    TraceTime step_us = RTC_READ_COST_US;
+
+    //Nothing happens while the firmware waits except frames arriving, so jump to the next one
+    if (idle)
+    {
+        TraceTime due_us = nextFrameDue();
+        step_us = (due_us > now_us && due_us - now_us < IDLE_STEP_US) ? due_us - now_us : IDLE_STEP_US;
+    }
+    now_us += step_us;
+    return (ubyte4)now_us - timestamp;
+}
+
+IO_ErrorType IO_POWER_Set(ubyte1 pin, ubyte1 mode)
+{
+    return IO_E_OK;
+}
+
+
+/*****************************************************************************
+* CAN
+****************************************************************************/
+IO_ErrorType IO_CAN_Init(ubyte1 channel, ubyte2 baudrate, ubyte1 tseg1, ubyte1 tseg2, ubyte1 sjw)
+{
+    return (channel <= IO_CAN_CHANNEL_1) ? IO_E_OK : IO_E_INVALID_CHANNEL_ID;
+}
+
+static IO_ErrorType configHandle(ubyte1* const handle, ubyte1 channel, ubyte1 mode, bool isFIFO, ubyte1 size, ubyte4 id, ubyte4 mask)
+{
+    StubCanHandle* stub;
+
+    if (handle == NULL) { return IO_E_NULL_POINTER; }
+    if (canHandleCount == CAN_HANDLES_MAX) { return IO_E_CAN_MAX_HANDLES_REACHED; }
+
+    stub = &canHandles[canHandleCount];
+    memset(stub, 0, sizeof(*stub));
+    stub->channel = channel;
+    stub->mode = mode;
+    stub->isFIFO = isFIFO;
+    stub->id = id;
+    stub->mask = mask;
+    stub->size = (size == 0 || size > CAN_FIFO_FRAMES_MAX) ? CAN_FIFO_FRAMES_MAX : size;
+    *handle = canHandleCount++;
+
+    //The hardware starts receiving as soon as the first receive buffer exists
+    if (mode == IO_CAN_MSG_READ && !traceStarted)
+    {
+        traceStarted = TRUE;
+        traceStart_us = now_us;
+    }
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_CAN_ConfigMsg(ubyte1* const handle, ubyte1 channel, ubyte1 mode, ubyte1 id_format, ubyte4 id, ubyte4 ac_mask)
+{
+    return configHandle(handle, channel, mode, FALSE, 1, id, ac_mask);
+}
+
+IO_ErrorType IO_CAN_ConfigFIFO(ubyte1* const handle, ubyte1 channel, ubyte1 size, ubyte1 mode, ubyte1 id_format, ubyte4 id, ubyte4 ac_mask)
+{
+    return configHandle(handle, channel, mode, TRUE, size, id, ac_mask);
+}
+
+//Puts a received frame into the first receive buffer on its channel that accepts it
+static void deliverFrame(ubyte1 channel, const IO_CAN_DATA_FRAME* frame)
+{
+    StubCanHandle* target = NULL;
+
+    for (ubyte1 h = 0; h < canHandleCount && target == NULL; h++)
+    {
+        StubCanHandle* stub = &canHandles[h];
+        if (stub->mode == IO_CAN_MSG_READ && stub->channel == channel
+            && (frame->id & stub->mask) == (stub->id & stub->mask))
+        {
+            target = stub;
+        }
+    }
+
+    if (target == NULL)
+    {
+        stats.filtered++;
+    }
+    else if (target->count == target->size)
+    {
+        target->overflowed = TRUE;
+        stats.overflowed++;
+    }
+    else
+    {
+        target->frames[(target->head + target->count) % CAN_FIFO_FRAMES_MAX] = *frame;
+        target->count++;
+        stats.delivered++;
+    }
+}
+
+//Moves every trace frame that is due into the receive buffer that accepts it
+static void deliverDueFrames(void)
+{
+    if (!traceStarted || trace == NULL) { return; }
+
+    while (nextFrame < trace->count && nextFrameDue() <= now_us)
+    {
+        const TraceFrame* due = &trace->frames[nextFrame++];
+        ubyte1 channel = (due->bus == 1) ? IO_CAN_CHANNEL_0 : (due->bus == 2) ? IO_CAN_CHANNEL_1 : 0xFF;
+        deliverFrame(channel, &due->frame);
+    }
+}
+
+void ReplayIO_injectFrame(ubyte1 channel, const IO_CAN_DATA_FRAME* frame)
+{
+    //Anything due from the trace arrived first
+    deliverDueFrames();
+    stats.injected++;
+    deliverFrame(channel, frame);
+}
+
+IO_ErrorType IO_CAN_ReadFIFO(ubyte1 handle, IO_CAN_DATA_FRAME* const buffer, ubyte1 buffer_size, ubyte1* const rx_frames)
+{
+    StubCanHandle* stub;
+    bool overflowed;
+
+    if (buffer == NULL || rx_frames == NULL) { return IO_E_NULL_POINTER; }
+    *rx_frames = 0;
+    if (handle >= canHandleCount || canHandles[handle].mode != IO_CAN_MSG_READ) { return IO_E_CAN_WRONG_HANDLE; }
+
+    deliverDueFrames();
+
+    stub = &canHandles[handle];
+    while (stub->count > 0 && *rx_frames < buffer_size)
+    {
+        buffer[(*rx_frames)++] = stub->frames[stub->head];
+        stub->head = (stub->head + 1) % CAN_FIFO_FRAMES_MAX;
+        stub->count--;
+    }
+
+    overflowed = stub->overflowed;
+    stub->overflowed = FALSE;
+    if (overflowed) { return IO_E_CAN_FIFO_FULL; }
+    return (*rx_frames == 0) ? IO_E_CAN_OLD_DATA : IO_E_OK;
+}
+
+static IO_ErrorType writeFrames(ubyte1 handle, const IO_CAN_DATA_FRAME* const data, ubyte1 length)
+{
+    if (data == NULL) { return IO_E_NULL_POINTER; }
+    if (handle >= canHandleCount || canHandles[handle].mode != IO_CAN_MSG_WRITE) { return IO_E_CAN_WRONG_HANDLE; }
+
+    for (ubyte1 i = 0; i < length; i++)
+    {
+        stats.written++;
+        if (frameHandler != NULL) { frameHandler(ReplayIO_getTraceTime(), canHandles[handle].channel, &data[i]); }
+    }
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_CAN_WriteFIFO(ubyte1 handle, const IO_CAN_DATA_FRAME* const data, ubyte1 length)
+{
+    return writeFrames(handle, data, length);
+}
+
+IO_ErrorType IO_CAN_WriteMsg(ubyte1 handle, const IO_CAN_DATA_FRAME* const data)
+{
+    return writeFrames(handle, data, 1);
+}
+
+
+/*****************************************************************************
+* Inputs and outputs - inputs read ReplayIO_setInput values, outputs go nowhere
+****************************************************************************/
+IO_ErrorType IO_ADC_ChannelInit(ubyte1 adc_channel, ubyte1 type, ubyte1 range, ubyte1 pupd, ubyte1 sensor_supply, const IO_ADC_SAFETY_CONF* const safety_conf)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_ADC_ChannelDeInit(ubyte1 adc_channel)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_ADC_Get(ubyte1 adc_channel, ubyte4* const adc_value, bool* const fresh)
+{
+    if (adc_channel >= IO_PIN_COUNT) { return IO_E_INVALID_CHANNEL_ID; }
+    *adc_value = inputs[adc_channel];
+    *fresh = TRUE;
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_DI_Init(ubyte1 di_channel, ubyte1 mode)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_DI_DeInit(ubyte1 di_channel)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_DI_Get(ubyte1 di_channel, bool* const di_value)
+{
+    if (di_channel >= IO_PIN_COUNT) { return IO_E_INVALID_CHANNEL_ID; }
+    *di_value = (inputs[di_channel] != 0) ? TRUE : FALSE;
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_DO_Init(ubyte1 do_channel)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_DO_Set(ubyte1 do_channel, bool do_value)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_PWM_Init(ubyte1 pwm_channel, ubyte2 frequency, bool polarity, bool diag_margin, ubyte1 max_current, bool current_control, const IO_PWM_SAFETY_CONF* const safety_conf)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_PWM_SetDuty(ubyte1 pwm_channel, ubyte2 duty, ubyte2* const current)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_PWD_FreqInit(ubyte1 timer_channel, ubyte1 freq_mode)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_PWD_FreqGet(ubyte1 timer_channel, ubyte4* const frequency)
+{
+    if (timer_channel >= IO_PIN_COUNT) { return IO_E_INVALID_CHANNEL_ID; }
+    *frequency = inputs[timer_channel];
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_PWD_PulseInit(ubyte1 timer_channel, ubyte1 pulse_mode)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_PWD_PulseGet(ubyte1 timer_channel, ubyte4* const pulse_time)
+{
+    if (timer_channel >= IO_PIN_COUNT) { return IO_E_INVALID_CHANNEL_ID; }
+    *pulse_time = inputs[timer_channel];
+    return IO_E_OK;
+}
+
+
+/*****************************************************************************
+* EEPROM - starts erased (0xFF) every run, and never busy
+****************************************************************************/
+IO_ErrorType IO_EEPROM_Init(void)
+{
+    if (!eepromInitialized)
+    {
+        memset(eeprom, 0xFF, sizeof(eeprom));
+        eepromInitialized = TRUE;
+    }
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_EEPROM_Read(ubyte2 offset, ubyte2 length, ubyte1* const data)
+{
+    if ((ubyte4)offset + length > EEPROM_BYTES) { return IO_E_INVALID_CHANNEL_ID; }
+    memcpy(data, &eeprom[offset], length);
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_EEPROM_Write(ubyte2 offset, ubyte2 length, const ubyte1* const data)
+{
+    if ((ubyte4)offset + length > EEPROM_BYTES) { return IO_E_INVALID_CHANNEL_ID; }
+    memcpy(&eeprom[offset], data, length);
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_EEPROM_GetStatus(void)
+{
+    return IO_E_OK;
+}
+
+
+/*****************************************************************************
+* UART - serial output goes to stderr when echo is on
+****************************************************************************/
+IO_ErrorType IO_UART_Init(ubyte1 channel, ubyte4 baudrate, ubyte1 dbits, ubyte1 par, ubyte1 sbits)
+{
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_UART_Write(ubyte1 channel, const ubyte1* const data, ubyte1 length, ubyte1* const tx_len)
+{
+    if (serialEcho) { fwrite(data, 1, length, stderr); }
+    *tx_len = length;
+    return IO_E_OK;
+}
+
+IO_ErrorType IO_UART_Task(void)
+{
+    return IO_E_OK;
+}
@@ -0,0 +1,254 @@
+#include <stdlib.h>
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "plantModel.h"
+#include "replayIO.h"
+
+#define MCM_COMMAND_ID 0xC0
+
+//Vehicle - gear ratio and tire size match MCM_getGroundSpeedKPH
+#define PLANT_MASS_KG 300.0           //Car + driver
+#define PLANT_GEAR_RATIO 3.0
+#define PLANT_WHEEL_RADIUS_M (18 * .0254 / 2)
+#define PLANT_DRAG_NS2PM2 0.75        //0.5 * air density * CdA
+#define PLANT_ROLLING_N 45.0          //Crr * m * g
+#define PLANT_STEP_MAX_S 0.1          //Longer gaps are clipped to this
+
+//Motor/inverter
+#define PLANT_EFFICIENCY 0.9          //Same either way: losses are 10% of shaft power
+#define PLANT_MOTOR_HEAT_J_PER_C 8000.0
+#define PLANT_MOTOR_COOLING_W_PER_C 25.0
+
+//Battery
+#define PLANT_CELLS_SERIES 80
+#define PLANT_OCV_EMPTY_V 270.0
+#define PLANT_OCV_FULL_V 330.0
+#define PLANT_RESISTANCE_OHM 0.15
+#define PLANT_CAPACITY_AH 20.0
+#define PLANT_PACK_HEAT_J_PER_C 30000.0
+#define PLANT_PACK_COOLING_W_PER_C 15.0
+#define PLANT_CHARGE_LIMIT_A 32       //Match the amp limits given to SafetyChecker_new
+#define PLANT_DISCHARGE_LIMIT_A 320
+
+#define PLANT_AMBIENT_C 25.0
+
+struct _PlantModel
+{
+    bool started;
+    TraceTime lastStep_us;
+
+    //Last 0xC0 received
+    double torqueCommand_Nm;
+    bool enableCommand;
+
+    //RMS handshake
+    bool lockout;           //Set at power-up, cleared by the first inverter disable command
+    bool inverterEnabled;
+
+    //Outputs of the last step
+    double torque_Nm;
+    double motorRPM;
+    double packCurrent_A;
+
+    PlantState state;
+};
+
+PlantModel* PlantModel_new(void)
+{
+    PlantModel* me = (PlantModel*)calloc(1, sizeof(struct _PlantModel));
+    if (me == NULL) { return NULL; }
+
+    me->lockout = TRUE;
+    me->state.soc = 1;
+    me->state.motorTemp_C = PLANT_AMBIENT_C;
+    me->state.packTemp_C = PLANT_AMBIENT_C;
+    me->state.packVoltage_V = PLANT_OCV_FULL_V;
+
+    return me;
+}
+
+void PlantModel_free(PlantModel* me)
+{
+    free(me);
+}
+
+const PlantState* PlantModel_getState(PlantModel* me)
+{
+    return &me->state;
+}
+
+//0xC0 layout: see canOutput_sendMCMCommand
+void PlantModel_onFrameWritten(PlantModel* me, ubyte1 channel, const IO_CAN_DATA_FRAME* frame)
+{
+    if (channel != IO_CAN_CHANNEL_0 || frame->id_format != IO_CAN_STD_FRAME || frame->id != MCM_COMMAND_ID) { return; }
+
+    me->torqueCommand_Nm = (sbyte2)(frame->data[0] | (frame->data[1] << 8)) / 10.0;
+    me->enableCommand = (frame->data[5] & 0x01) != 0;
+
+    //RMS handshake: lockout holds until a disable command is seen
+    if (me->enableCommand == FALSE)
+    {
+        me->lockout = FALSE;
+        me->inverterEnabled = FALSE;
+    }
+    else if (me->lockout == FALSE)
+    {
+        me->inverterEnabled = TRUE;
+    }
+}
+
+/*****************************************************************************
+* Model step
+******************************************************************************
+* Torque follows the command instantly (the inverter's own torque loop is much
+* faster than our cycle).  Battery current comes from electrical power over
+* open circuit voltage, and sags the terminal voltage across the pack
+* resistance.  Temperatures are single thermal masses cooled to ambient.
+****************************************************************************/
+static void PlantModel_step(PlantModel* me, double dt)
+{
+    PlantState* state = &me->state;
+    double motorSpeed_radps;
+    double electricalPower_W;
+    double loss_W;
+    double ocv;
+    double force_N;
+
+    me->torque_Nm = me->inverterEnabled ? me->torqueCommand_Nm : 0;
+    //No reverse gear: regen can hold the car at a stop but not push it backwards
+    if (state->speed_mps <= 0 && me->torque_Nm < 0) { me->torque_Nm = 0; }
+
+    motorSpeed_radps = state->speed_mps / PLANT_WHEEL_RADIUS_M * PLANT_GEAR_RATIO;
+    me->motorRPM = motorSpeed_radps * 60 / (2 * 3.141592653589);
+
+    //Shaft power is negative when regenerating; losses always heat the motor
+    loss_W = me->torque_Nm * motorSpeed_radps * (1 - PLANT_EFFICIENCY);
+    if (loss_W < 0) { loss_W = -loss_W; }
+    electricalPower_W = me->torque_Nm * motorSpeed_radps + loss_W;
+
+    ocv = PLANT_OCV_EMPTY_V + (PLANT_OCV_FULL_V - PLANT_OCV_EMPTY_V) * state->soc;
+    me->packCurrent_A = electricalPower_W / ocv;
+    state->packVoltage_V = ocv - me->packCurrent_A * PLANT_RESISTANCE_OHM;
+    state->energy_Wh += electricalPower_W * dt / 3600;
+    state->soc -= me->packCurrent_A * dt / (PLANT_CAPACITY_AH * 3600);
+    if (state->soc < 0) { state->soc = 0; }
+    if (state->soc > 1) { state->soc = 1; }
+
+    force_N = me->torque_Nm * PLANT_GEAR_RATIO / PLANT_WHEEL_RADIUS_M
+            - PLANT_DRAG_NS2PM2 * state->speed_mps * state->speed_mps
+            - ((state->speed_mps > 0) ? PLANT_ROLLING_N : 0);
+    state->speed_mps += force_N / PLANT_MASS_KG * dt;
+    if (state->speed_mps < 0) { state->speed_mps = 0; }
+    state->distance_m += state->speed_mps * dt;
+
+    state->motorTemp_C += (loss_W - (state->motorTemp_C - PLANT_AMBIENT_C) * PLANT_MOTOR_COOLING_W_PER_C)
+                        / PLANT_MOTOR_HEAT_J_PER_C * dt;
+    state->packTemp_C += (me->packCurrent_A * me->packCurrent_A * PLANT_RESISTANCE_OHM
+                          - (state->packTemp_C - PLANT_AMBIENT_C) * PLANT_PACK_COOLING_W_PER_C)
+                       / PLANT_PACK_HEAT_J_PER_C * dt;
+}
+
+static void put16(ubyte1* data, sbyte4 value)
+{
+    data[0] = (ubyte1)value;
+    data[1] = (ubyte1)(value >> 8);
+}
+
+static ubyte1 toByte(double value)
+{
+    return (value <= 0) ? 0 : (value >= 255) ? 255 : (ubyte1)value;
+}
+
+static void initFrame(IO_CAN_DATA_FRAME* frame, ubyte2 id)
+{
+    frame->id_format = IO_CAN_STD_FRAME;
+    frame->id = id;
+    frame->length = 8;
+    for (ubyte1 i = 0; i < 8; i++) { frame->data[i] = 0; }
+}
+
+/*****************************************************************************
+* Frames - only the fields the parsers read are filled in (see
+* MCM_parseCanMessage and BMS_parseCanMessage for the layouts)
+****************************************************************************/
+void PlantModel_update(PlantModel* me, TraceTime now_us)
+{
+    const PlantState* state = &me->state;
+    IO_CAN_DATA_FRAME frame;
+    ubyte1 cellVoltage;
+    double dt;
+
+    dt = me->started ? (now_us - me->lastStep_us) / 1e6 : 0;
+    me->started = TRUE;
+    me->lastStep_us = now_us;
+    if (dt > PLANT_STEP_MAX_S) { dt = PLANT_STEP_MAX_S; }
+    PlantModel_step(me, dt);
+
+    //RMS inverter
+    initFrame(&frame, 0xA2);
+    put16(&frame.data[4], (sbyte4)(state->motorTemp_C * 10));
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    initFrame(&frame, 0xA5);
+    put16(&frame.data[2], (sbyte4)me->motorRPM);
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    initFrame(&frame, 0xA6);
+    put16(&frame.data[6], (sbyte4)(me->packCurrent_A * 10));
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    initFrame(&frame, 0xA7);
+    put16(&frame.data[0], (sbyte4)(state->packVoltage_V * 10));
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    initFrame(&frame, 0xAA);
+    frame.data[6] = (me->inverterEnabled ? 0x01 : 0) | (me->lockout ? 0x80 : 0);
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    initFrame(&frame, 0xAB);  //No faults
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    initFrame(&frame, 0xAC);
+    put16(&frame.data[0], (sbyte4)(me->torque_Nm * 10));
+    put16(&frame.data[2], (sbyte4)(me->torque_Nm * 10));
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    //Elithion BMS
+    initFrame(&frame, 0x622);  //State 0, no faults or warnings
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    cellVoltage = toByte(state->packVoltage_V / PLANT_CELLS_SERIES * 10);
+    initFrame(&frame, 0x623);
+    frame.data[2] = cellVoltage;
+    frame.data[3] = 1;
+    frame.data[4] = cellVoltage;
+    frame.data[5] = 2;
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    initFrame(&frame, 0x624);
+    put16(&frame.data[2], PLANT_CHARGE_LIMIT_A);
+    put16(&frame.data[4], PLANT_DISCHARGE_LIMIT_A);
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    initFrame(&frame, 0x626);
+    frame.data[0] = toByte(state->soc * 100);
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    initFrame(&frame, 0x627);
+    frame.data[2] = toByte(state->packTemp_C);
+    frame.data[3] = 1;
+    frame.data[4] = toByte(state->packTemp_C + 3);  //Hottest cell runs a little above average
+    frame.data[5] = 2;
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+
+    initFrame(&frame, 0x629);
+    put16(&frame.data[0], (sbyte4)(state->packVoltage_V * 10));
+    put16(&frame.data[2], (sbyte4)(me->packCurrent_A * 10));
+    frame.data[4] = toByte(state->packTemp_C + 3);
+    frame.data[5] = toByte(state->packTemp_C);
+    frame.data[6] = 100;
+    frame.data[7] = 100;
+    ReplayIO_injectFrame(IO_CAN_CHANNEL_0, &frame);
+}
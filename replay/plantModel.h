@@ -0,0 +1,51 @@
+#ifndef _PLANTMODEL_H
+#define _PLANTMODEL_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+#include "trcReader.h"
+
+/*****************************************************************************
+* Plant model - inverter, battery and vehicle (host only)
+******************************************************************************
+* Closes the loop for a replay run with no inverter or BMS in the trace.
+* It listens to the 0xC0 command frames the firmware writes (torque and
+* inverter enable), steps a longitudinal model of the car - motor torque
+* and speed, vehicle speed, pack voltage sag, motor/pack temperatures and
+* the RMS lockout handshake - and hands the RMS (0xA2-0xAC) and Elithion
+* (0x622-0x629) frames back to the IO_CAN_ReadFIFO stub with
+* ReplayIO_injectFrame.  The firmware receives them through its normal
+* FIFOs, so the parsers, CAN timeouts, MCM_inverterControl,
+* MCM_calculateCommands and SafetyChecker_reduceTorque all run unchanged.
+*
+* Runs on the replay's virtual clock, so a whole endurance run takes
+* seconds (see replay -p).
+****************************************************************************/
+typedef struct _PlantModel PlantModel;
+
+typedef struct _PlantState
+{
+    double speed_mps;
+    double soc;             //0-1
+    double motorTemp_C;
+    double packTemp_C;
+    double packVoltage_V;
+    double distance_m;
+    double energy_Wh;       //Drawn from the pack, less regen
+} PlantState;
+
+//Parked, full pack, everything at ambient, inverter locked out
+PlantModel* PlantModel_new(void);
+
+void PlantModel_free(PlantModel* me);
+
+//Give it every frame the firmware writes - it only acts on the 0xC0 command
+void PlantModel_onFrameWritten(PlantModel* me, ubyte1 channel, const IO_CAN_DATA_FRAME* frame);
+
+//Steps the model to now_us with the last commands received, then injects the
+//resulting inverter/BMS frames.  Call once per firmware cycle.
+void PlantModel_update(PlantModel* me, TraceTime now_us);
+
+const PlantState* PlantModel_getState(PlantModel* me);
+
+#endif // _PLANTMODEL_H
@@ -0,0 +1,250 @@
+/*****************************************************************************
+* PCAN trace replay (host only)
+******************************************************************************
+* Runs the firmware, unchanged, against a PCAN-Explorer .trc trace on a
+* virtual clock.  The trace frames are received through the IO_CAN stubs
+* (see replayIO.h) at their original times.  Every frame the firmware writes
+* - the 0xC0 MCM commands and the 0x5xx telemetry - is recorded to a .trc
+* with the same time base, so it lines up with the input in PCAN-Explorer.
+*
+*   make -C replay
+*   replay/replay -o out.trc PCAN/endurance.trc
+*
+* Nothing waits in real time, so a run goes as fast as the host can execute
+* the main loop.  The summary prints the speed-up (it must stay above 100x).
+*
+* -p closes the loop with the plant model (see plantModel.h) in place of the
+* inverter and BMS: it answers the 0xC0 commands the firmware writes.  With
+* no trace it is the only other node on the bus.  Timed inputs script the
+* driver, e.g. 30 minutes flat out after the ready-to-drive sequence (HVIL
+* and LV battery up, RTD button with the brake on at 5 s, half throttle at
+* 7 s) takes well under a second:
+*
+*   replay/replay -p -t 1800 -i 18=1 -i 8=13500 -i 0=300 -i 1=2824 -i 2=550
+*       -i 13=1@5 -i 2=1000@5 -i 13=0@6 -i 2=550@6 -i 0=800@7 -i 1=3300@7
+*
+* Local inputs (pedals, switches, wheel speeds) hold fixed values - set them
+* with -i.  Each run starts with an erased EEPROM, i.e. default parameters
+* and no pedal calibration.
+****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "trcReader.h"
+#include "replayIO.h"
+#include "plantModel.h"
+
+#define REPLAY_TAIL_US 1000000      //Keep running after the last frame so timeouts show up
+#define MCM_COMMAND_ID 0xC0
+#define INPUT_CHANGES_MAX 64
+
+void VCU_main(void);                //main.c, renamed by the Makefile
+
+static FILE* output = NULL;
+static bool recordCan1 = FALSE;
+static ubyte4 outputCount = 0;
+static ubyte4 mcmCommandCount = 0;
+static ubyte4 telemetryCount = 0;   //0x500-0x5FF
+static TraceTime lastFrame_us = 0;
+static TraceTime stopAt_us = 0;     //0 = run to the end of the trace
+static clock_t wallStart;
+static const Trace* trace = NULL;   //NULL for a plant model only run
+static PlantModel* plant = NULL;
+
+//-i pin=value@seconds: applied once the run gets that far (in the order given)
+typedef struct _InputChange
+{
+    TraceTime at_us;        //From the start of the run
+    ubyte1 pin;
+    ubyte4 value;
+} InputChange;
+static InputChange inputChanges[INPUT_CHANGES_MAX];
+static ubyte1 inputChangeCount = 0;
+static ubyte1 nextInputChange = 0;
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "usage: replay [options] trace.trc\n"
+        "       replay -p -t seconds [options]\n"
+        "  -o file       write the frames the VCU sends on CAN0 as a PCAN 1.1 trace\n"
+        "  -1            also write the CAN1 frames\n"
+        "  -t seconds    stop after this much trace time\n"
+        "  -p            answer the VCU's commands with the plant model (inverter, BMS, car)\n"
+        "  -i pin=value  hold an input: analog mV, digital 0/1, or timer Hz\n"
+        "                (pin numbers are in replay/io/IO_Driver.h)\n"
+        "  -i pin=value@seconds\n"
+        "                change it to value that far into the run (give these in time order)\n"
+        "  -s            echo VCU serial output to stderr\n");
+    exit(2);
+}
+
+static void writeOutputHeader(const char* inputPath)
+{
+    fprintf(output,
+        ";$FILEVERSION=1.1\n"
+        ";\n"
+        ";   Replay of %s\n"
+        ";   Frames sent by the VCU firmware, on the input trace's time base\n"
+        ";\n"
+        ";   Message Number\n"
+        ";   |         Time Offset (ms)\n"
+        ";   |         |        Type\n"
+        ";   |         |        |        ID (hex)\n"
+        ";   |         |        |        |     Data Length\n"
+        ";   |         |        |        |     |   Data Bytes (hex) ...\n"
+        ";   |         |        |        |     |   |\n"
+        ";---+--   ----+----  --+--  ----+---  +  -+ -- -- -- -- -- -- --\n", inputPath);
+}
+
+static void onFrameWritten(TraceTime traceTime_us, ubyte1 channel, const IO_CAN_DATA_FRAME* frame)
+{
+    if (plant != NULL) { PlantModel_onFrameWritten(plant, channel, frame); }
+    if (channel != IO_CAN_CHANNEL_0 && !recordCan1) { return; }
+
+    if (channel == IO_CAN_CHANNEL_0 && frame->id_format == IO_CAN_STD_FRAME)
+    {
+        if (frame->id == MCM_COMMAND_ID) { mcmCommandCount++; }
+        if (frame->id >= 0x500 && frame->id <= 0x5FF) { telemetryCount++; }
+    }
+    outputCount++;
+
+    if (output == NULL) { return; }
+    fprintf(output, "%6lu)%12.1f  Tx     %8.*lX  %u ", (unsigned long)outputCount, traceTime_us / 1000.0
+        , (frame->id_format == IO_CAN_EXT_FRAME) ? 8 : 4, (unsigned long)frame->id, frame->length);
+    for (ubyte1 i = 0; i < frame->length && i < 8; i++)
+    {
+        fprintf(output, " %02X", frame->data[i]);
+    }
+    fputc('\n', output);
+}
+
+static void printSummary(void)
+{
+    const ReplayIOStats* stats = ReplayIO_getStats();
+    double simulated_s = (ReplayIO_getTraceTime() - ((trace != NULL) ? trace->frames[0].time_us : 0)) / 1e6;
+    double wall_s = (double)(clock() - wallStart) / CLOCKS_PER_SEC;
+
+    if (trace != NULL)
+    {
+        printf("Trace:     %lu frames (file version %s, %lu other lines skipped)\n"
+            , (unsigned long)trace->count, trace->version, (unsigned long)trace->skippedLines);
+    }
+    printf("Received:  %lu accepted, %lu filtered out, %lu lost to full FIFOs (%lu from the plant model)\n"
+        , (unsigned long)stats->delivered, (unsigned long)stats->filtered, (unsigned long)stats->overflowed
+        , (unsigned long)stats->injected);
+    printf("Sent:      %lu frames (%lu MCM commands, %lu on 0x500-0x5FF)%s\n"
+        , (unsigned long)stats->written, (unsigned long)mcmCommandCount, (unsigned long)telemetryCount
+        , recordCan1 ? "" : " - CAN0 counts only");
+    printf("Simulated: %.1f s in %lu cycles, %.2f s wall clock (%.0fx real time)\n"
+        , simulated_s, (unsigned long)stats->cycles, wall_s, (wall_s > 0) ? simulated_s / wall_s : 0.0);
+    if (plant != NULL)
+    {
+        const PlantState* state = PlantModel_getState(plant);
+        printf("Plant:     %.2f km, %.1f km/h now, %.0f Wh used, SOC %.1f%%, motor %.1f C, pack %.1f C %.1f V\n"
+            , state->distance_m / 1000, state->speed_mps * 3.6, state->energy_Wh, state->soc * 100
+            , state->motorTemp_C, state->packTemp_C, state->packVoltage_V);
+    }
+}
+
+//Runs after every firmware cycle; ends the process once the replay is over
+static void onCycleEnd(void)
+{
+    TraceTime now_us = ReplayIO_getTraceTime();
+
+    while (nextInputChange < inputChangeCount
+        && now_us - ((trace != NULL) ? trace->frames[0].time_us : 0) >= inputChanges[nextInputChange].at_us)
+    {
+        ReplayIO_setInput(inputChanges[nextInputChange].pin, inputChanges[nextInputChange].value);
+        nextInputChange++;
+    }
+
+    //Its frames are read in the next cycle, like a real node answering this cycle's 0xC0
+    if (plant != NULL) { PlantModel_update(plant, now_us); }
+
+    if ((stopAt_us != 0 && now_us >= stopAt_us)
+        || (trace != NULL && ReplayIO_isTraceDone() && now_us >= lastFrame_us + REPLAY_TAIL_US))
+    {
+        if (output != NULL) { fclose(output); }
+        printSummary();
+        exit(0);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* inputPath = NULL;
+    const char* outputPath = NULL;
+    double stopAfter_s = 0;
+
+    for (int arg = 1; arg < argc; arg++)
+    {
+        if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc) { outputPath = argv[++arg]; }
+        else if (strcmp(argv[arg], "-1") == 0) { recordCan1 = TRUE; }
+        else if (strcmp(argv[arg], "-t") == 0 && arg + 1 < argc) { stopAfter_s = atof(argv[++arg]); }
+        else if (strcmp(argv[arg], "-s") == 0) { ReplayIO_setSerialEcho(TRUE); }
+        else if (strcmp(argv[arg], "-p") == 0) { plant = PlantModel_new(); }
+        else if (strcmp(argv[arg], "-i") == 0 && arg + 1 < argc)
+        {
+            unsigned int pin;
+            unsigned long value;
+            double at_s;
+            int fields = sscanf(argv[++arg], "%u=%lu@%lf", &pin, &value, &at_s);
+            if (fields < 2 || pin >= IO_PIN_COUNT) { usage(); }
+            if (fields == 2)
+            {
+                ReplayIO_setInput((ubyte1)pin, (ubyte4)value);
+            }
+            else
+            {
+                if (inputChangeCount == INPUT_CHANGES_MAX || at_s < 0) { usage(); }
+                inputChanges[inputChangeCount].at_us = (TraceTime)(at_s * 1e6);
+                inputChanges[inputChangeCount].pin = (ubyte1)pin;
+                inputChanges[inputChangeCount].value = (ubyte4)value;
+                inputChangeCount++;
+            }
+        }
+        else if (argv[arg][0] != '-' && inputPath == NULL) { inputPath = argv[arg]; }
+        else { usage(); }
+    }
+    //Without a trace nothing else ends the run
+    if (inputPath == NULL && (plant == NULL || stopAfter_s <= 0)) { usage(); }
+
+    if (inputPath != NULL)
+    {
+        Trace* loaded = Trace_load(inputPath);
+        if (loaded == NULL) { return 1; }
+        if (loaded->count == 0)
+        {
+            fprintf(stderr, "%s has no CAN data frames\n", inputPath);
+            return 1;
+        }
+        trace = loaded;
+        lastFrame_us = trace->frames[trace->count - 1].time_us;
+        ReplayIO_setTrace(trace);
+    }
+    if (stopAfter_s > 0) { stopAt_us = ((trace != NULL) ? trace->frames[0].time_us : 0) + (TraceTime)(stopAfter_s * 1e6); }
+
+    if (outputPath != NULL)
+    {
+        output = fopen(outputPath, "w");
+        if (output == NULL)
+        {
+            fprintf(stderr, "Can't write %s\n", outputPath);
+            return 1;
+        }
+        writeOutputHeader((inputPath != NULL) ? inputPath : "the plant model");
+    }
+
+    ReplayIO_setFrameHandler(onFrameWritten);
+    ReplayIO_setCycleHandler(onCycleEnd);
+
+    wallStart = clock();
+    VCU_main();  //Never returns - onCycleEnd exits
+    return 1;
+}
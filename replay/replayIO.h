@@ -0,0 +1,77 @@
+#ifndef _REPLAYIO_H
+#define _REPLAYIO_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+#include "trcReader.h"
+
+/*****************************************************************************
+* Replay side of the IO stubs (host only)
+******************************************************************************
+* ioStubs.c implements the IO_* functions the firmware calls on a virtual
+* clock, and this is how the replay driver sets them up.
+*
+* Virtual time:
+* - While the firmware works, every IO_RTC_GetTimeUS call costs 1 us.
+* - Between IO_Driver_TaskEnd and the next IO_Driver_TaskBegin it is only
+*   waiting, so each RTC read jumps straight to the next trace frame (at
+*   most IDLE_STEP_US).  CanManager_poll in the wait loop still sees every
+*   frame arrive, and a 33 ms wait takes a few dozen iterations.
+*
+* Trace frames:
+* - Trace time 0 is the moment the first receive FIFO is configured, which
+*   is when the real hardware starts listening.
+* - On every IO_CAN_ReadFIFO, all frames that are due by then go into the
+*   first configured FIFO on their channel whose acceptance filter matches.
+*   Trace bus 1 is CAN0 and bus 2 is CAN1.
+* - A full FIFO drops the frame and reports IO_E_CAN_FIFO_FULL on its next
+*   read, as the hardware does.  Frames no FIFO accepts are dropped, as the
+*   acceptance filters do.
+*
+* Injected frames (ReplayIO_injectFrame - e.g. from the plant model) go
+* through the same acceptance filters and FIFOs, arriving at the current
+* virtual time.
+*
+* Inputs hold whatever ReplayIO_setInput last gave them (0 by default).
+* Every frame the firmware writes is passed to the output callback.
+****************************************************************************/
+typedef void (*ReplayIO_FrameHandler)(TraceTime traceTime_us, ubyte1 channel, const IO_CAN_DATA_FRAME* frame);
+typedef void (*ReplayIO_CycleHandler)(void);
+
+typedef struct _ReplayIOStats
+{
+    ubyte4 delivered;       //Received frames a receive FIFO accepted
+    ubyte4 filtered;        //Received frames no receive FIFO accepts (or on a bus the VCU doesn't have)
+    ubyte4 overflowed;      //Received frames lost to a full receive FIFO
+    ubyte4 injected;        //Frames given to ReplayIO_injectFrame (also counted in the three above)
+    ubyte4 written;         //Frames the firmware wrote (either channel)
+    ubyte4 cycles;          //IO_Driver_TaskEnd calls, boot cycles included
+} ReplayIOStats;
+
+void ReplayIO_setTrace(const Trace* trace);
+
+//Analog pins read value (mV), digital pins read value != 0, timer inputs read value (Hz)
+void ReplayIO_setInput(ubyte1 pin, ubyte4 value);
+
+void ReplayIO_setSerialEcho(bool echo);
+void ReplayIO_setFrameHandler(ReplayIO_FrameHandler onWrite);
+
+//Called at the end of every IO_Driver_TaskEnd - the replay driver decides there when to stop
+void ReplayIO_setCycleHandler(ReplayIO_CycleHandler onCycleEnd);
+
+//Virtual time on the trace's own time base (the first frame's time until the first receive FIFO is configured)
+TraceTime ReplayIO_getTraceTime(void);
+
+//TRUE once every trace frame has been delivered or dropped
+bool ReplayIO_isTraceDone(void);
+
+const ReplayIOStats* ReplayIO_getStats(void);
+
+//Receives a frame on channel now, as if another node had just sent it
+void ReplayIO_injectFrame(ubyte1 channel, const IO_CAN_DATA_FRAME* frame);
+
+//Moves the virtual clock on without running anything (for drivers that call the
+//firmware directly, like bench.c, instead of running main)
+void ReplayIO_advanceTime(TraceTime step_us);
+
+#endif // _REPLAYIO_H
@@ -0,0 +1,304 @@
+/*****************************************************************************
+* Static stack usage report (host only)
+******************************************************************************
+* Reads the .ci call graph files gcc writes with -fcallgraph-info=su (make
+* stack builds the firmware that way), walks the static call graph from
+* VCU_main and prints the deepest path with each function's frame:
+*
+*   make -C replay stack
+*
+* It exits 1 if a frame is over the threshold (-f, bytes), if a frame has
+* unbounded dynamic size (alloca or a VLA - the build also has -Wvla), or
+* if the graph has recursion.  The root's own frame has a limit of its own
+* (-m): main keeps a pointer to every object in it for the whole run.
+*
+* gcc only records an indirect call as a placeholder.  The firmware's only
+* function pointers are tables of static functions (the SafetyChecker rule
+* table), so an indirect call is taken to reach any function of the same
+* file that nothing calls directly.  Functions with no .ci entry (the TTTech
+* driver, libc) count as 0 bytes and are listed.
+*
+* The numbers are for the x86-64 host build, where pointers are twice the
+* XC2000's, so they overstate the target.  The deepest path and the frames
+* that stand out are what carry over.
+****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FUNCTIONS_MAX 2048
+#define CALLS_MAX 8192
+#define TEXT_MAX 160
+#define FRAME_LIMIT_DEFAULT 256
+
+typedef struct _Function
+{
+    char title[TEXT_MAX];       //gcc's node title: "file:name" for static functions, else "name"
+    char name[TEXT_MAX];
+    char location[TEXT_MAX];    //file:line:column
+    char file[TEXT_MAX];        //.ci file that defined it
+    long frame;                 //-1 = no definition seen
+    int dynamic;                //Frame size is not fixed (1 = bounded, 2 = unbounded)
+    int calledDirectly;
+    int indirectCalls;
+    int firstCall;              //Index into calls[], -1 if none
+    //Filled in by the walk
+    int state;                  //0 = not visited, 1 = on the path, 2 = done
+    long worst;                 //Deepest stack from here down, own frame included
+    int worstCallee;            //-1 = leaf
+} Function;
+
+typedef struct _Call
+{
+    int callee;
+    int next;
+} Call;
+
+static Function functions[FUNCTIONS_MAX];
+static int functionCount = 0;
+static Call calls[CALLS_MAX];
+static int callCount = 0;
+static int recursion = 0;
+
+static int findFunction(const char* title)
+{
+    for (int f = 0; f < functionCount; f++)
+    {
+        if (strcmp(functions[f].title, title) == 0) { return f; }
+    }
+    return -1;
+}
+
+static int addFunction(const char* title)
+{
+    int f = findFunction(title);
+    if (f >= 0) { return f; }
+    if (functionCount == FUNCTIONS_MAX)
+    {
+        fprintf(stderr, "More than %d functions\n", FUNCTIONS_MAX);
+        exit(2);
+    }
+    f = functionCount++;
+    memset(&functions[f], 0, sizeof(Function));
+    snprintf(functions[f].title, TEXT_MAX, "%s", title);
+    snprintf(functions[f].name, TEXT_MAX, "%s", title);
+    functions[f].frame = -1;
+    functions[f].firstCall = -1;
+    functions[f].worstCallee = -1;
+    return f;
+}
+
+static void addCall(int caller, int callee)
+{
+    if (callCount == CALLS_MAX)
+    {
+        fprintf(stderr, "More than %d calls\n", CALLS_MAX);
+        exit(2);
+    }
+    calls[callCount].callee = callee;
+    calls[callCount].next = functions[caller].firstCall;
+    functions[caller].firstCall = callCount++;
+}
+
+//Copies the quoted value after key ("title: ") into value.  0 if key isn't on the line.
+static int quotedField(const char* line, const char* key, char* value)
+{
+    const char* start = strstr(line, key);
+    const char* end;
+
+    if (start == NULL) { return 0; }
+    start += strlen(key);
+    if (*start != '"') { return 0; }
+    start++;
+    end = strchr(start, '"');
+    if (end == NULL) { return 0; }
+    snprintf(value, TEXT_MAX, "%.*s", (int)(end - start), start);
+    return 1;
+}
+
+//label: "name\nfile:line:col\nN bytes (static)\n..." - only definitions have the byte count
+static void parseNode(const char* line, const char* ciFile)
+{
+    char title[TEXT_MAX];
+    char label[TEXT_MAX];
+    char* part;
+    Function* function;
+    long bytes;
+    char qualifier[32];
+
+    if (!quotedField(line, "title: ", title) || !quotedField(line, "label: ", label)) { return; }
+    function = &functions[addFunction(title)];
+
+    part = strstr(label, "\\n");
+    if (part == NULL) { return; }
+    snprintf(function->name, TEXT_MAX, "%.*s", (int)(part - label), label);
+    part += 2;
+
+    char* bytesPart = strstr(part, "\\n");
+    if (bytesPart == NULL) { return; }
+    snprintf(function->location, TEXT_MAX, "%.*s", (int)(bytesPart - part), part);
+    bytesPart += 2;
+
+    if (sscanf(bytesPart, "%ld bytes (%31[^)])", &bytes, qualifier) == 2)
+    {
+        function->frame = bytes;
+        function->dynamic = (strstr(qualifier, "dynamic") == NULL) ? 0 : (strstr(qualifier, "bounded") != NULL) ? 1 : 2;
+        snprintf(function->file, TEXT_MAX, "%s", ciFile);
+    }
+}
+
+static void parseEdge(const char* line)
+{
+    char source[TEXT_MAX];
+    char target[TEXT_MAX];
+    int caller;
+
+    if (!quotedField(line, "sourcename: ", source) || !quotedField(line, "targetname: ", target)) { return; }
+    caller = addFunction(source);
+    if (strcmp(target, "__indirect_call") == 0)
+    {
+        functions[caller].indirectCalls++;
+        return;
+    }
+    int callee = addFunction(target);
+    functions[callee].calledDirectly = 1;
+    addCall(caller, callee);
+}
+
+static void loadFile(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    char line[1024];
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "Can't open %s\n", path);
+        exit(2);
+    }
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strncmp(line, "node:", 5) == 0) { parseNode(line, path); }
+        else if (strncmp(line, "edge:", 5) == 0) { parseEdge(line); }
+    }
+    fclose(file);
+}
+
+//Indirect calls reach the functions of the caller's own file that are never called directly
+static void resolveIndirectCalls(void)
+{
+    for (int caller = 0; caller < functionCount; caller++)
+    {
+        if (functions[caller].indirectCalls == 0) { continue; }
+        for (int callee = 0; callee < functionCount; callee++)
+        {
+            if (callee != caller && functions[callee].frame >= 0 && !functions[callee].calledDirectly
+                && strcmp(functions[callee].file, functions[caller].file) == 0)
+            {
+                addCall(caller, callee);
+            }
+        }
+    }
+}
+
+static long walk(int f)
+{
+    Function* function = &functions[f];
+
+    if (function->state == 2) { return function->worst; }
+    if (function->state == 1)
+    {
+        printf("RECURSION through %s\n", function->name);
+        recursion = 1;
+        return 0;
+    }
+
+    function->state = 1;
+    function->worst = 0;
+    for (int c = function->firstCall; c >= 0; c = calls[c].next)
+    {
+        long below = walk(calls[c].callee);
+        if (below > function->worst || function->worstCallee < 0)
+        {
+            function->worst = below;
+            function->worstCallee = calls[c].callee;
+        }
+    }
+    function->worst += (function->frame > 0) ? function->frame : 0;
+    function->state = 2;
+    return function->worst;
+}
+
+//A defined function by its plain name (static functions' titles also carry the file)
+static int findRoot(const char* name)
+{
+    for (int f = 0; f < functionCount; f++)
+    {
+        if (strcmp(functions[f].name, name) == 0 && functions[f].frame >= 0) { return f; }
+    }
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* rootName = "VCU_main";
+    long frameLimit = FRAME_LIMIT_DEFAULT;
+    long rootLimit = -1;        //-1 = same as frameLimit
+    int failed = 0;
+    int arg = 1;
+
+    for (; arg < argc && argv[arg][0] == '-'; arg++)
+    {
+        if (strcmp(argv[arg], "-f") == 0 && arg + 1 < argc) { frameLimit = strtol(argv[++arg], NULL, 10); }
+        else if (strcmp(argv[arg], "-m") == 0 && arg + 1 < argc) { rootLimit = strtol(argv[++arg], NULL, 10); }
+        else if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc) { rootName = argv[++arg]; }
+        else { arg = argc; }
+    }
+    if (arg >= argc)
+    {
+        fprintf(stderr, "usage: stackReport [-f frameLimitBytes] [-m rootFrameLimitBytes] [-r rootFunction] file.ci ...\n");
+        return 2;
+    }
+    for (; arg < argc; arg++) { loadFile(argv[arg]); }
+    resolveIndirectCalls();
+
+    int root = findRoot(rootName);
+    if (root < 0)
+    {
+        fprintf(stderr, "%s is not in the call graph\n", rootName);
+        return 2;
+    }
+
+    printf("Worst-case stack from %s: %ld bytes\n", rootName, walk(root));
+    for (int f = root; f >= 0; f = functions[f].worstCallee)
+    {
+        printf("  %6ld  %-40s %s\n", (functions[f].frame > 0) ? functions[f].frame : 0, functions[f].name
+            , (functions[f].frame >= 0) ? functions[f].location : "(no stack info)");
+    }
+
+    if (rootLimit < 0) { rootLimit = frameLimit; }
+    printf("\nFrames over %ld bytes (%s: %ld), or of dynamic size, reachable from %s:\n"
+        , frameLimit, rootName, rootLimit, rootName);
+    int flagged = 0;
+    for (int f = 0; f < functionCount; f++)
+    {
+        if (functions[f].state != 2 || functions[f].frame < 0) { continue; }
+        if (functions[f].frame > ((f == root) ? rootLimit : frameLimit) || functions[f].dynamic == 2)
+        {
+            printf("  %6ld  %-40s %s%s\n", functions[f].frame, functions[f].name, functions[f].location
+                , (functions[f].dynamic == 2) ? "  UNBOUNDED (VLA/alloca)" : "");
+            flagged = 1;
+        }
+    }
+    if (!flagged) { printf("  none\n"); }
+
+    printf("\nCalled but not analysed (counted as 0 bytes):\n ");
+    for (int f = 0; f < functionCount; f++)
+    {
+        if (functions[f].state == 2 && functions[f].frame < 0) { printf(" %s", functions[f].name); }
+    }
+    printf("\n");
+
+    failed = flagged || recursion;
+    if (failed) { printf("\nFAILED\n"); }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+#include "trcReader.h"
+
+#define TRC_LINE_MAX 512
+#define TRC_TOKENS_MAX 80
+#define TRC_COLUMNS_MAX 16
+
+/*****************************************************************************
+* Line layouts
+******************************************************************************
+* 1.0   1)      1841  0001  8  00 11 22 33 44 55 66 77
+* 1.1   1)    1841.0  Rx        0001  8  00 11 22 33 44 55 66 77
+* 1.2   1)    1841.0 1  Rx        0001  8  00 11 22 33 44 55 66 77
+* 1.3   1)    1841.0 1  Rx        0001 -  8  00 11 22 33 44 55 66 77
+* 2.0   1    1841.000 DT     0001 Rx 8  00 11 22 33 44 55 66 77
+* 2.1   1    1841.000 DT 1      0001 Rx -  8  00 11 22 33 44 55 66 77
+*
+* 2.x lines are described by the $COLUMNS header (N number, O offset ms,
+* T type, B bus, I id, d direction, R reserved, L/l length, D data).  2.0
+* files have no header and use N,O,T,I,d,l,D.  In 1.x, anything but Rx/Tx in
+* the type column (Warng, Error, RTR data) is not a data frame.
+****************************************************************************/
+static const char defaultColumns20[] = "N,O,T,I,d,l,D";
+
+//Splits line in place on whitespace.  Returns the token count.
+static ubyte1 splitTokens(char* line, char* tokens[], ubyte1 maxTokens)
+{
+    ubyte1 count = 0;
+    char* token = strtok(line, " \t\r\n");
+
+    while (token != NULL && count < maxTokens)
+    {
+        tokens[count++] = token;
+        token = strtok(NULL, " \t\r\n");
+    }
+    return count;
+}
+
+static bool parseHex(const char* text, ubyte4 maxValue, ubyte4* value)
+{
+    char* end;
+    unsigned long parsed = strtoul(text, &end, 16);
+
+    if (end == text || *end != '\0' || parsed > maxValue) { return FALSE; }
+    *value = (ubyte4)parsed;
+    return TRUE;
+}
+
+static bool parseTime(const char* text, TraceTime* time_us)
+{
+    char* end;
+    double ms = strtod(text, &end);
+
+    if (end == text || *end != '\0' || ms < 0) { return FALSE; }
+    *time_us = (TraceTime)(ms * 1000.0 + 0.5);
+    return TRUE;
+}
+
+//Fills frame from the id, length and data tokens shared by every version
+static bool parseFrame(const char* idText, const char* lengthText, char* dataTokens[], ubyte1 dataCount, IO_CAN_DATA_FRAME* frame)
+{
+    ubyte4 id;
+    ubyte4 length;
+    ubyte4 byte;
+
+    if (!parseHex(idText, 0x1FFFFFFF, &id) || !parseHex(lengthText, 8, &length) || dataCount < length)
+    {
+        return FALSE;
+    }
+
+    //Standard IDs are written with 4 digits, extended ones with 8
+    frame->id = id;
+    frame->id_format = (strlen(idText) > 4 || id > 0x7FF) ? IO_CAN_EXT_FRAME : IO_CAN_STD_FRAME;
+    frame->length = (ubyte1)length;
+    memset(frame->data, 0, sizeof(frame->data));
+    for (ubyte1 i = 0; i < length; i++)
+    {
+        if (!parseHex(dataTokens[i], 0xFF, &byte)) { return FALSE; }
+        frame->data[i] = (ubyte1)byte;
+    }
+    return TRUE;
+}
+
+static bool parseLine1x(char* tokens[], ubyte1 count, ubyte1 minor, TraceFrame* out)
+{
+    ubyte1 t = 0;
+
+    if (count < 4 || tokens[t][strlen(tokens[t]) - 1] != ')') { return FALSE; }
+    t++;
+    if (!parseTime(tokens[t++], &out->time_us)) { return FALSE; }
+
+    out->bus = 1;
+    if (minor >= 2)
+    {
+        ubyte4 bus;
+        if (t >= count || !parseHex(tokens[t++], 0xFF, &bus)) { return FALSE; }
+        out->bus = (ubyte1)bus;
+    }
+    if (minor >= 1)
+    {
+        if (t >= count || (strcmp(tokens[t], "Rx") != 0 && strcmp(tokens[t], "Tx") != 0)) { return FALSE; }
+        t++;
+    }
+    if (t + 1 >= count) { return FALSE; }
+    const char* idText = tokens[t++];
+    if (minor >= 3) { t++; }  //Reserved column
+    if (t >= count) { return FALSE; }
+    const char* lengthText = tokens[t++];
+
+    return parseFrame(idText, lengthText, &tokens[t], count - t, &out->frame);
+}
+
+static bool parseLine2x(char* tokens[], ubyte1 count, const char columns[], ubyte1 columnCount, TraceFrame* out)
+{
+    const char* idText = NULL;
+    const char* lengthText = NULL;
+    bool isData = FALSE;
+
+    out->bus = 1;
+    for (ubyte1 c = 0; c < columnCount; c++)
+    {
+        if (c >= count) { return FALSE; }
+        switch (columns[c])
+        {
+        case 'O':
+            if (!parseTime(tokens[c], &out->time_us)) { return FALSE; }
+            break;
+        case 'T':
+            isData = (strcmp(tokens[c], "DT") == 0);
+            break;
+        case 'B':
+            {
+            ubyte4 bus;
+            if (!parseHex(tokens[c], 0xFF, &bus)) { return FALSE; }
+            out->bus = (ubyte1)bus;
+            }
+            break;
+        case 'I':
+            idText = tokens[c];
+            break;
+        case 'L':
+        case 'l':
+            lengthText = tokens[c];
+            break;
+        case 'D':
+            //Always the last column - the rest of the line
+            return isData && idText != NULL && lengthText != NULL
+                && parseFrame(idText, lengthText, &tokens[c], count - c, &out->frame);
+        default:
+            break;
+        }
+    }
+    return FALSE;
+}
+
+//"N,O,T,B,I,d,R,L,D" -> "NOTBIdRLD"
+static ubyte1 parseColumns(const char* text, char columns[])
+{
+    ubyte1 count = 0;
+
+    for (; *text != '\0' && *text != '\r' && *text != '\n' && count < TRC_COLUMNS_MAX; text++)
+    {
+        if (*text != ',' && *text != ' ') { columns[count++] = *text; }
+    }
+    return count;
+}
+
+Trace* Trace_load(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    Trace* me;
+    ubyte4 capacity = 4096;
+    char line[TRC_LINE_MAX];
+    char* tokens[TRC_TOKENS_MAX];
+    char columns[TRC_COLUMNS_MAX];
+    ubyte1 columnCount = parseColumns(defaultColumns20, columns);
+    ubyte1 major = 1;
+    ubyte1 minor = 0;
+
+    if (file == NULL)
+    {
+        fprintf(stderr, "Can't open trace %s\n", path);
+        return NULL;
+    }
+
+    me = (Trace*)calloc(1, sizeof(Trace));
+    me->frames = (TraceFrame*)malloc(capacity * sizeof(TraceFrame));
+    strcpy(me->version, "1.0");
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (line[0] == ';')
+        {
+            if (strncmp(line, ";$FILEVERSION=", 14) == 0)
+            {
+                unsigned int fileMajor = 1, fileMinor = 0;
+                sscanf(line + 14, "%u.%u", &fileMajor, &fileMinor);
+                major = (ubyte1)fileMajor;
+                minor = (ubyte1)fileMinor;
+                snprintf(me->version, sizeof(me->version), "%u.%u", fileMajor, fileMinor);
+            }
+            else if (strncmp(line, ";$COLUMNS=", 10) == 0)
+            {
+                columnCount = parseColumns(line + 10, columns);
+            }
+            continue;
+        }
+
+        ubyte1 count = splitTokens(line, tokens, TRC_TOKENS_MAX);
+        if (count == 0) { continue; }
+
+        if (me->count == capacity)
+        {
+            capacity *= 2;
+            me->frames = (TraceFrame*)realloc(me->frames, capacity * sizeof(TraceFrame));
+        }
+
+        TraceFrame* frame = &me->frames[me->count];
+        bool parsed = (major >= 2)
+            ? parseLine2x(tokens, count, columns, columnCount, frame)
+            : parseLine1x(tokens, count, minor, frame);
+        if (parsed) { me->count++; }
+        else { me->skippedLines++; }
+    }
+
+    fclose(file);
+
+    //Multi-bus traces can be slightly out of order between buses.  Nearly sorted,
+    //so a stable insertion sort is cheap.
+    for (ubyte4 i = 1; i < me->count; i++)
+    {
+        TraceFrame frame = me->frames[i];
+        ubyte4 j = i;
+        while (j > 0 && me->frames[j - 1].time_us > frame.time_us)
+        {
+            me->frames[j] = me->frames[j - 1];
+            j--;
+        }
+        me->frames[j] = frame;
+    }
+
+    return me;
+}
+
+void Trace_free(Trace* me)
+{
+    if (me == NULL) { return; }
+    free(me->frames);
+    free(me);
+}
@@ -0,0 +1,41 @@
+#ifndef _TRCREADER_H
+#define _TRCREADER_H
+
+#include "IO_Driver.h"
+#include "IO_CAN.h"
+
+/*****************************************************************************
+* PCAN-Explorer / PCAN-View trace reader (host only)
+******************************************************************************
+* Loads a whole .trc file into memory.  Understands file versions 1.0 to 1.3
+* and 2.0/2.1 (including the $COLUMNS header of 2.x).  Only CAN data frames
+* are kept - remote frames, errors, status and event lines are skipped and
+* counted.  Both Rx and Tx lines are kept: Tx means the PC sent it, so the VCU
+* received it.
+*
+* Times are the trace's own offsets in microseconds (not shifted to start at
+* 0).  bus is the trace's 1-based bus number, or 1 if the file has none.
+****************************************************************************/
+typedef unsigned long long TraceTime;  //Microseconds
+
+typedef struct _TraceFrame
+{
+    TraceTime time_us;
+    ubyte1 bus;
+    IO_CAN_DATA_FRAME frame;
+} TraceFrame;
+
+typedef struct _Trace
+{
+    TraceFrame* frames;     //Sorted by time (stable, so same-time frames keep file order)
+    ubyte4 count;
+    ubyte4 skippedLines;    //Non-data lines, and lines that didn't parse
+    char version[8];        //As given by $FILEVERSION ("1.0" if there was none)
+} Trace;
+
+//Returns NULL (after printing why on stderr) if the file can't be read
+Trace* Trace_load(const char* path);
+
+void Trace_free(Trace* me);
+
+#endif // _TRCREADER_H
@@ -1,4 +1,3 @@
-#include <stdlib.h> //malloc
 //#include <math.h>
 #include "IO_Driver.h"
 #include "IO_RTC.h"
@@ -6,6 +5,8 @@
 #include "IO_CAN.h"
 
 #include "safety.h"
+#include "memoryArena.h"
+#include "cycleClock.h"
 #include "mathFunctions.h"
 
 #include "sensors.h"
@@ -20,53 +21,123 @@
 //----------------------------------------------------------------------------
 //Faults
 //last flag is 0x 8000 0000 (32 flags, 8 hex characters)
+//These are #defines (not const variables) so they can be used in the check table below
 //----------------------------------------------------------------------------
 //nibble 1
-static const ubyte4 F_tpsOutOfRange = 1;
-static const ubyte4 F_bpsOutOfRange = 2;
-static const ubyte4 F_tpsPowerFailure = 4;
-static const ubyte4 F_bpsPowerFailure = 8;
+#define F_tpsOutOfRange         0x1
+#define F_bpsOutOfRange         0x2
+#define F_tpsPowerFailure       0x4
+#define F_bpsPowerFailure       0x8
 //nibble 2
-static const ubyte4 F_tpsSignalFailure = 0x10;
-static const ubyte4 F_bpsSignalFailure = 0x20;
-static const ubyte4 F_tpsNotCalibrated = 0x40;
-static const ubyte4 F_bpsNotCalibrated = 0x80;
+#define F_tpsSignalFailure      0x10  //NOT USED - reported as N_tpsSignalFailure instead
+#define F_bpsSignalFailure      0x20
+#define F_tpsNotCalibrated      0x40
+#define F_bpsNotCalibrated      0x80
 
 //nibble 3
-static const ubyte4 F_tpsOutOfSync = 0x100;
-static const ubyte4 F_bpsOutOfSync = 0x200; //NOT USED
-static const ubyte4 F_tpsbpsImplausible = 0x400;
-//static const ubyte4 UNUSED = 0x800;
+#define F_tpsOutOfSync          0x100
+#define F_bpsOutOfSync          0x200 //NOT USED
+#define F_tpsbpsImplausible     0x400
+//#define UNUSED                0x800
 
 //nibble 4
-//static const ubyte4 F_ = 0x1000;
-//static const ubyte4 F_ = 0x2000;
-//static const ubyte4 F_ = 0x4000;
-//static const ubyte4 F_ = 0x8000;
+//#define F_                    0x1000
+//#define F_                    0x2000
+//#define F_                    0x4000
+//#define F_                    0x8000
 
 //nibble 5
-static const ubyte4 F_lvsBatteryVeryLow = 0x10000;
-//static const ubyte4 F_ = 0x20000;
-//static const ubyte4 F_ = 0x40000;
-//static const ubyte4 F_ = 0x80000;
+#define F_lvsBatteryVeryLow     0x10000
+#define F_bmsCanTimeout         0x20000  //BMS stopped talking - we can't see pack limits/temps
+//#define F_                    0x40000
+//#define F_                    0x80000
 
 //nibble 6
 //nibble 7
 //nibble 8
 //                             nibble: 87654321
-static const ubyte4 F_unusedFaults = 0xFFFEF800;
+static const ubyte4 F_unusedFaults = 0xFFFCF800;
 
 
 //Warnings -------------------------------------------
-static const ubyte2 W_lvsBatteryLow = 1;
-static const ubyte2 W_hvilOverrideEnabled = 0x40;  //This flag indicates HVIL bypass (MCM turn on)
-static const ubyte2 W_safetyBypassEnabled = 0x80;  //This flag controls the safety bypass
+#define W_lvsBatteryLow         0x1
+#define W_mcmCanTimeout         0x2   //Normal while MCM relay is off (HV down)
+#define W_hvilOverrideEnabled   0x40  //This flag indicates HVIL bypass (MCM turn on)
+#define W_safetyBypassEnabled   0x80  //This flag controls the safety bypass
 
 //Notices
-static const ubyte2 N_HVILTermSenseLost = 1;
+#define N_HVILTermSenseLost     0x1
+#define N_tpsSignalFailure      0x2   //Was a serial message only - too noisy to be a fault
 
-static const ubyte2 N_Over75kW_BMS = 0x10;
-static const ubyte2 N_Over75kW_MCM = 0x20;
+#define N_Over75kW_BMS          0x10
+#define N_Over75kW_MCM          0x20
+
+
+/*****************************************************************************
+* Safety check table
+******************************************************************************
+* Every fault/warning/notice is one row in SafetyChecks[].  SafetyChecker_update
+* walks the table once per cycle, so adding a check means adding a predicate
+* and a row - not another if/else block.
+*
+* isActive  - TRUE when the problem is present this cycle
+* recovered - (LATCH_UNTIL_RECOVERY only) TRUE when a latched flag may clear
+* setDelay_us   - isActive must stay TRUE this long before the flag is set
+* clearDelay_us - the clear condition must hold this long before the flag clears
+*                 (0 = act on the first cycle the condition is seen)
+*
+* Timing and the rules
+* The pedal checks EV2.3.5/EV2.3.10 ask to cut torque "immediately" (within
+* 100ms for out-of-range) use SAFETY_RULE_SET_DELAY_US.  It is shorter than the
+* 33ms main loop period, so the condition must be seen on two consecutive
+* samples, and the flag is set on the second.  The main loop never runs
+* short, only long.  The worst case from onset to the 0xC0 that carries the
+* cut is therefore
+*     one period (onset just after a sample, seen next cycle)
+*   + one period (the debounce)
+*   + the in-cycle time from the start of the cycle to canOutput_sendMCMCommand
+* With the profiler's cycle budget (20ms of work, see profiler.c) the period
+* stays 33ms, so the bound is 33 + 33 + 20 = 86ms.  If the profiler reports
+* "main loop cycle over budget", or the loop period changes, this bound no
+* longer holds and must be recalculated.
+****************************************************************************/
+#define SAFETY_RULE_SET_DELAY_US 30000  //Debounce for the rule-timed checks: exactly one cycle (< 33ms period)
+typedef enum { SEVERITY_FAULT, SEVERITY_WARNING, SEVERITY_NOTICE } Severity;
+
+typedef enum
+{
+      LATCH_NONE            //Flag clears once isActive has been FALSE for clearDelay_us
+    , LATCH_UNTIL_RECOVERY  //Flag clears once recovered() has been TRUE for clearDelay_us
+} LatchPolicy;
+
+//Everything a check might need to look at, gathered once per update
+typedef struct _SafetyInputs
+{
+    MotorController* mcm;
+    BatteryManagementSystem* bms;
+    const TorqueEncoder* tps;      //All four point into the published VehicleState
+    const BrakePressureSensor* bps;
+    const Sensor* HVILTermSense;
+    const Sensor* LVBattery;
+} SafetyInputs;
+
+typedef bool (*SafetyPredicate)(SafetyChecker* me, const SafetyInputs* in);
+
+typedef struct _SafetyCheck
+{
+    SafetyPredicate isActive;
+    SafetyPredicate recovered;
+    ubyte4 flag;
+    Severity severity;
+    ubyte4 setDelay_us;
+    ubyte4 clearDelay_us;
+    LatchPolicy latch;
+    const ubyte1* message;  //Sent over serial when the flag is set (NULL = none)
+} SafetyCheck;
+
+//Table is defined after the predicates, below.  Must match the number of rows
+//(checked at compile time after the table).
+#define SAFETY_CHECK_COUNT 19
 
 
 /*****************************************************************************
@@ -82,13 +153,40 @@ struct _SafetyChecker {
     ubyte4 faults;
     ubyte2 warnings;
     ubyte2 notices;
-    ubyte1 maxAmpsCharge;
-    ubyte1 maxAmpsDischarge;
+    ubyte2 maxAmpsCharge;
+    ubyte2 maxAmpsDischarge;
 
     bool tpsbpsImplausible;
 
+    ubyte1 staleCanNodes;  //CanNode bitfield from CanManager_checkTimeouts
+
+    //Debounce timers: when each check's flag started wanting to change state
+    bool transitionPending[SAFETY_CHECK_COUNT];
+    ubyte8 timestamp_transition[SAFETY_CHECK_COUNT];
+
+    //Fault history ring buffer (see SafetyChecker_recordEvent)
+    FaultEvent faultHistory[FAULT_HISTORY_SIZE];
+    ubyte1 faultHistoryNext;      //Slot the next event will be written to
+    ubyte2 faultEventCount;       //Total events since boot (saturates)
+    bool faultHistoryRequested;
+    ubyte1 faultHistoryPage;
+
+    //Freeze frame pool (see SafetyChecker_captureFreezeFrame)
+    FreezeFrame freezeFrames[FREEZE_FRAME_COUNT];
+    ubyte1 freezeFrameNext;
+    ubyte1 freezeFrameCount;      //Frames stored (max FREEZE_FRAME_COUNT)
+    bool freezeFrameRequested;
+    ubyte1 freezeFrameRequestAge;
+
+    //Uptime for event timestamps, from CycleClock_now at the last update
+    ubyte4 uptime_ms;
+
+    //How long the check table took to evaluate
+    ubyte4 evaluationTime_us;
+    ubyte4 evaluationTimeMax_us;
+
     bool bypass;
-	ubyte4 timestamp_bypassSafetyChecks;
+	ubyte8 timestamp_bypassSafetyChecks;
 	ubyte4 bypassSafetyChecksTimeout_us;
 };
 
@@ -97,22 +195,47 @@ struct _SafetyChecker {
 * RULE EV2.3.5:
 * If an implausibility occurs between the values of these two sensors the power to the motor(s) must be immediately shut down completely.
 * It is not necessary to completely deactivate the tractive system, the motor controller(s) shutting down the power to the motor(s) is sufficient.
+* "Immediately" here is one debounce cycle (SAFETY_RULE_SET_DELAY_US) - see the
+* timing note above the check table for the worst case.
 ****************************************************************************/
 SafetyChecker* SafetyChecker_new(SerialManager* sm, ubyte2 maxChargeAmps, ubyte2 maxDischargeAmps)
 {
-    SafetyChecker* me = (SafetyChecker*)malloc(sizeof(struct _SafetyChecker));
+    SafetyChecker* me = (SafetyChecker*)MemoryArena_alloc(sizeof(struct _SafetyChecker));
 
     me->serialMan = sm;
     me->faults = 0;
     me->warnings = 0;
+    me->notices = 0;
 
     me->tpsbpsImplausible = TRUE;
 
+    me->staleCanNodes = 0;
+
+    for (ubyte1 i = 0; i < SAFETY_CHECK_COUNT; i++)
+    {
+        me->transitionPending[i] = FALSE;
+        me->timestamp_transition[i] = CYCLECLOCK_NEVER;
+    }
+    me->evaluationTime_us = 0;
+    me->evaluationTimeMax_us = 0;
+
+    me->faultHistoryNext = 0;
+    me->faultEventCount = 0;
+    me->faultHistoryRequested = FALSE;
+    me->faultHistoryPage = 0;
+
+    me->freezeFrameNext = 0;
+    me->freezeFrameCount = 0;
+    me->freezeFrameRequested = FALSE;
+    me->freezeFrameRequestAge = 0;
+
+    me->uptime_ms = 0;
+
     me->maxAmpsCharge = maxChargeAmps;
     me->maxAmpsDischarge = maxDischargeAmps;
 
     me->bypass = FALSE;
-	me->timestamp_bypassSafetyChecks = 0;
+	me->timestamp_bypassSafetyChecks = CYCLECLOCK_NEVER;
 	me->bypassSafetyChecksTimeout_us = 500000; //If safety bypass command is not neceived in this time then safety is re-enabled
 	//Note: The safety bypass warning flag is the determining factor in bypassing the multiplier.
     return me;
@@ -126,315 +249,461 @@ void SafetyChecker_parseCanMessage(SafetyChecker* me, IO_CAN_DATA_FRAME* canMess
 		//If the safety bypass code (0xC4) is received on the VCU debug address (0x5FF) at byte 0 (data[0])
         if (canMessage->data[0] == 0xC4)
         {
-            IO_RTC_StartTime(&me->timestamp_bypassSafetyChecks);
+            me->timestamp_bypassSafetyChecks = CycleClock_now();
         }
 		break;
 	}
 }
 
-//Updates all values based on sensor readings, safety checks, etc
-void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, TorqueEncoder* tps, BrakePressureSensor* bps, Sensor* HVILTermSense, Sensor* LVBattery)
-{
-    ubyte1* message[50];  //For sprintf'ing variables to print in serial
-    //SerialManager_send(me->serialMan, "Entered SafetyChecker_update().\n");
-    /*****************************************************************************
-    * Faults
-    ****************************************************************************/
-	//===================================================================
-	// Get calibration status
-	//===================================================================
-    //me->faults = 0xFFFF; //Set ALL faults by default.  only clear if truly safe
-    me->faults &= ~F_unusedFaults;
-
-    //me->faults = 1;
-    if (tps->calibrated == FALSE) { me->faults |= F_tpsNotCalibrated; }
-    else { me->faults &= ~F_tpsNotCalibrated; }
+/*****************************************************************************
+* Check predicates
+****************************************************************************/
+//===================================================================
+// Calibration status
+//===================================================================
+static bool check_tpsNotCalibrated(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->tps->calibrated == FALSE;
+}
 
-    if (bps->calibrated == FALSE) { me->faults |= F_bpsNotCalibrated; }
-    else { me->faults &= ~F_bpsNotCalibrated; }
+static bool check_bpsNotCalibrated(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->bps->calibrated == FALSE;
+}
 
-	//===================================================================
-	// Check if VCU was able to get a TPS/BPS reading
-	//===================================================================
-	if (tps->tps0->ioErr_powerInit != IO_E_OK
-		|| tps->tps1->ioErr_powerInit != IO_E_OK
-		|| tps->tps0->ioErr_powerSet != IO_E_OK
-		|| tps->tps1->ioErr_powerSet != IO_E_OK)
-    {
-        me->faults |= F_tpsPowerFailure;
-    }
-    else
-    {
-        me->faults &= ~F_tpsPowerFailure;
-    }
+//===================================================================
+// Check if VCU was able to get a TPS/BPS reading
+//===================================================================
+static bool check_tpsPowerFailure(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->tps->tps0->ioErr_powerInit != IO_E_OK
+        || in->tps->tps1->ioErr_powerInit != IO_E_OK
+        || in->tps->tps0->ioErr_powerSet != IO_E_OK
+        || in->tps->tps1->ioErr_powerSet != IO_E_OK;
+}
 
-	if (   tps->tps0->ioErr_signalInit != IO_E_OK
-		|| tps->tps1->ioErr_signalInit != IO_E_OK
-		|| tps->tps0->ioErr_signalGet != IO_E_OK
-		|| tps->tps1->ioErr_signalGet != IO_E_OK)
-	{
-		//me->faults |= F_tpsSignalFailure;
-        SerialManager_send(me->serialMan, "TPS signal error\n");
-	}
-    else
-    {
-        me->faults &= ~F_tpsSignalFailure;
-    }
+static bool check_tpsSignalFailure(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->tps->tps0->ioErr_signalInit != IO_E_OK
+        || in->tps->tps1->ioErr_signalInit != IO_E_OK
+        || in->tps->tps0->ioErr_signalGet != IO_E_OK
+        || in->tps->tps1->ioErr_signalGet != IO_E_OK;
+}
 
-	if (bps->bps0->ioErr_powerInit != IO_E_OK
-		|| bps->bps0->ioErr_powerSet != IO_E_OK)
-	{
-		me->faults |= F_bpsPowerFailure;
-	}
-    else
-    {
-        me->faults &= ~F_bpsPowerFailure;
-    }
+static bool check_bpsPowerFailure(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->bps->bps0->ioErr_powerInit != IO_E_OK
+        || in->bps->bps0->ioErr_powerSet != IO_E_OK;
+}
 
-	if (bps->bps0->ioErr_signalInit != IO_E_OK
-		|| bps->bps0->ioErr_signalGet != IO_E_OK)
-	{
-		me->faults |= F_bpsSignalFailure;
-	}
-    else
-    {
-        me->faults &= ~F_bpsSignalFailure;
-    }
+static bool check_bpsSignalFailure(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->bps->bps0->ioErr_signalInit != IO_E_OK
+        || in->bps->bps0->ioErr_signalGet != IO_E_OK;
+}
 
-	//===================================================================
-	// Make sure raw sensor readings are within operating range
-	//===================================================================
-	//RULE: EV2.3.10 - signal outside of operating range is considered a failure
-	//  This refers to SPEC SHEET values, not calibration values
-	//Note: IC cars may continue to drive for up to 100ms until valid readings are restored, but EVs must immediately cut power
-	//Note: We need to decide how to report errors and how to perform actions when those errors occur.  For now, I'm calling an imaginary Err.Report function
-	
-	//-------------------------------------------------------------------
-	//Torque Encoder
-	//-------------------------------------------------------------------
-	if (tps->tps0->sensorValue < tps->tps0->specMin || tps->tps0->sensorValue > tps->tps0->specMax
-	||  tps->tps1->sensorValue < tps->tps1->specMin || tps->tps1->sensorValue > tps->tps1->specMax)
-	{
-		me->faults |= F_tpsOutOfRange;
-	}
-    else
-    {
-        me->faults &= ~F_tpsOutOfRange;
-    }
+//===================================================================
+// Make sure raw sensor readings are within operating range
+//===================================================================
+//RULE: EV2.3.10 - signal outside of operating range is considered a failure
+//  This refers to SPEC SHEET values, not calibration values
+//Note: IC cars may continue to drive for up to 100ms until valid readings are restored, but EVs must immediately cut power
+//  (one debounce cycle, SAFETY_RULE_SET_DELAY_US - worst case 86ms, see the timing note above the check table)
+static bool check_tpsOutOfRange(SafetyChecker* me, const SafetyInputs* in)
+{
+    const Sensor* tps0 = in->tps->tps0;
+    const Sensor* tps1 = in->tps->tps1;
+    return tps0->sensorValue < tps0->specMin || tps0->sensorValue > tps0->specMax
+        || tps1->sensorValue < tps1->specMin || tps1->sensorValue > tps1->specMax;
+}
 
-	//-------------------------------------------------------------------
-	//Brake Pressure Sensor
-	//-------------------------------------------------------------------
-	if (bps->bps0->sensorValue < bps->bps0->specMin || bps->bps0->sensorValue > bps->bps0->specMax)
-	{
-		me->faults |= F_bpsOutOfRange;
-	}
-    else
-    {
-        me->faults &= ~F_bpsOutOfRange;
-    }
+static bool check_bpsOutOfRange(SafetyChecker* me, const SafetyInputs* in)
+{
+    const Sensor* bps0 = in->bps->bps0;
+    return bps0->sensorValue < bps0->specMin || bps0->sensorValue > bps0->specMax;
+}
 
-	//===================================================================
-	// Make sure calibrated TPS readings are in sync with each other
-	//===================================================================
-	// EV2.3.5 If an implausibility occurs between the values of these two sensors
-	//  the power to the motor(s) must be immediately shut down completely. It is not necessary 
-	//  to completely deactivate the tractive system, the motor controller(s) shutting down the 
-	//  power to the motor(s) is sufficient.
-	// EV2.3.6 Implausibility is defined as a deviation of more than 10 % pedal travel between the sensors.
-	//-------------------------------------------------------------------
-	
-	//Check for implausibility (discrepancy > 10%)
-	//RULE: EV2.3.6 Implausibility is defined as a deviation of more than 10% pedal travel between the sensors.
+//===================================================================
+// Make sure calibrated TPS readings are in sync with each other
+//===================================================================
+// EV2.3.5 If an implausibility occurs between the values of these two sensors
+//  the power to the motor(s) must be immediately shut down completely. It is not necessary 
+//  to completely deactivate the tractive system, the motor controller(s) shutting down the 
+//  power to the motor(s) is sufficient.
+//  (Cut one debounce cycle after it is seen - SAFETY_RULE_SET_DELAY_US, see the check table timing note)
+// EV2.3.6 Implausibility is defined as a deviation of more than 10 % pedal travel between the sensors.
+//-------------------------------------------------------------------
+static bool check_tpsOutOfSync(SafetyChecker* me, const SafetyInputs* in)
+{
 	float4 tps0Percent;   //Pedal percent float (a decimal between 0 and 1
 	float4 tps1Percent;
 
-	TorqueEncoder_getIndividualSensorPercent(tps, 0, &tps0Percent); //borrow the pedal percent variable
-	TorqueEncoder_getIndividualSensorPercent(tps, 1, &tps1Percent);
+	TorqueEncoder_getIndividualSensorPercent(in->tps, 0, &tps0Percent);
+	TorqueEncoder_getIndividualSensorPercent(in->tps, 1, &tps1Percent);
 
-    //sprintf(message, "TPS0: %f\n", tps0Percent);
-    //SerialManager_send(me->serialMan, message);
-    //sprintf(message, "TPS1: %f\n", tps1Percent);
-    //SerialManager_send(me->serialMan, message);
+    //Note: Individual TPS readings don't go negative, otherwise this wouldn't work
+    return (tps1Percent - tps0Percent) > .1 || (tps1Percent - tps0Percent) < -.1;
+}
 
-	if ((tps1Percent - tps0Percent) > .1 || (tps1Percent - tps0Percent) < -.1)  //Note: Individual TPS readings don't go negative, otherwise this wouldn't work
-	{
+//===================================================================
+//Torque Encoder <-> Brake Pedal Plausibility Check
+//===================================================================
+// EV2.5 Torque Encoder / Brake Pedal Plausibility Check
+//  The power to the motors must be immediately shut down completely, if the mechanical brakes 
+//  are actuated and the torque encoder signals more than 25 % pedal travel at the same time.
+//  This must be demonstrated when the motor controllers are under load.
+// EV2.5.1 The motor power shut down must remain active until the torque encoder signals less than 5 % pedal travel,
+//  no matter whether the brakes are still actuated or not.
+// Set immediately (no debounce), latched until TPS < 5%.
+//-------------------------------------------------------------------
+static bool check_tpsbpsImplausible(SafetyChecker* me, const SafetyInputs* in)
+{
+    //If mechanical brakes actuated && tps > 25%
+    return in->bps->percent > .05 && in->tps->percent > .25;
+}
 
-		//Err.Report(Err.Codes.TPSDiscrepancy, "TPS discrepancy of over 10%", Motor.Stop);
-        SerialManager_send(me->serialMan, "TPS discrepancy of over 10%\n");
+static bool recovered_tpsbpsImplausible(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->tps->percent < .05;  //TPS is reduced to < 5%
+}
 
-        me->faults |= F_tpsOutOfSync;
-	}
-    else
-    {
-        me->faults &= ~F_tpsOutOfSync;
-    }
+//===================================================================
+// LVS Battery Check
+//===================================================================
+//  IO_ADC_UBAT: 0..40106  (0V..40.106V)
+//-------------------------------------------------------------------
+static bool check_lvsBatteryVeryLow(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->LVBattery->sensorValue <= 9200;  //12730 = 10% SOC but hard to tell under load. 9200 = empty
+}
 
-    //Only one BPS right now - this fault doesn't happen
-    me->faults &= ~F_bpsOutOfSync;
-
-
-	//===================================================================
-	//Torque Encoder <-> Brake Pedal Plausibility Check
-	//===================================================================
-	// EV2.5 Torque Encoder / Brake Pedal Plausibility Check
-	//  The power to the motors must be immediately shut down completely, if the mechanical brakes 
-	//  are actuated and the torque encoder signals more than 25 % pedal travel at the same time.
-	//  This must be demonstrated when the motor controllers are under load.
-	// EV2.5.1 The motor power shut down must remain active until the torque encoder signals less than 5 % pedal travel,
-	//  no matter whether the brakes are still actuated or not.
-	//-------------------------------------------------------------------
-	//Implausibility if..
-    //float4 twelve = 12.0;
-    //SerialManager_sprintf(me->serialMan, "The number twelve: %d\n", &twelve);
-    bool tpsHigh = FALSE;
-    bool bpsHigh = FALSE;
-    if (bps->percent > .05) 
-    {
-        bpsHigh = TRUE;
-    }
-    else
-    {
-        bpsHigh = FALSE;
-    }
+static bool check_lvsBatteryLow(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->LVBattery->sensorValue <= 12730;  //13100 = Recharge percentage, per Shorai
+}
 
-    if (tps->percent > .25) 
-    {
-        tpsHigh = TRUE;
-    }
-    else
-    {
-        tpsHigh = FALSE;
-    }
-    
-    
-    
-    //if (bps->percent > .05 && tps->percent > .25)
-    if (tpsHigh == TRUE && bpsHigh == TRUE)
-    {
-        //If mechanical brakes actuated && tps > 25%
-       
-            me->faults |= F_tpsbpsImplausible;
-            me->tpsbpsImplausible = TRUE;
-            SerialManager_send(me->serialMan, "TPS BPS implausiblity detected.\n");
-            //From here, assume that motor controller will check for implausibility before accepting commands
-       
-    }
-	//Clear implausibility if...
-	//if ((me->faults & F_tpsbpsImplausible) > 0)
-	//{
-		if (tps->percent < .10) //TPS is reduced to < 5%
-		{
-            //me->tpsbpsImplausible = FALSE;
-            //SerialManager_send(me->serialMan, "TPS below .05.  No implausibility.\n");
-			me->faults &= ~(F_tpsbpsImplausible);  //turn off the implausibility flag
-		}
-	//}
+//===================================================================
+// CAN timeouts
+//===================================================================
+// Required messages from the BMS/MCM have not been received within
+// their max period (see CanManager_checkTimeouts).  Without the BMS
+// we have no pack temps or current limits, so that is a fault.  The
+// MCM is unpowered whenever HV is down, so that is only a warning.
+//-------------------------------------------------------------------
+static bool check_bmsCanTimeout(SafetyChecker* me, const SafetyInputs* in)
+{
+    return (me->staleCanNodes & CanNode_BMS) > 0;
+}
+
+static bool check_mcmCanTimeout(SafetyChecker* me, const SafetyInputs* in)
+{
+    return (me->staleCanNodes & CanNode_MCM) > 0;
+}
+
+//===================================================================
+// Safety checker bypass
+//===================================================================
+// The safety checker should only be bypassed by a CAN message sent by
+// the PCAN Explorer dashboard.  This is only used during debugging.
+// In case CAN communication is lost, the bypass is disabled after some time
+//-------------------------------------------------------------------
+static bool check_safetyBypassEnabled(SafetyChecker* me, const SafetyInputs* in)
+{
+    return CycleClock_since(me->timestamp_bypassSafetyChecks) < me->bypassSafetyChecksTimeout_us;
+}
+
+static bool check_hvilOverrideEnabled(SafetyChecker* me, const SafetyInputs* in)
+{
+    return MCM_getHvilOverrideStatus(in->mcm) == TRUE;
+}
 
-        SerialManager_send(me->serialMan, "\n");
+//===================================================================
+// HVIL Term Sense Check
+//===================================================================
+// If HVIL term sense goes low (because HV went down), motor torque
+// command should be set to zero before turning off the controller
+//-------------------------------------------------------------------
+static bool check_HVILTermSenseLost(SafetyChecker* me, const SafetyInputs* in)
+{
+    return in->HVILTermSense->sensorValue == FALSE;
+}
 
+static bool check_over75kW_BMS(SafetyChecker* me, const SafetyInputs* in)
+{
+    return BMS_getPower(in->bms) > 75000;
+}
 
+static bool check_over75kW_MCM(SafetyChecker* me, const SafetyInputs* in)
+{
+    return MCM_getPower(in->mcm) > 75000;
+}
 
+//----------------------------------------------------------------------------
+// The table
+//----------------------------------------------------------------------------
+static const SafetyCheck SafetyChecks[] =
+{
+    //isActive                     recovered                    flag                    severity          set us                   clear us  latch                 message
+    //Faults
+      { check_tpsNotCalibrated,    NULL,                        F_tpsNotCalibrated,     SEVERITY_FAULT,   0,                        0,        LATCH_NONE,           NULL }
+    , { check_bpsNotCalibrated,    NULL,                        F_bpsNotCalibrated,     SEVERITY_FAULT,   0,                        0,        LATCH_NONE,           NULL }
+    , { check_tpsPowerFailure,     NULL,                        F_tpsPowerFailure,      SEVERITY_FAULT,   0,                        0,        LATCH_NONE,           NULL }
+    , { check_bpsPowerFailure,     NULL,                        F_bpsPowerFailure,      SEVERITY_FAULT,   0,                        0,        LATCH_NONE,           NULL }
+    , { check_bpsSignalFailure,    NULL,                        F_bpsSignalFailure,     SEVERITY_FAULT,   SAFETY_RULE_SET_DELAY_US, 100000,   LATCH_NONE,           NULL }
+    , { check_tpsOutOfRange,       NULL,                        F_tpsOutOfRange,        SEVERITY_FAULT,   SAFETY_RULE_SET_DELAY_US, 100000,   LATCH_NONE,           NULL }
+    , { check_bpsOutOfRange,       NULL,                        F_bpsOutOfRange,        SEVERITY_FAULT,   SAFETY_RULE_SET_DELAY_US, 100000,   LATCH_NONE,           NULL }
+    , { check_tpsOutOfSync,        NULL,                        F_tpsOutOfSync,         SEVERITY_FAULT,   SAFETY_RULE_SET_DELAY_US, 100000,   LATCH_NONE,           "TPS discrepancy of over 10%\n" }
+    , { check_tpsbpsImplausible,   recovered_tpsbpsImplausible, F_tpsbpsImplausible,    SEVERITY_FAULT,   0,                        30000,    LATCH_UNTIL_RECOVERY, "TPS BPS implausiblity detected.\n" }
+    , { check_lvsBatteryVeryLow,   NULL,                        F_lvsBatteryVeryLow,    SEVERITY_FAULT,   500000,                   1000000,  LATCH_NONE,           "LVS battery EXTREMELY LOW!\n" }
+    , { check_bmsCanTimeout,       NULL,                        F_bmsCanTimeout,        SEVERITY_FAULT,   0,                        0,        LATCH_NONE,           "BMS CAN timeout\n" }
+    //Warnings
+    , { check_lvsBatteryLow,       NULL,                        W_lvsBatteryLow,        SEVERITY_WARNING, 1000000,                  1000000,  LATCH_NONE,           "LVS battery LOW.\n" }
+    , { check_mcmCanTimeout,       NULL,                        W_mcmCanTimeout,        SEVERITY_WARNING, 0,                        0,        LATCH_NONE,           NULL }
+    , { check_safetyBypassEnabled, NULL,                        W_safetyBypassEnabled,  SEVERITY_WARNING, 0,                        0,        LATCH_NONE,           NULL }
+    , { check_hvilOverrideEnabled, NULL,                        W_hvilOverrideEnabled,  SEVERITY_WARNING, 0,                        0,        LATCH_NONE,           NULL }
+    //Notices
+    , { check_HVILTermSenseLost,   NULL,                        N_HVILTermSenseLost,    SEVERITY_NOTICE,  0,                        0,        LATCH_NONE,           NULL }
+    , { check_tpsSignalFailure,    NULL,                        N_tpsSignalFailure,     SEVERITY_NOTICE,  100000,                   100000,   LATCH_NONE,           "TPS signal error\n" }
+    , { check_over75kW_BMS,        NULL,                        N_Over75kW_BMS,         SEVERITY_NOTICE,  0,                        100000,   LATCH_NONE,           NULL }
+    , { check_over75kW_MCM,        NULL,                        N_Over75kW_MCM,         SEVERITY_NOTICE,  0,                        100000,   LATCH_NONE,           NULL }
+};
+//A stale count would either skip rows or call a NULL isActive from zero-filled ones
+COMPILE_TIME_ASSERT(sizeof(SafetyChecks) / sizeof(SafetyChecks[0]) == SAFETY_CHECK_COUNT, safetyCheckCount);
 
-    /*****************************************************************************
-    * Warnings
-    ****************************************************************************/
-    //===================================================================
-    // LVS Battery Check - FAULTS LATCH UNTIL RETURN TO PREVIOUS STAGE
-    //===================================================================
-    //  IO_ADC_UBAT: 0..40106  (0V..40.106V)
-    //-------------------------------------------------------------------
-    if (LVBattery->sensorValue <= 9200)  //12730 = 10% SOC but hard to tell under load. 9200 = empty
-    {
-        me->faults |= F_lvsBatteryVeryLow;
-        me->warnings |= W_lvsBatteryLow;
-        sprintf(message, "LVS battery %.03fV EXTREMELY LOW!\n", (float4)LVBattery->sensorValue / 1000);
-        SerialManager_send(me->serialMan, message);
-    }
-    else if (LVBattery->sensorValue <= 12730)  //13100 = Recharge percentage, per Shorai
-    {
-        me->faults &= ~F_lvsBatteryVeryLow;
-        me->warnings |= W_lvsBatteryLow;
-        sprintf(message, "LVS battery %.03fV LOW.\n", (float4)LVBattery->sensorValue / 1000);
-        SerialManager_send(me->serialMan, message);
-    }
-    else
+//Returns TRUE if the flag is currently set
+static bool SafetyChecker_getFlag(SafetyChecker* me, Severity severity, ubyte4 flag)
+{
+    switch (severity)
     {
-        me->warnings &= ~F_lvsBatteryVeryLow;
-        me->warnings &= ~W_lvsBatteryLow;
-        //sprintf(message, "LVS battery %.03fV good.\n", (float4)LVBattery->sensorValue / 1000);
+    case SEVERITY_FAULT:   return (me->faults & flag) > 0;
+    case SEVERITY_WARNING: return (me->warnings & flag) > 0;
+    default:               return (me->notices & flag) > 0;
     }
+}
 
-    //===================================================================
-    // Safety checker bypass
-    //===================================================================
-    // The safety checker should only be bypassed by a CAN message sent by
-    // the PCAN Explorer dashboard.  This is only used during debugging.
-    //-------------------------------------------------------------------
-    //In case CAN communication is lost, the bypass should be disabled after some time, 
-    if (IO_RTC_GetTimeUS(me->timestamp_bypassSafetyChecks) < me->bypassSafetyChecksTimeout_us)
-    {
-        me->warnings |= W_safetyBypassEnabled;
-    }
-    else
+static void SafetyChecker_setFlag(SafetyChecker* me, Severity severity, ubyte4 flag, bool set)
+{
+    switch (severity)
     {
-        me->warnings &= ~W_safetyBypassEnabled;
+    case SEVERITY_FAULT:
+        if (set) { me->faults |= flag; } else { me->faults &= ~flag; }
+        break;
+    case SEVERITY_WARNING:
+        if (set) { me->warnings |= (ubyte2)flag; } else { me->warnings &= ~(ubyte2)flag; }
+        break;
+    default:
+        if (set) { me->notices |= (ubyte2)flag; } else { me->notices &= ~(ubyte2)flag; }
+        break;
     }
+}
 
-    //===================================================================
-    // HVIL Override
-    //===================================================================
-    if (MCM_getHvilOverrideStatus(mcm) == TRUE)
-    {
-        me->warnings |= W_hvilOverrideEnabled;
-    }
-    else
-    {
-        me->warnings &= ~W_hvilOverrideEnabled;
-    }
+/*****************************************************************************
+* Fault history
+******************************************************************************
+* Recording is O(1) - one struct write into the next ring slot, no allocation.
+* Once full, the oldest event is overwritten.
+****************************************************************************/
+static void SafetyChecker_recordEvent(SafetyChecker* me, const SafetyCheck* check, bool set, const SafetyInputs* in)
+{
+    FaultEvent* event = &me->faultHistory[me->faultHistoryNext];
 
-	/*****************************************************************************
-	* Notices
-	****************************************************************************/
+    event->timestamp_ms = me->uptime_ms;
+    event->flag = check->flag;
+    event->severity = check->severity;
+    event->set = set;
+    event->context = (ubyte1)(0xFF * in->tps->percent) | ((ubyte2)(ubyte1)(0xFF * in->bps->percent) << 8);
 
-    //===================================================================
-    // HVIL Term Sense Check
-    //===================================================================
-    // If HVIL term sense goes low (because HV went down), motor torque
-    // command should be set to zero before turning off the controller
-    //-------------------------------------------------------------------
-    if (HVILTermSense->sensorValue == FALSE)
-    {
-        me->notices |= N_HVILTermSenseLost;
-    }
-    else
-    {
-        me->notices &= ~N_HVILTermSenseLost;
-    }
+    me->faultHistoryNext = (me->faultHistoryNext + 1) % FAULT_HISTORY_SIZE;
+    if (me->faultEventCount < 0xFFFF) { me->faultEventCount++; }
+}
 
+bool SafetyChecker_getFaultEvent(SafetyChecker* me, ubyte1 age, FaultEvent* event)
+{
+    ubyte2 stored = (me->faultEventCount < FAULT_HISTORY_SIZE) ? me->faultEventCount : FAULT_HISTORY_SIZE;
+    if (age >= stored) { return FALSE; }
 
-    if (BMS_getPower(bms) > 75000)
-    {
-        me->notices |= N_Over75kW_BMS;
-    }
-    else
+    *event = me->faultHistory[(me->faultHistoryNext + FAULT_HISTORY_SIZE - 1 - age) % FAULT_HISTORY_SIZE];
+    return TRUE;
+}
+
+ubyte2 SafetyChecker_getFaultEventCount(SafetyChecker* me)
+{
+    return me->faultEventCount;
+}
+
+//Called by CanManager when the fault history service is requested on 0x5FF
+void SafetyChecker_requestFaultHistory(SafetyChecker* me, ubyte1 page)
+{
+    me->faultHistoryPage = page;
+    me->faultHistoryRequested = TRUE;
+}
+
+bool SafetyChecker_getFaultHistoryRequest(SafetyChecker* me, ubyte1* page)
+{
+    bool requested = me->faultHistoryRequested;
+    *page = me->faultHistoryPage;
+    me->faultHistoryRequested = FALSE;
+    return requested;
+}
+
+/*****************************************************************************
+* Freeze frames
+******************************************************************************
+* Captured at most once per update (for the first fault to rise that cycle),
+* so the cost is one fixed-size frame: two struct copies for the pedals and a
+* handful of MCM/BMS getters.  Nothing here loops or allocates.
+****************************************************************************/
+static void SafetyChecker_captureFreezeFrame(SafetyChecker* me, ubyte4 triggerFault, const SafetyInputs* in)
+{
+    FreezeFrame* frame = &me->freezeFrames[me->freezeFrameNext];
+
+    frame->timestamp_ms = me->uptime_ms;
+    frame->triggerFault = triggerFault;
+    frame->faults = me->faults;
+    frame->warnings = me->warnings;
+    frame->notices = me->notices;
+
+    frame->tps = *in->tps;
+    frame->bps = *in->bps;
+
+    frame->mcmCommandedTorque = MCM_getCommandedTorque(in->mcm);
+    frame->mcmRPM = MCM_getMotorRPM(in->mcm);
+    frame->mcmDCVoltage = MCM_getDCVoltage(in->mcm);
+    frame->mcmDCCurrent = MCM_getDCCurrent(in->mcm);
+
+    frame->bmsCCL = BMS_getCCL(in->bms);
+    frame->bmsDCL = BMS_getDCL(in->bms);
+    frame->bmsAvgTemp = BMS_getAvgTemp(in->bms);
+    frame->bmsMaxTemp = BMS_getMaxTemp(in->bms);
+
+    frame->LVBattery = in->LVBattery->sensorValue;
+
+    me->freezeFrameNext = (me->freezeFrameNext + 1) % FREEZE_FRAME_COUNT;
+    if (me->freezeFrameCount < FREEZE_FRAME_COUNT) { me->freezeFrameCount++; }
+}
+
+const FreezeFrame* SafetyChecker_getFreezeFrame(SafetyChecker* me, ubyte1 age)
+{
+    if (age >= me->freezeFrameCount) { return NULL; }
+    return &me->freezeFrames[(me->freezeFrameNext + FREEZE_FRAME_COUNT - 1 - age) % FREEZE_FRAME_COUNT];
+}
+
+ubyte1 SafetyChecker_getFreezeFrameCount(SafetyChecker* me)
+{
+    return me->freezeFrameCount;
+}
+
+//Called by CanManager when the freeze frame service is requested on 0x5FF
+void SafetyChecker_requestFreezeFrame(SafetyChecker* me, ubyte1 age)
+{
+    me->freezeFrameRequestAge = age;
+    me->freezeFrameRequested = TRUE;
+}
+
+bool SafetyChecker_getFreezeFrameRequest(SafetyChecker* me, ubyte1* age)
+{
+    bool requested = me->freezeFrameRequested;
+    *age = me->freezeFrameRequestAge;
+    me->freezeFrameRequested = FALSE;
+    return requested;
+}
+
+//Updates all values based on sensor readings, safety checks, etc
+void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, const VehicleState* state)
+{
+    ubyte4 timestamp_evaluationStart = 0;
+    SafetyInputs in;
+    in.mcm = mcm;
+    in.bms = bms;
+    in.tps = &state->tps;
+    in.bps = &state->bps;
+    in.HVILTermSense = &state->hvilTermSense;
+    in.LVBattery = &state->lvBattery;
+
+    IO_RTC_StartTime(&timestamp_evaluationStart);
+
+    //Uptime for the fault history timestamps
+    me->uptime_ms = (ubyte4)(CycleClock_now() / 1000);
+
+    ubyte4 newFault = 0;  //First fault to rise this update (triggers a freeze frame)
+
+    me->faults &= ~F_unusedFaults;
+
+    //One pass over the table.  Cost is bounded by SAFETY_CHECK_COUNT predicates.
+    for (ubyte1 i = 0; i < SAFETY_CHECK_COUNT; i++)
     {
-        me->notices &= ~N_Over75kW_BMS;
+        const SafetyCheck* check = &SafetyChecks[i];
+        bool wasSet = SafetyChecker_getFlag(me, check->severity, check->flag);
+        bool set = wasSet;
+        bool wantSet;
+
+        //What the flag would be without debouncing
+        if (wasSet == FALSE)
+        {
+            wantSet = check->isActive(me, &in);
+        }
+        else
+        {
+            switch (check->latch)
+            {
+            case LATCH_UNTIL_RECOVERY: wantSet = (check->recovered(me, &in) == FALSE); break;
+            default:                   wantSet = check->isActive(me, &in); break;
+            }
+        }
+
+        //Debounce: the flag only changes once it has wanted to for the set/clear delay
+        if (wantSet == wasSet)
+        {
+            me->transitionPending[i] = FALSE;
+        }
+        else
+        {
+            ubyte4 delay_us = wantSet ? check->setDelay_us : check->clearDelay_us;
+            if (delay_us == 0)
+            {
+                set = wantSet;
+            }
+            else if (me->transitionPending[i] == FALSE)
+            {
+                me->transitionPending[i] = TRUE;
+                me->timestamp_transition[i] = CycleClock_now();
+            }
+            else if (CycleClock_since(me->timestamp_transition[i]) >= delay_us)
+            {
+                set = wantSet;
+            }
+
+            if (set == wantSet) { me->transitionPending[i] = FALSE; }
+        }
+
+        if (set != wasSet)
+        {
+            SafetyChecker_recordEvent(me, check, set, &in);
+            if (set == TRUE && check->severity == SEVERITY_FAULT && newFault == 0)
+            {
+                newFault = check->flag;
+            }
+        }
+        if (set == TRUE && wasSet == FALSE && check->message != NULL)
+        {
+            SerialManager_send(me->serialMan, check->message);
+        }
+        SafetyChecker_setFlag(me, check->severity, check->flag, set);
     }
 
-        
-    if (MCM_getPower(mcm) > 75000)
+    //After the loop so the frame holds this update's complete flag words
+    if (newFault != 0)
     {
-        me->notices |= N_Over75kW_MCM;
+        SafetyChecker_captureFreezeFrame(me, newFault, &in);
     }
-    else
+
+    me->evaluationTime_us = IO_RTC_GetTimeUS(timestamp_evaluationStart);
+    if (me->evaluationTime_us > me->evaluationTimeMax_us)
     {
-        me->notices &= ~N_Over75kW_MCM;
+        me->evaluationTimeMax_us = me->evaluationTime_us;
     }
-
 }
 
-
 //Updates all values based on sensor readings, safety checks, etc
 bool SafetyChecker_allSafe(SafetyChecker* me)
 {
@@ -459,6 +728,12 @@ ubyte4 SafetyChecker_getNotices(SafetyChecker* me)
     return (me->notices);
 }
 
+//Time taken by the last/slowest pass over the check table
+ubyte4 SafetyChecker_getEvaluationTimeUS(SafetyChecker* me, bool slowest)
+{
+    return slowest ? me->evaluationTimeMax_us : me->evaluationTime_us;
+}
+
 void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms)
 {
     float4 multiplier = 1;
@@ -547,6 +822,11 @@ void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, Battery
     MCM_commands_setTorqueDNm(mcm, MCM_commands_getTorque(mcm) * multiplier);
 }
 
+void SafetyChecker_setCanTimeouts(SafetyChecker* me, ubyte1 staleNodes)
+{
+    me->staleCanNodes = staleNodes;
+}
+
 //-------------------------------------------------------------------
 // 80kW Limit Check
 //-------------------------------------------------------------------
@@ -6,6 +6,7 @@
 #include "torqueEncoder.h"
 #include "brakePressureSensor.h"
 #include "sensors.h"
+#include "vehicleState.h"
 #include "motorController.h"
 #include "bms.h"
 #include "serial.h"
@@ -20,14 +21,72 @@ typedef enum { CHECK_tpsOutOfRange    , CHECK_bpsOutOfRange
 
 typedef struct _SafetyChecker SafetyChecker;
 
+//CAN nodes whose messages are checked for timeouts (bitfield, see CanManager_checkTimeouts)
+typedef enum { CanNode_MCM = 0x01, CanNode_BMS = 0x02 } CanNode;
+
+//Fault history: every flag set/clear is recorded here so short-lived faults
+//are not lost between 0x502 samples.  Oldest events are overwritten.
+#define FAULT_HISTORY_SIZE 32
+
+typedef struct _FaultEvent
+{
+    ubyte4 timestamp_ms;  //Time since SafetyChecker_new
+    ubyte4 flag;          //The one flag bit that changed
+    ubyte1 severity;      //0 = fault, 1 = warning, 2 = notice
+    bool set;             //TRUE = flag was set, FALSE = flag was cleared
+    ubyte2 context;       //Pedals at the time: TPS (low byte) and BPS (high byte), 0xFF = 100%
+} FaultEvent;
+
 SafetyChecker* SafetyChecker_new(SerialManager* sm, ubyte2 maxChargeAmps, ubyte2 maxDischargeAmps);
-void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, TorqueEncoder* tps, BrakePressureSensor* bps, Sensor* HVILTermSense, Sensor* LVBattery);
+void SafetyChecker_update(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms, const VehicleState* state);
 void SafetyChecker_parseCanMessage(SafetyChecker* me, IO_CAN_DATA_FRAME* canMessage);
 bool SafetyChecker_allSafe(SafetyChecker* me);
 ubyte4 SafetyChecker_getFaults(SafetyChecker* me);
 ubyte4 SafetyChecker_getWarnings(SafetyChecker* me);
 ubyte4 SafetyChecker_getNotices(SafetyChecker* me);
+ubyte4 SafetyChecker_getEvaluationTimeUS(SafetyChecker* me, bool slowest);
 void SafetyChecker_reduceTorque(SafetyChecker* me, MotorController* mcm, BatteryManagementSystem* bms);
+void SafetyChecker_setCanTimeouts(SafetyChecker* me, ubyte1 staleNodes);
+
+//Freeze frames: vehicle state captured on the cycle a fault is first set.
+//Captured by plain struct copies into a fixed pool - oldest is overwritten.
+#define FREEZE_FRAME_COUNT 4
+
+typedef struct _FreezeFrame
+{
+    ubyte4 timestamp_ms;    //Time since SafetyChecker_new
+    ubyte4 triggerFault;    //Fault bit whose rising edge captured this frame
+    ubyte4 faults;          //All flags at the end of that update
+    ubyte2 warnings;
+    ubyte2 notices;
+
+    TorqueEncoder tps;      //Raw/filtered values and calibration
+    BrakePressureSensor bps;
+
+    sbyte2 mcmCommandedTorque;  //Nm, as reported by the MCM
+    sbyte2 mcmRPM;
+    sbyte4 mcmDCVoltage;
+    sbyte4 mcmDCCurrent;
+
+    ubyte1 bmsCCL;
+    ubyte1 bmsDCL;
+    sbyte1 bmsAvgTemp;
+    sbyte1 bmsMaxTemp;
+
+    ubyte4 LVBattery;       //mV
+} FreezeFrame;
+
+//Fault history access (age 0 = newest event).  Returns FALSE if there is no event that old.
+bool SafetyChecker_getFaultEvent(SafetyChecker* me, ubyte1 age, FaultEvent* event);
+ubyte2 SafetyChecker_getFaultEventCount(SafetyChecker* me);  //Total recorded since boot, including overwritten
+void SafetyChecker_requestFaultHistory(SafetyChecker* me, ubyte1 page);
+bool SafetyChecker_getFaultHistoryRequest(SafetyChecker* me, ubyte1* page);  //Returns TRUE once per request
+
+//Freeze frame access (age 0 = newest frame).  Returns NULL if there is no frame that old.
+const FreezeFrame* SafetyChecker_getFreezeFrame(SafetyChecker* me, ubyte1 age);
+ubyte1 SafetyChecker_getFreezeFrameCount(SafetyChecker* me);
+void SafetyChecker_requestFreezeFrame(SafetyChecker* me, ubyte1 age);
+bool SafetyChecker_getFreezeFrameRequest(SafetyChecker* me, ubyte1* age);  //Returns TRUE once per request
 //bool SafetyChecker_getError(SafetyChecker* me, SafetyCheck check);
 //bool SafetyChecker_getErrorByte(SafetyChecker* me, ubyte1* errorByte);
 
@@ -98,6 +98,8 @@
 
 #include "IO_Driver.h"
 
+#include "cycleClock.h"
+
 
 
 typedef enum 
@@ -134,6 +136,7 @@ typedef struct _Sensor {
 
     //ubyte2 calibratedValue;
     ubyte4 sensorValue;
+    ubyte8 timestamp_sampled;  //CycleClock_read() when sensorValue was read (pedal sensors only)
     bool fresh;
     //bool isCalibrated;
 	IO_ErrorType ioErr_powerInit;
@@ -1,9 +1,9 @@
-#include <stdlib.h>  //Needed for malloc
 #include <stdio.h>  //sprintf
 #include <string.h>
 #include "IO_Driver.h"
 #include "IO_UART.h"
 #include "serial.h"
+#include "memoryArena.h"
 
 struct _SerialManager {
     //Init stuff
@@ -17,7 +17,7 @@ struct _SerialManager {
 
 SerialManager* SerialManager_new(void)
 {
-    SerialManager* me = (SerialManager*)malloc(sizeof(struct _SerialManager));
+    SerialManager* me = (SerialManager*)MemoryArena_alloc(sizeof(struct _SerialManager));
     IO_UART_Init(IO_UART_RS232, 115200, 8, IO_UART_PARITY_NONE, 1);
 
     return me;
@@ -1,8 +1,8 @@
-#include <stdlib.h>  //Needed for malloc
 #include <math.h>
 #include "IO_RTC.h"
 
 #include "torqueEncoder.h"
+#include "memoryArena.h"
 #include "mathFunctions.h"
 
 #include "sensors.h"
@@ -17,7 +17,7 @@ extern Sensor Sensor_BenchTPS1;
 ****************************************************************************/
 TorqueEncoder* TorqueEncoder_new(bool benchMode)
 {
-    TorqueEncoder* me = (TorqueEncoder*)malloc(sizeof(struct _TorqueEncoder));
+    TorqueEncoder* me = (TorqueEncoder*)MemoryArena_alloc(sizeof(struct _TorqueEncoder));
     //me->bench = benchMode;
 	
     //TODO: Make sure the main loop is running before doing this
@@ -31,6 +31,7 @@ TorqueEncoder* TorqueEncoder_new(bool benchMode)
 	me->tps1_reverse = TRUE;
 
     me->percent = 0;
+    me->timestamp_sampled = CYCLECLOCK_NEVER;
     me->runCalibration = FALSE;  //Do not run the calibration at the next main loop cycle
 
     //me->calibrated = FALSE;
@@ -71,6 +72,7 @@ void TorqueEncoder_update(TorqueEncoder* me)
 {
 	me->tps0_value = me->tps0->sensorValue;
 	me->tps1_value = me->tps1->sensorValue;
+    me->timestamp_sampled = (me->tps0->timestamp_sampled < me->tps1->timestamp_sampled) ? me->tps0->timestamp_sampled : me->tps1->timestamp_sampled;
 
 	me->percent = 0;
 	ubyte2 errorCount = 0;
@@ -118,14 +120,31 @@ void TorqueEncoder_resetCalibration(TorqueEncoder* me)
     me->tps1_calibMax = me->tps1->sensorValue;
 }
 
-void TorqueEncoder_saveCalibrationToEEPROM(TorqueEncoder* me)
+void TorqueEncoder_saveCalibrationToEEPROM(TorqueEncoder* me, EEPROMManager* eep)
 {
-
+    EEPROMManager_set(eep, EEPROMSlot_tps0_calibMin, me->tps0_calibMin);
+    EEPROMManager_set(eep, EEPROMSlot_tps0_calibMax, me->tps0_calibMax);
+    EEPROMManager_set(eep, EEPROMSlot_tps1_calibMin, me->tps1_calibMin);
+    EEPROMManager_set(eep, EEPROMSlot_tps1_calibMax, me->tps1_calibMax);
 }
 
-void TorqueEncoder_loadCalibrationFromEEPROM(TorqueEncoder* me)
+void TorqueEncoder_loadCalibrationFromEEPROM(TorqueEncoder* me, EEPROMManager* eep)
 {
-
+    ubyte4 tps0Min, tps0Max, tps1Min, tps1Max;
+
+    //All four or nothing - never mix stored and default values
+    if (EEPROMManager_get(eep, EEPROMSlot_tps0_calibMin, &tps0Min)
+        && EEPROMManager_get(eep, EEPROMSlot_tps0_calibMax, &tps0Max)
+        && EEPROMManager_get(eep, EEPROMSlot_tps1_calibMin, &tps1Min)
+        && EEPROMManager_get(eep, EEPROMSlot_tps1_calibMax, &tps1Max)
+        && tps0Min < tps0Max && tps1Min < tps1Max)
+    {
+        me->tps0_calibMin = tps0Min;
+        me->tps0_calibMax = tps0Max;
+        me->tps1_calibMin = tps1Min;
+        me->tps1_calibMax = tps1Max;
+        me->calibrated = TRUE;
+    }
 }
 
 void TorqueEncoder_startCalibration(TorqueEncoder* me, ubyte1 secondsToRun)
@@ -135,12 +154,12 @@ void TorqueEncoder_startCalibration(TorqueEncoder* me, ubyte1 secondsToRun)
         me->runCalibration = TRUE;
         TorqueEncoder_resetCalibration(me);
         me->calibrated = FALSE;
-        IO_RTC_StartTime(&(me->timestamp_calibrationStart));
+        me->timestamp_calibrationStart = CycleClock_now();
         me->calibrationRunTime = secondsToRun;
     }
     else
     {
-        IO_RTC_StartTime(&(me->timestamp_calibrationStart));  //extend the calibration time
+        me->timestamp_calibrationStart = CycleClock_now();  //extend the calibration time
     }
 }
 
@@ -160,7 +179,7 @@ void TorqueEncoder_calibrationCycle(TorqueEncoder* me, ubyte1* errorCount)
 {
     if (me->runCalibration == TRUE)
     {
-        if (IO_RTC_GetTimeUS(me->timestamp_calibrationStart) < (ubyte4)(me->calibrationRunTime) * 1000 * 1000)
+        if (CycleClock_since(me->timestamp_calibrationStart) < (ubyte4)(me->calibrationRunTime) * 1000 * 1000)
         {
 			//The calibration itself
 			if (me->tps0->sensorValue < me->tps0_calibMin) { me->tps0_calibMin = me->tps0->sensorValue; }
@@ -197,7 +216,7 @@ void TorqueEncoder_calibrationCycle(TorqueEncoder* me, ubyte1* errorCount)
         //TODO: Throw warning: calibrationCycle helper function was called but calibration should not be running
     }
 
-    //TODO: Write calibration data to EEPROM
+    //Calibration data is written to EEPROM by main once runCalibration goes FALSE
 
     //TODO: Check for valid/reasonable calibration data
 
@@ -209,7 +228,7 @@ void TorqueEncoder_calibrationCycle(TorqueEncoder* me, ubyte1* errorCount)
 }
 
 
-void TorqueEncoder_getIndividualSensorPercent(TorqueEncoder* me, ubyte1 sensorNumber, float4* percent)
+void TorqueEncoder_getIndividualSensorPercent(const TorqueEncoder* me, ubyte1 sensorNumber, float4* percent)
 {
 	switch (sensorNumber)
 	{
@@ -233,7 +252,7 @@ void TorqueEncoder_getIndividualSensorPercent(TorqueEncoder* me, ubyte1 sensorNu
 * Throws:      000 - TPS0 voltage out of range
 *              001 - TPS1 voltage out of range, 002
 -------------------------------------------------------------------*/
-void TorqueEncoder_getPedalTravel(TorqueEncoder* me, ubyte1* errorCount, float4* pedalPercent)
+void TorqueEncoder_getPedalTravel(const TorqueEncoder* me, ubyte1* errorCount, float4* pedalPercent)
 {
 	*pedalPercent = me->percent;
 
@@ -3,6 +3,8 @@
 
 #include "IO_Driver.h"
 #include "sensors.h"
+#include "eepromManager.h"
+#include "cycleClock.h"
 
 //After updateFromSensors, access to tps Sensor objects should no longer be necessary.
 //In other words, only updateFromSensors itself should use the tps Sensor objects
@@ -27,23 +29,24 @@ typedef struct _TorqueEncoder
     float4 tps1_percent;
 
     bool runCalibration;
-    ubyte4 timestamp_calibrationStart;
+    ubyte8 timestamp_calibrationStart;
     ubyte1 calibrationRunTime;
 
     bool calibrated;
     float4 percent;
+    ubyte8 timestamp_sampled;  //When the older of the two sensor readings behind percent was taken
 	bool implausibility;
 } TorqueEncoder;
 
 TorqueEncoder* TorqueEncoder_new(bool benchMode);
 void TorqueEncoder_update(TorqueEncoder* me);
-void TorqueEncoder_getIndividualSensorPercent(TorqueEncoder* me, ubyte1 sensorNumber, float4* percent);
+void TorqueEncoder_getIndividualSensorPercent(const TorqueEncoder* me, ubyte1 sensorNumber, float4* percent);
 void TorqueEncoder_resetCalibration(TorqueEncoder* me);
-void TorqueEncoder_saveCalibrationToEEPROM(TorqueEncoder* me);
-void TorqueEncoder_loadCalibrationFromEEPROM(TorqueEncoder* me);
+void TorqueEncoder_saveCalibrationToEEPROM(TorqueEncoder* me, EEPROMManager* eep);
+void TorqueEncoder_loadCalibrationFromEEPROM(TorqueEncoder* me, EEPROMManager* eep);  //Keeps the defaults if nothing valid is stored
 void TorqueEncoder_startCalibration(TorqueEncoder* me, ubyte1 secondsToRun);
 void TorqueEncoder_calibrationCycle(TorqueEncoder* me, ubyte1* errorCount);
 //void TorqueEncoder_plausibilityCheck(TorqueEncoder* me, ubyte1* errorCount, bool* isPlausible);
-void TorqueEncoder_getPedalTravel(TorqueEncoder* me, ubyte1* errorCount, float4* pedalPercent);
+void TorqueEncoder_getPedalTravel(const TorqueEncoder* me, ubyte1* errorCount, float4* pedalPercent);
 
 #endif //  _TORQUEENCODER_H
\ No newline at end of file
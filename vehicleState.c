@@ -0,0 +1,43 @@
+#include "IO_Driver.h"
+
+#include "vehicleState.h"
+
+static VehicleState buffers[2];
+static volatile ubyte1 current = 0;   //Index of the published buffer - one byte, so the swap is atomic
+static ubyte4 publishCount = 0;
+
+void VehicleState_publish(const TorqueEncoder* tps, const BrakePressureSensor* bps, WheelSpeeds* wss)
+{
+    VehicleState* next = &buffers[current ^ 1];
+
+    next->cycle = ++publishCount;
+    next->timestamp = CycleClock_now();
+
+    next->tps0 = Sensor_TPS0;
+    next->tps1 = Sensor_TPS1;
+    next->bps0 = Sensor_BPS0;
+    next->tps = *tps;
+    next->tps.tps0 = &next->tps0;
+    next->tps.tps1 = &next->tps1;
+    next->bps = *bps;
+    next->bps.bps0 = &next->bps0;
+
+    next->rtdButton = Sensor_RTDButton;
+    next->tcsSwitchUp = Sensor_TCSSwitchUp;
+    next->tcsSwitchDown = Sensor_TCSSwitchDown;
+    next->tcsKnob = Sensor_TCSKnob;
+    next->hvilTermSense = Sensor_HVILTerminationSense;
+    next->lvBattery = Sensor_LVBattery;
+
+    next->wheelSpeed[FL] = WheelSpeeds_getWheelSpeed(wss, FL);
+    next->wheelSpeed[FR] = WheelSpeeds_getWheelSpeed(wss, FR);
+    next->wheelSpeed[RL] = WheelSpeeds_getWheelSpeed(wss, RL);
+    next->wheelSpeed[RR] = WheelSpeeds_getWheelSpeed(wss, RR);
+
+    current ^= 1;
+}
+
+const VehicleState* VehicleState_get(void)
+{
+    return &buffers[current];
+}
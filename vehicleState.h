@@ -0,0 +1,59 @@
+#ifndef _VEHICLESTATE_H
+#define _VEHICLESTATE_H
+
+#include "IO_Driver.h"
+
+#include "sensors.h"
+#include "torqueEncoder.h"
+#include "brakePressureSensor.h"
+#include "wheelSpeeds.h"
+#include "cycleClock.h"
+
+/*****************************************************************************
+* Vehicle state snapshot
+******************************************************************************
+* Acquisition (sensor sampling, pedal and wheel speed calculations) ends each
+* cycle by publishing one VehicleState.  Control and output code - torque
+* commands, safety checks, the startup sequence, telemetry - reads only that
+* snapshot, so everything decided in a cycle is based on the same inputs even
+* if acquisition later moves to an interrupt or a different rate.
+*
+* The snapshot is written into the inactive half of a double buffer and then
+* made current with a single byte write.  Consumers take the pointer from
+* VehicleState_get once per cycle.  It stays valid until the publish after
+* next, so the producer must not publish twice while a consumer is still
+* working on a snapshot.
+*
+* Values from CAN (MCM, BMS) are still read through their objects.
+****************************************************************************/
+typedef struct _VehicleState
+{
+    ubyte4 cycle;       //Publish count - consumers can spot a stale or repeated snapshot
+    ubyte8 timestamp;   //CycleClock_now at publish
+
+    //Pedals.  The Sensor pointers inside tps/bps point at the copies below, not the live globals.
+    TorqueEncoder tps;
+    BrakePressureSensor bps;
+    Sensor tps0;
+    Sensor tps1;
+    Sensor bps0;
+
+    //Dash and vehicle inputs
+    Sensor rtdButton;
+    Sensor tcsSwitchUp;
+    Sensor tcsSwitchDown;
+    Sensor tcsKnob;
+    Sensor hvilTermSense;
+    Sensor lvBattery;
+
+    float4 wheelSpeed[4];   //Indexed by Wheel
+} VehicleState;
+
+//Copies the inputs into the inactive buffer and makes it current.  Call once per cycle,
+//after every acquisition update and before any consumer runs.
+void VehicleState_publish(const TorqueEncoder* tps, const BrakePressureSensor* bps, WheelSpeeds* wss);
+
+//The most recently published snapshot
+const VehicleState* VehicleState_get(void);
+
+#endif // _VEHICLESTATE_H
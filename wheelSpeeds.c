@@ -1,9 +1,9 @@
-#include <stdlib.h>  //Needed for malloc
 #include <math.h>
 #include "IO_RTC.h"
 #include "IO_DIO.h"
 
 #include "wheelSpeeds.h"
+#include "memoryArena.h"
 #include "mathFunctions.h"
 
 #include "sensors.h"
@@ -40,7 +40,7 @@ struct _WheelSpeeds
 ****************************************************************************/
 WheelSpeeds* WheelSpeeds_new(float4 tireDiameterInches_F, float4 tireDiameterInches_R, ubyte1 pulsesPerRotation_F, ubyte1 pulsesPerRotation_R)
 {
-	WheelSpeeds* me = (WheelSpeeds*)malloc(sizeof(struct _WheelSpeeds));
+	WheelSpeeds* me = (WheelSpeeds*)MemoryArena_alloc(sizeof(struct _WheelSpeeds));
     
 	//1 inch = .0254 m
 	me->tireCircumferenceMeters_F = 3.14159 * (.0254 * tireDiameterInches_F);